@@ -0,0 +1,241 @@
+#include "buzz_controller_foraging.h"
+#include "foraging_loop_functions.h"
+#include <argos3/core/simulator/simulator.h>
+#include <argos3/core/utility/configuration/argos_configuration.h>
+
+/****************************************/
+/****************************************/
+
+/*
+ * Returns the controller running the VM.
+ */
+static CBuzzControllerForaging& GetController(buzzvm_t t_vm) {
+   buzzvm_pushs(t_vm, buzzvm_string_register(t_vm, "controller", 1));
+   buzzvm_gload(t_vm);
+   CBuzzControllerForaging* pcController =
+      reinterpret_cast<CBuzzControllerForaging*>(buzzvm_stack_at(t_vm, 1)->u.value);
+   buzzvm_pop(t_vm);
+   return *pcController;
+}
+
+/*
+ * Numeric arguments may be integers or floats.
+ */
+#define BUZZ_NUMBER_ASSERT(VM, IDX)                                     \
+   if(buzzvm_stack_at(VM, IDX)->o.type != BUZZTYPE_INT) {               \
+      buzzvm_type_assert(VM, IDX, BUZZTYPE_FLOAT);                      \
+   }
+
+static Real GetNumber(buzzvm_t t_vm, UInt32 un_idx) {
+   buzzobj_t tObj = buzzvm_stack_at(t_vm, un_idx);
+   return tObj->o.type == BUZZTYPE_INT ? tObj->i.value : tObj->f.value;
+}
+
+/****************************************/
+/****************************************/
+
+static int BuzzPheromoneSample(buzzvm_t t_vm) {
+   CVector2 cOffset;
+   if(buzzvm_lnum(t_vm) > 0) {
+      buzzvm_lnum_assert(t_vm, 2);
+      buzzvm_lload(t_vm, 1);
+      buzzvm_lload(t_vm, 2);
+      BUZZ_NUMBER_ASSERT(t_vm, 2);
+      BUZZ_NUMBER_ASSERT(t_vm, 1);
+      cOffset.Set(GetNumber(t_vm, 2), GetNumber(t_vm, 1));
+   }
+   buzzvm_pushf(t_vm, GetController(t_vm).SamplePheromone(cOffset));
+   return buzzvm_ret1(t_vm);
+}
+
+/****************************************/
+/****************************************/
+
+static int BuzzPheromoneGradient(buzzvm_t t_vm) {
+   buzzvm_lnum_assert(t_vm, 0);
+   CVector2 cGradient = GetController(t_vm).GetPheromoneGradient();
+   buzzvm_pusht(t_vm);
+   buzzobj_t tTable = buzzvm_stack_at(t_vm, 1);
+   buzzvm_push(t_vm, tTable);
+   buzzvm_pushs(t_vm, buzzvm_string_register(t_vm, "x", 1));
+   buzzvm_pushf(t_vm, cGradient.GetX());
+   buzzvm_tput(t_vm);
+   buzzvm_push(t_vm, tTable);
+   buzzvm_pushs(t_vm, buzzvm_string_register(t_vm, "y", 1));
+   buzzvm_pushf(t_vm, cGradient.GetY());
+   buzzvm_tput(t_vm);
+   return buzzvm_ret1(t_vm);
+}
+
+/****************************************/
+/****************************************/
+
+static int BuzzPheromoneDeposit(buzzvm_t t_vm) {
+   buzzvm_lnum_assert(t_vm, 1);
+   buzzvm_lload(t_vm, 1);
+   BUZZ_NUMBER_ASSERT(t_vm, 1);
+   Real fAmount = GetNumber(t_vm, 1);
+   if(fAmount > 0.0) {
+      GetController(t_vm).AddDeposit(fAmount);
+   }
+   return buzzvm_ret0(t_vm);
+}
+
+/****************************************/
+/****************************************/
+
+static int BuzzSetState(buzzvm_t t_vm) {
+   buzzvm_lnum_assert(t_vm, 1);
+   buzzvm_lload(t_vm, 1);
+   buzzvm_type_assert(t_vm, 1, BUZZTYPE_INT);
+   SInt32 nState = buzzvm_stack_at(t_vm, 1)->i.value;
+   if(nState < CFootBotForaging::SStateData::STATE_RESTING ||
+      nState > CFootBotForaging::SStateData::STATE_RETURN_TO_NEST) {
+      buzzvm_seterror(t_vm, BUZZVM_ERROR_TYPE, "set_state(): expected a state from 0 to 3, got %d", nState);
+      return t_vm->state;
+   }
+   GetController(t_vm).SetState(static_cast<CFootBotForaging::SStateData::EState>(nState));
+   return buzzvm_ret0(t_vm);
+}
+
+/****************************************/
+/****************************************/
+
+CBuzzControllerForaging::CBuzzControllerForaging() :
+   m_pcPosition(NULL),
+   m_pcField(NULL),
+   m_nGradientRadius(3),
+   m_fDeposit(0.0),
+   m_eState(CFootBotForaging::SStateData::STATE_RESTING),
+   m_unEventId(0) {}
+
+/****************************************/
+/****************************************/
+
+void CBuzzControllerForaging::Init(TConfigurationNode& t_node) {
+   try {
+      if(!HasSensor("positioning")) {
+         THROW_ARGOSEXCEPTION("The Buzz foraging controller needs the positioning sensor");
+      }
+      m_pcPosition = GetSensor<CCI_PositioningSensor>("positioning");
+      if(NodeExists(t_node, "pheromones")) {
+         GetNodeAttributeOrDefault(GetNode(t_node, "pheromones"), "gradient_radius",
+                                   m_nGradientRadius, m_nGradientRadius);
+      }
+      if(m_nGradientRadius < 1) {
+         THROW_ARGOSEXCEPTION("The gradient radius must be at least one cell");
+      }
+      /* Loads the script, registers the closures and runs init() */
+      CBuzzControllerFootBot::Init(t_node);
+   }
+   catch(CARGoSException& ex) {
+      THROW_ARGOSEXCEPTION_NESTED("Error initializing the Buzz foraging controller", ex);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CBuzzControllerForaging::ControlStep() {
+   CBuzzControllerFootBot::ControlStep();
+   /* Whether the item was found by following the trail */
+   if(m_eState == CFootBotForaging::SStateData::STATE_LINE_FOLLOWING) {
+      ++m_sFoodData.LineFollowingTicks;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CBuzzControllerForaging::Reset() {
+   m_fDeposit = 0.0;
+   m_eState = CFootBotForaging::SStateData::STATE_RESTING;
+   m_sFoodData.Reset();
+   CBuzzControllerFootBot::Reset();
+}
+
+/****************************************/
+/****************************************/
+
+Real CBuzzControllerForaging::SamplePheromone(const CVector2& c_offset) const {
+   /* Before the first step, e.g. in init() */
+   if(m_pcField == NULL) return 0.0;
+   CVector2 cPoint(c_offset);
+   cPoint.Rotate(m_cYaw);
+   cPoint += m_cPosition;
+   return m_pcField->Get(m_pcField->ToCell(cPoint.GetX()),
+                         m_pcField->ToCell(cPoint.GetY()));
+}
+
+/****************************************/
+/****************************************/
+
+CVector2 CBuzzControllerForaging::GetPheromoneGradient() const {
+   if(m_pcField == NULL) return CVector2();
+   SInt32 nX = m_pcField->ToCell(m_cPosition.GetX());
+   SInt32 nY = m_pcField->ToCell(m_cPosition.GetY());
+   Real fSumX = 0.0, fSumY = 0.0;
+   for(SInt32 j = -m_nGradientRadius; j <= m_nGradientRadius; ++j) {
+      for(SInt32 i = -m_nGradientRadius; i <= m_nGradientRadius; ++i) {
+         Real fValue = m_pcField->Get(nX + i, nY + j);
+         fSumX += i * fValue;
+         fSumY += j * fValue;
+      }
+   }
+   /* The sum of i^2 over the window, the same for j^2 */
+   Real fNorm = (2 * m_nGradientRadius + 1) *
+      m_nGradientRadius * (m_nGradientRadius + 1) * (2 * m_nGradientRadius + 1) / 3.0;
+   CVector2 cGradient(fSumX / fNorm * m_pcField->GetResolution(),
+                      fSumY / fNorm * m_pcField->GetResolution());
+   return cGradient.Rotate(-m_cYaw);
+}
+
+/****************************************/
+/****************************************/
+
+buzzvm_state CBuzzControllerForaging::RegisterFunctions() {
+   CBuzzControllerFootBot::RegisterFunctions();
+   buzzvm_pushs(m_tBuzzVM, buzzvm_string_register(m_tBuzzVM, "pheromone_sample", 1));
+   buzzvm_pushcc(m_tBuzzVM, buzzvm_function_register(m_tBuzzVM, BuzzPheromoneSample));
+   buzzvm_gstore(m_tBuzzVM);
+   buzzvm_pushs(m_tBuzzVM, buzzvm_string_register(m_tBuzzVM, "pheromone_gradient", 1));
+   buzzvm_pushcc(m_tBuzzVM, buzzvm_function_register(m_tBuzzVM, BuzzPheromoneGradient));
+   buzzvm_gstore(m_tBuzzVM);
+   buzzvm_pushs(m_tBuzzVM, buzzvm_string_register(m_tBuzzVM, "pheromone_deposit", 1));
+   buzzvm_pushcc(m_tBuzzVM, buzzvm_function_register(m_tBuzzVM, BuzzPheromoneDeposit));
+   buzzvm_gstore(m_tBuzzVM);
+   buzzvm_pushs(m_tBuzzVM, buzzvm_string_register(m_tBuzzVM, "set_state", 1));
+   buzzvm_pushcc(m_tBuzzVM, buzzvm_function_register(m_tBuzzVM, BuzzSetState));
+   buzzvm_gstore(m_tBuzzVM);
+   return m_tBuzzVM->state;
+}
+
+/****************************************/
+/****************************************/
+
+void CBuzzControllerForaging::UpdateSensors() {
+   CBuzzControllerFootBot::UpdateSensors();
+   /* The field is allocated by the loop functions, which are initialized
+      after the robots */
+   if(m_pcField == NULL) {
+      CForagingLoopFunctions* pcLoopFunctions =
+         dynamic_cast<CForagingLoopFunctions*>(&CSimulator::GetInstance().GetLoopFunctions());
+      if(pcLoopFunctions == NULL) {
+         THROW_ARGOSEXCEPTION("The Buzz foraging controller needs the foraging loop functions");
+      }
+      m_pcField = &pcLoopFunctions->GetPheromoneField();
+   }
+   /* The pose the closures work in for this step */
+   const CCI_PositioningSensor::SReading& sReading = m_pcPosition->GetReading();
+   m_cPosition.Set(sReading.Position.GetX(), sReading.Position.GetY());
+   CRadians cPitch, cRoll;
+   sReading.Orientation.ToEulerAngles(m_cYaw, cPitch, cRoll);
+   buzzvm_pushs(m_tBuzzVM, buzzvm_string_register(m_tBuzzVM, "has_food", 1));
+   buzzvm_pushi(m_tBuzzVM, m_sFoodData.HasFoodItem ? 1 : 0);
+   buzzvm_gstore(m_tBuzzVM);
+}
+
+/****************************************/
+/****************************************/
+
+REGISTER_CONTROLLER(CBuzzControllerForaging, "buzz_controller_foraging")
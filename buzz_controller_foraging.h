@@ -0,0 +1,154 @@
+/*
+ * A Buzz foot-bot controller with native access to the pheromone field.
+ *
+ * On top of the closures of CBuzzControllerFootBot, the script gets:
+ *
+ *    pheromone_sample()       the pheromone under the robot
+ *    pheromone_sample(x, y)   the pheromone at (x,y), in meters in the
+ *                             frame of the robot
+ *    pheromone_gradient()     the gradient of the pheromone around the
+ *                             robot, per meter, as a table {.x, .y} in the
+ *                             frame of the robot: goto() climbs it
+ *    pheromone_deposit(a)     lays a stamp of a over the robot
+ *    set_state(s)             tells the loop functions the state of the
+ *                             robot, numbered like
+ *                             CFootBotForaging::SStateData::EState
+ *
+ * and the global has_food, 1 while the robot carries an item.
+ *
+ * The closures read the field of the loop functions in place: nothing is
+ * copied into the VM, and a sample costs a few array reads whatever the
+ * size of the trail. The field cannot change while the controllers run
+ * (see CPheromoneField::BeginDecay()), so the deposits of a step are
+ * summed and the loop functions lay them at their next PreStep(), with
+ * the radius of the trail.
+ *
+ * The loop functions treat a Buzz foot-bot like a CFootBotForaging one:
+ * they pick and drop its items, lay its trail while it carries one, and
+ * count it and log its trips. It does not use the nest bulletin board,
+ * and cannot be checkpointed.
+ *
+ * Needs the positioning sensor. The optional <pheromones> node of the
+ * parameters sets the half side of the window of the gradient, in cells:
+ *
+ *    <params bytecode_file="build/foraging.bo" debug_file="build/foraging.bdb">
+ *      <pheromones gradient_radius="3" />
+ *    </params>
+ */
+
+#ifndef BUZZ_CONTROLLER_FORAGING_H
+#define BUZZ_CONTROLLER_FORAGING_H
+
+#include <buzz/argos/buzz_controller_footbot.h>
+#include <argos3/plugins/robots/generic/control_interface/ci_positioning_sensor.h>
+#include "footbot_foraging.h"
+#include "pheromone_field.h"
+
+using namespace argos;
+
+class CBuzzControllerForaging : public CBuzzControllerFootBot {
+
+public:
+
+   CBuzzControllerForaging();
+   virtual ~CBuzzControllerForaging() {}
+
+   virtual void Init(TConfigurationNode& t_node);
+   virtual void ControlStep();
+   virtual void Reset();
+
+   /*
+    * Returns the pheromone at the given offset from the robot, in meters
+    * in the frame of the robot.
+    */
+   Real SamplePheromone(const CVector2& c_offset) const;
+
+   /*
+    * Returns the gradient of the pheromone around the robot, per meter in
+    * the frame of the robot: the slope of the plane fitted by least
+    * squares to the window of cells around it.
+    */
+   CVector2 GetPheromoneGradient() const;
+
+   /*
+    * Adds f_amount to the deposit of this step.
+    */
+   inline void AddDeposit(Real f_amount) {
+      m_fDeposit += f_amount;
+   }
+
+   /*
+    * Returns the deposit of the last step and forgets it.
+    */
+   inline Real TakeDeposit() {
+      Real fDeposit = m_fDeposit;
+      m_fDeposit = 0.0;
+      return fDeposit;
+   }
+
+   /*
+    * Sets the state told by the script.
+    */
+   inline void SetState(CFootBotForaging::SStateData::EState e_state) {
+      m_eState = e_state;
+   }
+
+   /*
+    * Returns the state told by the script.
+    */
+   inline CFootBotForaging::SStateData::EState GetState() const {
+      return m_eState;
+   }
+
+   /*
+    * Returns true if the script said the robot is resting.
+    */
+   inline bool IsResting() const {
+      return m_eState == CFootBotForaging::SStateData::STATE_RESTING;
+   }
+
+   /*
+    * Returns the food data, which the loop functions update.
+    */
+   inline CFootBotForaging::SFoodData& GetFoodData() {
+      return m_sFoodData;
+   }
+
+   /*
+    * Sets the index of the robot in the event log.
+    */
+   inline void SetEventId(UInt32 un_id) {
+      m_unEventId = un_id;
+   }
+
+   /*
+    * Returns the index of the robot in the event log.
+    */
+   inline UInt32 GetEventId() const {
+      return m_unEventId;
+   }
+
+protected:
+
+   virtual buzzvm_state RegisterFunctions();
+   virtual void UpdateSensors();
+
+private:
+
+   /* The positioning sensor, and the pose it read at this step */
+   CCI_PositioningSensor* m_pcPosition;
+   CVector2 m_cPosition;
+   CRadians m_cYaw;
+   /* The field of the loop functions, found at the first step */
+   const CPheromoneField* m_pcField;
+   /* Half side of the gradient window, in cells */
+   SInt32 m_nGradientRadius;
+   /* Pheromone to lay at the next step */
+   Real m_fDeposit;
+   CFootBotForaging::SStateData::EState m_eState;
+   CFootBotForaging::SFoodData m_sFoodData;
+   UInt32 m_unEventId;
+
+};
+
+#endif
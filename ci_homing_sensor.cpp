@@ -0,0 +1,26 @@
+#include "ci_homing_sensor.h"
+
+#ifdef ARGOS_WITH_LUA
+#include <argos3/core/wrappers/lua/lua_utility.h>
+
+/****************************************/
+/****************************************/
+
+void CCI_HomingSensor::CreateLuaState(lua_State* pt_lua_state) {
+   CLuaUtility::StartTable(pt_lua_state, "homing");
+   CLuaUtility::AddToTable(pt_lua_state, "vector", m_sReading.Vector);
+   CLuaUtility::AddToTable(pt_lua_state, "distance", m_sReading.Distance);
+   CLuaUtility::EndTable(pt_lua_state);
+}
+
+/****************************************/
+/****************************************/
+
+void CCI_HomingSensor::ReadingsToLuaState(lua_State* pt_lua_state) {
+   lua_getfield(pt_lua_state, -1, "homing");
+   CLuaUtility::AddToTable(pt_lua_state, "vector", m_sReading.Vector);
+   CLuaUtility::AddToTable(pt_lua_state, "distance", m_sReading.Distance);
+   lua_pop(pt_lua_state, 1);
+}
+
+#endif
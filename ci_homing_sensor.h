@@ -0,0 +1,60 @@
+/*
+ * Control interface of the homing sensor, a virtual sensor that reads the
+ * flow field of the loop functions (see homing_field.h) under the robot.
+ *
+ * The reading is the direction to follow to reach the nest around the
+ * obstacles, as a unit vector in the frame of the robot, and the distance
+ * left along the obstacles, in meters. In the nest, the vector is zero
+ * and the distance too. Where the field gives no guidance (no <homing>
+ * node in the loop functions, or a robot outside of the grid or cut off
+ * from the nest), the vector is zero and the distance negative.
+ *
+ *    <sensors>
+ *      <homing implementation="default" />
+ *    </sensors>
+ *
+ * With Lua, the reading is the table homing = { vector = {x, y},
+ * distance }.
+ */
+
+#ifndef CI_HOMING_SENSOR_H
+#define CI_HOMING_SENSOR_H
+
+#include <argos3/core/control_interface/ci_sensor.h>
+#include <argos3/core/utility/math/vector2.h>
+
+using namespace argos;
+
+class CCI_HomingSensor : public CCI_Sensor {
+
+public:
+
+   struct SReading {
+      CVector2 Vector;
+      Real Distance;
+
+      SReading() :
+         Distance(-1.0) {}
+   };
+
+public:
+
+   virtual ~CCI_HomingSensor() {}
+
+   inline const SReading& GetReading() const {
+      return m_sReading;
+   }
+
+#ifdef ARGOS_WITH_LUA
+   virtual void CreateLuaState(lua_State* pt_lua_state);
+
+   virtual void ReadingsToLuaState(lua_State* pt_lua_state);
+#endif
+
+protected:
+
+   SReading m_sReading;
+
+};
+
+#endif
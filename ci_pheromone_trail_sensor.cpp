@@ -0,0 +1,26 @@
+#include "ci_pheromone_trail_sensor.h"
+
+#ifdef ARGOS_WITH_LUA
+#include <argos3/core/wrappers/lua/lua_utility.h>
+
+/****************************************/
+/****************************************/
+
+void CCI_PheromoneTrailSensor::CreateLuaState(lua_State* pt_lua_state) {
+   CLuaUtility::StartTable(pt_lua_state, "pheromone_trail");
+   CLuaUtility::AddToTable(pt_lua_state, "any", m_sReading.Any);
+   CLuaUtility::AddToTable(pt_lua_state, "max", m_sReading.Max);
+   CLuaUtility::EndTable(pt_lua_state);
+}
+
+/****************************************/
+/****************************************/
+
+void CCI_PheromoneTrailSensor::ReadingsToLuaState(lua_State* pt_lua_state) {
+   lua_getfield(pt_lua_state, -1, "pheromone_trail");
+   CLuaUtility::AddToTable(pt_lua_state, "any", m_sReading.Any);
+   CLuaUtility::AddToTable(pt_lua_state, "max", m_sReading.Max);
+   lua_pop(pt_lua_state, 1);
+}
+
+#endif
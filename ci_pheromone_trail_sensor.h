@@ -0,0 +1,61 @@
+/*
+ * Control interface of the pheromone trail sensor, a virtual sensor that
+ * asks the pheromone field of the loop functions (see pheromone_field.h)
+ * about the trail around the robot.
+ *
+ * The reading says whether any cell within the radius of the sensor holds
+ * pheromone, and the largest value around the robot. The largest value is
+ * read from the pyramid blocks covering the disc, so it may come from a
+ * cell up to twice the radius away along each axis; it is zero when there
+ * is no trail within the radius.
+ *
+ *    <sensors>
+ *      <pheromone_trail implementation="default" radius="1" />
+ *    </sensors>
+ *
+ * The loop functions need pyramid="true" on the <pheromones> node.
+ *
+ * With Lua, the reading is the table pheromone_trail = { any, max }.
+ */
+
+#ifndef CI_PHEROMONE_TRAIL_SENSOR_H
+#define CI_PHEROMONE_TRAIL_SENSOR_H
+
+#include <argos3/core/control_interface/ci_sensor.h>
+
+using namespace argos;
+
+class CCI_PheromoneTrailSensor : public CCI_Sensor {
+
+public:
+
+   struct SReading {
+      bool Any;
+      Real Max;
+
+      SReading() :
+         Any(false),
+         Max(0.0) {}
+   };
+
+public:
+
+   virtual ~CCI_PheromoneTrailSensor() {}
+
+   inline const SReading& GetReading() const {
+      return m_sReading;
+   }
+
+#ifdef ARGOS_WITH_LUA
+   virtual void CreateLuaState(lua_State* pt_lua_state);
+
+   virtual void ReadingsToLuaState(lua_State* pt_lua_state);
+#endif
+
+protected:
+
+   SReading m_sReading;
+
+};
+
+#endif
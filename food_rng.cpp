@@ -0,0 +1,27 @@
+#include "food_rng.h"
+
+/****************************************/
+/****************************************/
+
+void CFoodRNG::Positions(const std::vector<UInt32>& vec_respawns,
+                         const CRange<Real>& c_x, const CRange<Real>& c_y,
+                         std::vector<CVector2>& vec_pos) {
+   vec_pos.resize(vec_respawns.size());
+   const Real fMinX = c_x.GetMin(), fSpanX = c_x.GetSpan();
+   const Real fMinY = c_y.GetMin(), fSpanY = c_y.GetSpan();
+   /* The uniforms first, in a loop the compiler can vectorize, then the
+      positions */
+   m_vecU.resize(vec_respawns.size());
+   m_vecV.resize(vec_respawns.size());
+   Real* pfU = m_vecU.empty() ? NULL : &m_vecU[0];
+   Real* pfV = m_vecV.empty() ? NULL : &m_vecV[0];
+   const UInt32* punRespawns = vec_respawns.empty() ? NULL : &vec_respawns[0];
+   const size_t unItems = vec_respawns.size();
+   for(size_t i = 0; i < unItems; ++i) {
+      Uniforms(static_cast<UInt32>(i), punRespawns[i], pfU[i], pfV[i]);
+   }
+   for(size_t i = 0; i < unItems; ++i) {
+      vec_pos[i].Set(fMinX + pfU[i] * fSpanX,
+                     fMinY + pfV[i] * fSpanY);
+   }
+}
@@ -0,0 +1,120 @@
+/*
+ * Counter-based generator of the food positions.
+ *
+ * The position of a food item is a pure function of the key of the run,
+ * the index of the item and the number of times the item has been
+ * respawned: the three are hashed by Philox4x32-10 (Salmon et al.,
+ * "Parallel random numbers: as easy as 1, 2, 3", SC 2011), whose 128 bits
+ * of output give a 53-bit uniform for each coordinate. There is no state
+ * to advance, so a respawn draws the same position whichever robot, thread
+ * or order handles it, and a checkpoint only needs the key and the
+ * respawn counts. Drawing many items at once is a loop without
+ * dependencies between iterations, which the compiler can vectorize.
+ */
+
+#ifndef FOOD_RNG_H
+#define FOOD_RNG_H
+
+#include <argos3/core/utility/math/range.h>
+#include <argos3/core/utility/math/vector2.h>
+#include <vector>
+
+using namespace argos;
+
+class CFoodRNG {
+
+public:
+
+   CFoodRNG(UInt32 un_key = 0) :
+      m_unKey(un_key) {}
+
+   inline void SetKey(UInt32 un_key) {
+      m_unKey = un_key;
+   }
+
+   inline UInt32 GetKey() const {
+      return m_unKey;
+   }
+
+   /*
+    * Philox4x32-10 of the 128-bit counter pun_ctr with the 64-bit key
+    * (un_key0, un_key1), into pun_out.
+    */
+   static inline void Philox(const UInt32* pun_ctr, UInt32 un_key0, UInt32 un_key1, UInt32* pun_out) {
+      UInt32 unC0 = pun_ctr[0], unC1 = pun_ctr[1], unC2 = pun_ctr[2], unC3 = pun_ctr[3];
+      for(UInt32 r = 0; r < 10; ++r) {
+         UInt64 unP0 = static_cast<UInt64>(PHILOX_M0) * unC0;
+         UInt64 unP1 = static_cast<UInt64>(PHILOX_M1) * unC2;
+         UInt32 unN0 = static_cast<UInt32>(unP1 >> 32) ^ unC1 ^ un_key0;
+         UInt32 unN2 = static_cast<UInt32>(unP0 >> 32) ^ unC3 ^ un_key1;
+         unC0 = unN0;
+         unC1 = static_cast<UInt32>(unP1);
+         unC2 = unN2;
+         unC3 = static_cast<UInt32>(unP0);
+         un_key0 += PHILOX_W0;
+         un_key1 += PHILOX_W1;
+      }
+      pun_out[0] = unC0;
+      pun_out[1] = unC1;
+      pun_out[2] = unC2;
+      pun_out[3] = unC3;
+   }
+
+   /*
+    * Returns the uniform position in the given ranges of an item after
+    * un_respawns respawns.
+    */
+   inline CVector2 Position(UInt32 un_item, UInt32 un_respawns,
+                            const CRange<Real>& c_x, const CRange<Real>& c_y) const {
+      Real fU, fV;
+      Uniforms(un_item, un_respawns, fU, fV);
+      return CVector2(c_x.GetMin() + fU * c_x.GetSpan(),
+                      c_y.GetMin() + fV * c_y.GetSpan());
+   }
+
+   /*
+    * Sets the position of every item from its respawn count, as Position()
+    * would, in a single pass.
+    */
+   void Positions(const std::vector<UInt32>& vec_respawns,
+                  const CRange<Real>& c_x, const CRange<Real>& c_y,
+                  std::vector<CVector2>& vec_pos);
+
+private:
+
+   /* Two uniforms in [0,1) for an item after un_respawns respawns */
+   inline void Uniforms(UInt32 un_item, UInt32 un_respawns, Real& f_u, Real& f_v) const {
+      const UInt32 punCtr[4] = { un_item, un_respawns, 0, 0 };
+      UInt32 punOut[4];
+      Philox(punCtr, m_unKey, FOOD_STREAM, punOut);
+      f_u = ToUniform(punOut[0], punOut[1]);
+      f_v = ToUniform(punOut[2], punOut[3]);
+   }
+
+   /* 27 bits of a word and 26 of the other, in [0,1); converted through
+      signed 32-bit integers, which SIMD units convert natively */
+   static inline Real ToUniform(UInt32 un_hi, UInt32 un_lo) {
+      Real fHi = static_cast<SInt32>(un_hi >> 5);
+      Real fLo = static_cast<SInt32>(un_lo >> 6);
+      return (fHi * 67108864.0 + fLo) * (1.0 / 9007199254740992.0);
+   }
+
+private:
+
+   /* Philox4x32 multipliers and Weyl increments of the key */
+   static const UInt32 PHILOX_M0 = 0xD2511F53;
+   static const UInt32 PHILOX_M1 = 0xCD9E8D57;
+   static const UInt32 PHILOX_W0 = 0x9E3779B9;
+   static const UInt32 PHILOX_W1 = 0xBB67AE85;
+   /* Second word of the key, so that other uses of Philox with the same
+      key draw other numbers */
+   static const UInt32 FOOD_STREAM = 0x464F4F44; // "FOOD"
+
+   UInt32 m_unKey;
+   /* The uniforms of Positions(), kept to avoid allocations */
+   std::vector<Real> m_vecU;
+   std::vector<Real> m_vecV;
+
+};
+
+#endif
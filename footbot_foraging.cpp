@@ -6,7 +6,21 @@
 #include <argos3/core/utility/math/vector2.h>
 /* Logging */
 #include <argos3/core/utility/logging/argos_log.h>
+/* Simulation clock */
+#include <argos3/core/simulator/simulator.h>
+/* Checkpoint serialization */
+#include "foraging_checkpoint.h"
+/* Batched execution */
+#include "foraging_swarm_engine.h"
+/* Event stream */
+#include "foraging_event_log.h"
+/* The behaviour variants */
+#include "footbot_foraging_variant.h"
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
 
 /****************************************/
 /****************************************/
@@ -14,12 +28,39 @@
 CFootBotForaging::SFoodData::SFoodData() :
    HasFoodItem(false),
    FoodItemIdx(0),
-   TotalFoodItems(0) {}
+   TotalFoodItems(0),
+   OnTrip(false),
+   TripStart(0),
+   PickupTick(0),
+   TripDistance(0.0),
+   LineFollowingTicks(0),
+   FoundViaTrail(false) {}
 
 void CFootBotForaging::SFoodData::Reset() {
    HasFoodItem = false;
    FoodItemIdx = 0;
    TotalFoodItems = 0;
+   OnTrip = false;
+   TripStart = 0;
+   PickupTick = 0;
+   TripDistance = 0.0;
+   LastPosition = CVector2();
+   LineFollowingTicks = 0;
+   FoundViaTrail = false;
+}
+
+/****************************************/
+/****************************************/
+
+CFootBotForaging::SBulletin::SBulletin() :
+   Posted(LAST_EXPLORATION_NONE),
+   HeardSuccessful(0),
+   HeardUnsuccessful(0) {}
+
+void CFootBotForaging::SBulletin::Reset() {
+   Posted = LAST_EXPLORATION_NONE;
+   HeardSuccessful = 0;
+   HeardUnsuccessful = 0;
 }
 
 /****************************************/
@@ -46,7 +87,6 @@ void CFootBotForaging::SDiffusionParams::Init(TConfigurationNode& t_node) {
 
 void CFootBotForaging::SWheelTurningParams::Init(TConfigurationNode& t_node) {
    try {
-      TurningMechanism = NO_TURN;
       CDegrees cAngle;
       GetNodeAttribute(t_node, "hard_turn_angle_threshold", cAngle);
       HardTurnOnAngleThreshold = ToRadians(cAngle);
@@ -64,10 +104,10 @@ void CFootBotForaging::SWheelTurningParams::Init(TConfigurationNode& t_node) {
 /****************************************/
 /****************************************/
 
-CFootBotForaging::SStateData::SStateData() :
+CFootBotForaging::SStateParams::SStateParams() :
    ProbRange(0.0f, 1.0f) {}
 
-void CFootBotForaging::SStateData::Init(TConfigurationNode& t_node) {
+void CFootBotForaging::SStateParams::Init(TConfigurationNode& t_node) {
    try {
       GetNodeAttribute(t_node, "initial_rest_to_explore_prob", InitialRestToExploreProb);
       GetNodeAttribute(t_node, "initial_explore_to_rest_prob", InitialExploreToRestProb);
@@ -86,19 +126,97 @@ void CFootBotForaging::SStateData::Init(TConfigurationNode& t_node) {
    }
 }
 
-void CFootBotForaging::SStateData::Reset() {
+/****************************************/
+/****************************************/
+
+CFootBotForaging::SParams::SParams() :
+   Batched(false),
+   Sleep(false) {}
+
+void CFootBotForaging::SParams::Init(TConfigurationNode& t_node) {
+   /* Diffusion algorithm */
+   Diffusion.Init(GetNode(t_node, "diffusion"));
+   /* Wheel turning */
+   WheelTurning.Init(GetNode(t_node, "wheel_turning"));
+   /* Controller state */
+   State.Init(GetNode(t_node, "state"));
+   /* Batched execution is optional */
+   if(NodeExists(t_node, "batch")) {
+      GetNodeAttributeOrDefault(GetNode(t_node, "batch"), "enabled", Batched, false);
+   }
+   /* So is sleeping while resting */
+   if(NodeExists(t_node, "sleep")) {
+      GetNodeAttributeOrDefault(GetNode(t_node, "sleep"), "enabled", Sleep, false);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+CFootBotForaging::SStateData::SStateData() :
+   State(STATE_RESTING),
+   TurningMechanism(SWheelTurningParams::NO_TURN),
+   InNest(true),
+   FollowingLine(false),
+   DriveLeft(false),
+   DriveRight(false),
+   RestToExploreProb(0.0),
+   ExploreToRestProb(0.0),
+   TimeRested(0),
+   TimeExploringUnsuccessfully(0),
+   TimeSearchingForPlaceInNest(0),
+   SleepTick(0),
+   WakeTick(0) {}
+
+void CFootBotForaging::SStateData::Reset(const SStateParams& s_params) {
    State = STATE_RESTING;
+   TurningMechanism = SWheelTurningParams::NO_TURN;
    InNest = true;
-   RestToExploreProb = InitialRestToExploreProb;
-   ExploreToRestProb = InitialExploreToRestProb;
+   RestToExploreProb = s_params.InitialRestToExploreProb;
+   ExploreToRestProb = s_params.InitialExploreToRestProb;
    TimeExploringUnsuccessfully = 0;
    /* Initially the robot is resting, and by setting RestingTime to
       MinimumRestingTime we force the robots to make a decision at the
       experiment start. If instead we set RestingTime to zero, we would
       have to wait till RestingTime reaches MinimumRestingTime before
       something happens, which is just a waste of time. */
-   TimeRested = MinimumRestingTime;
+   TimeRested = s_params.MinimumRestingTime;
    TimeSearchingForPlaceInNest = 0;
+   SleepTick = 0;
+   WakeTick = 0;
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * The parameters in use, by controller configuration id. Entries expire
+ * with the last robot holding them, so a new experiment parses them again.
+ */
+static std::map<std::string, std::weak_ptr<const CFootBotForaging::SParams> > g_mapSharedParams;
+static std::mutex g_cSharedParamsMutex;
+
+std::shared_ptr<const CFootBotForaging::SParams> CFootBotForaging::GetSharedParams(TConfigurationNode& t_node) {
+   /* t_node is the <params> node: the id is on its parent */
+   std::string strId;
+   TConfigurationNode* ptConfig = t_node.Parent()->ToElement();
+   if(ptConfig != NULL) {
+      GetNodeAttributeOrDefault(*ptConfig, "id", strId, strId);
+   }
+   std::lock_guard<std::mutex> cLock(g_cSharedParamsMutex);
+   std::shared_ptr<const SParams> psParams;
+   if(!strId.empty()) {
+      psParams = g_mapSharedParams[strId].lock();
+   }
+   if(!psParams) {
+      std::shared_ptr<SParams> psNew(new SParams);
+      psNew->Init(t_node);
+      psParams = psNew;
+      if(!strId.empty()) {
+         g_mapSharedParams[strId] = psParams;
+      }
+   }
+   return psParams;
 }
 
 /****************************************/
@@ -112,7 +230,13 @@ CFootBotForaging::CFootBotForaging() :
    m_pcProximity(NULL),
    m_pcLight(NULL),
    m_pcGround(NULL),
-   m_pcRNG(NULL) {}
+   m_pcHoming(NULL),
+   m_pcRNG(NULL),
+   m_fLeftWheelSpeed(0.0),
+   m_fRightWheelSpeed(0.0),
+   m_bBatched(false),
+   m_unBatchSlot(0),
+   m_unEventId(0) {}
 
 /****************************************/
 /****************************************/
@@ -129,15 +253,19 @@ void CFootBotForaging::Init(TConfigurationNode& t_node) {
       m_pcProximity = GetSensor  <CCI_FootBotProximitySensor      >("footbot_proximity"    );
       m_pcLight     = GetSensor  <CCI_FootBotLightSensor          >("footbot_light"        );
       m_pcGround    = GetSensor  <CCI_FootBotMotorGroundSensor    >("footbot_motor_ground" );
+      /* The homing sensor is optional */
+      if(HasSensor("homing")) {
+         m_pcHoming = GetSensor<CCI_HomingSensor>("homing");
+      }
       /*
-       * Parse XML parameters
+       * Parse XML parameters, or share those of the robots with the same
+       * configuration
        */
-      /* Diffusion algorithm */
-      m_sDiffusionParams.Init(GetNode(t_node, "diffusion"));
-      /* Wheel turning */
-      m_sWheelTurningParams.Init(GetNode(t_node, "wheel_turning"));
-      /* Controller state */
-      m_sStateData.Init(GetNode(t_node, "state"));
+      m_psParams = GetSharedParams(t_node);
+      m_bBatched = m_psParams->Batched;
+      if(m_bBatched && !SupportsBatching()) {
+         THROW_ARGOSEXCEPTION("Batched execution requires the three-state turning of footbot_foraging_controller");
+      }
    }
    catch(CARGoSException& ex) {
       THROW_ARGOSEXCEPTION_NESTED("Error initializing the foot-bot foraging controller for robot \"" << GetId() << "\"", ex);
@@ -148,38 +276,11 @@ void CFootBotForaging::Init(TConfigurationNode& t_node) {
    /* Create a random number generator. We use the 'argos' category so
       that creation, reset, seeding and cleanup are managed by ARGoS. */
    m_pcRNG = CRandom::CreateRNG("argos");
-   Reset();
-}
-
-/****************************************/
-/****************************************/
-
-void CFootBotForaging::ControlStep() {
-   switch(m_sStateData.State) {
-      case SStateData::STATE_RESTING: {
-//         RLOG << "State: resting\n";
-         Rest();
-         break;
-      }
-      case SStateData::STATE_EXPLORING: {
-//         RLOG << "State: exploring\n";
-         Explore();
-         break;
-      }
-      case SStateData::STATE_LINE_FOLLOWING: {
-//         RLOG << "State: line following\n";
-         LineFollow();
-         break;
-      }
-      case SStateData::STATE_RETURN_TO_NEST: {
-//         RLOG << "State: returning to nest\n";
-         ReturnToNest();
-         break;
-      }
-      default: {
-         LOGERR << "We can't be here, there's a bug!" << std::endl;
-      }
+   /* Hand the robot over to the swarm engine */
+   if(m_bBatched) {
+      m_unBatchSlot = CForagingSwarmEngine::GetInstance().Register(this);
    }
+   Reset();
 }
 
 /****************************************/
@@ -187,7 +288,11 @@ void CFootBotForaging::ControlStep() {
 
 void CFootBotForaging::Reset() {
    /* Reset robot state */
-   m_sStateData.Reset();
+   m_sStateData.Reset(m_psParams->State);
+   /* The swarm engine keeps its own copy of the turning state */
+   if(m_bBatched) {
+      CForagingSwarmEngine::GetInstance().SetTurningMechanism(m_unBatchSlot, m_sStateData.TurningMechanism);
+   }
    /* Reset food data */
    m_sFoodData.Reset();
    /* Set LED color */
@@ -196,110 +301,164 @@ void CFootBotForaging::Reset() {
    m_eLastExplorationResult = LAST_EXPLORATION_NONE;
    m_pcRABA->ClearData();
    m_pcRABA->SetData(0, LAST_EXPLORATION_NONE);
+   m_sBulletin.Reset();
+   /* The actuator stops the wheels */
+   m_fLeftWheelSpeed = 0.0;
+   m_fRightWheelSpeed = 0.0;
 }
 
 /****************************************/
 /****************************************/
 
-void CFootBotForaging::UpdateState() {
-   /* Reset state flags */
-   m_sStateData.InNest = false;
-   m_sStateData.FollowingLine = false;
-   m_sStateData.DriveLeft = false;
-   m_sStateData.DriveRight = false;
-   /* Read stuff from the ground sensor */
-   const CCI_FootBotMotorGroundSensor::TReadings &tGroundReads = m_pcGround->GetReadings();
-   /*
-    * You can say whether you are in the nest by checking the ground sensor
-    * placed close to the wheel motors. It returns a value between 0 and 1.
-    * It is 1 when the robot is on a white area, it is 0 when the robot
-    * is on a black area and it is around 0.5 when the robot is on a gray
-    * area. 
-    * The foot-bot has 4 sensors like this, two in the front
-    * (corresponding to readings 0 and 1) and two in the back
-    * (corresponding to reading 2 and 3).  Here we want the back sensors
-    * (readings 2 and 3) to tell us whether we are on gray: if so, the
-    * robot is completely in the nest, otherwise it's outside.
-    */
+void CFootBotForaging::Destroy() {
+   if(m_bBatched) {
+      CForagingSwarmEngine::GetInstance().Unregister(m_unBatchSlot);
+      m_bBatched = false;
+   }
+}
 
-//   // so yellow is 0.886
-//    std::cout << "\n left ";
-//    std::cout << tGroundReads[0];
-//    std::cout << " ";
-//    std::cout << tGroundReads[3];
-//    std::cout << "\n right ";
-//    std::cout << tGroundReads[1];
-//    std::cout << " ";
-//    std::cout << tGroundReads[2];
-
-      float GrayLowerBound = 0.45;
-      float GrayUpperBound = 0.55;
-      float YellowLowerBound = 0.81;
-      float YellowUpperBound = 0.91;
-
-      if (tGroundReads[2].Value > GrayLowerBound &&
-          tGroundReads[2].Value < GrayUpperBound &&
-          tGroundReads[3].Value > GrayLowerBound &&
-          tGroundReads[3].Value < GrayUpperBound) {
-         m_sStateData.InNest = true;
-         m_sStateData.DriveLeft = false;
-         m_sStateData.DriveRight = false;
-      }
-      if (m_sStateData.State != SStateData::STATE_RETURN_TO_NEST) {
-         if((tGroundReads[0].Value > YellowLowerBound &&
-             tGroundReads[0].Value < YellowUpperBound) ||
-            (tGroundReads[1].Value > YellowLowerBound &&
-             tGroundReads[1].Value < YellowUpperBound) ||
-            (tGroundReads[2].Value > YellowLowerBound &&
-             tGroundReads[2].Value < YellowUpperBound) ||
-            (tGroundReads[3].Value > YellowLowerBound &&
-             tGroundReads[3].Value < YellowUpperBound)) {
-            // time to follow the line
-//            std::cout << "Line detected!\n";
-            m_sStateData.FollowingLine = true;
-            //        m_sStateData.FollowLineDecay = 2; //if you change this you also have to change it in the header file
-            m_sStateData.State = SStateData::STATE_LINE_FOLLOWING;
-
-            //do we turn left?
-            if((tGroundReads[0].Value > YellowLowerBound &&
-                tGroundReads[0].Value < YellowUpperBound) ||
-               (tGroundReads[3].Value > YellowLowerBound &&
-                tGroundReads[3].Value < YellowUpperBound)) {
-//               std::cout << "Turn Left!\n";
-               m_sStateData.DriveLeft = true;
-            }
-            //do we turn right?
-            if((tGroundReads[1].Value > YellowLowerBound &&
-                tGroundReads[1].Value < YellowUpperBound) ||
-               (tGroundReads[2].Value > YellowLowerBound &&
-                tGroundReads[2].Value < YellowUpperBound)) {
-//               std::cout << "Turn Right!\n";
-               m_sStateData.DriveRight = true;
-            }
-            //note that if both left and right that means drive straight!
-         }
-      }
-      if (!m_sStateData.FollowingLine &&  m_sStateData.State == SStateData::STATE_LINE_FOLLOWING){
-         m_sStateData.State = SStateData::STATE_EXPLORING;
-      }
+/****************************************/
+/****************************************/
 
-//    if(!m_sStateData.FollowingLine && !m_sStateData.InNest){
-//        if (m_sStateData.FollowLineDecay > 0){
-//            m_sStateData.FollowLineDecay -= 1;
-//            m_sStateData.FollowingLine = true;
-//        }
-//        else{
-//            m_sStateData.DriveLeft = false;
-//            m_sStateData.DriveRight = false;
-//           m_sStateData.FollowingLine = false;
-//        }
-//    }
+void CFootBotForaging::SaveState(std::ostream& c_out) {
+   /* Rebase the random number generator on a fresh seed */
+   UInt32 unSeed = m_pcRNG->Uniform(CRange<UInt32>(0, std::numeric_limits<UInt32>::max()));
+   m_pcRNG->SetSeed(unSeed);
+   m_pcRNG->Reset();
+   CheckpointWrite(c_out, unSeed);
+   /* State machine */
+   CheckpointWrite<UInt8>(c_out, m_sStateData.State);
+   CheckpointWrite(c_out, m_sStateData.InNest);
+   CheckpointWrite(c_out, m_sStateData.FollowingLine);
+   CheckpointWrite(c_out, m_sStateData.DriveLeft);
+   CheckpointWrite(c_out, m_sStateData.DriveRight);
+   CheckpointWrite(c_out, m_sStateData.RestToExploreProb);
+   CheckpointWrite(c_out, m_sStateData.ExploreToRestProb);
+   CheckpointWrite<UInt64>(c_out, m_sStateData.TimeRested);
+   /* Sleep, as steps of the saved clock */
+   CheckpointWrite(c_out, m_sStateData.SleepTick);
+   CheckpointWrite(c_out, m_sStateData.WakeTick);
+   CheckpointWrite<UInt64>(c_out, m_sStateData.TimeExploringUnsuccessfully);
+   CheckpointWrite<UInt64>(c_out, m_sStateData.TimeSearchingForPlaceInNest);
+   /* Turning state, kept by the engine in batched mode */
+   if(m_bBatched) {
+      CheckpointWrite<UInt8>(c_out, CForagingSwarmEngine::GetInstance().GetTurningMechanism(m_unBatchSlot));
+   }
+   else {
+      CheckpointWrite<UInt8>(c_out, m_sStateData.TurningMechanism);
+   }
+   /* Food data */
+   CheckpointWrite(c_out, m_sFoodData.HasFoodItem);
+   CheckpointWrite<UInt64>(c_out, m_sFoodData.FoodItemIdx);
+   CheckpointWrite<UInt64>(c_out, m_sFoodData.TotalFoodItems);
+   CheckpointWrite(c_out, m_sFoodData.OnTrip);
+   CheckpointWrite(c_out, m_sFoodData.TripStart);
+   CheckpointWrite(c_out, m_sFoodData.PickupTick);
+   CheckpointWrite(c_out, m_sFoodData.TripDistance);
+   CheckpointWrite(c_out, m_sFoodData.LastPosition.GetX());
+   CheckpointWrite(c_out, m_sFoodData.LastPosition.GetY());
+   CheckpointWrite(c_out, m_sFoodData.LineFollowingTicks);
+   CheckpointWrite(c_out, m_sFoodData.FoundViaTrail);
+   /* Social rule, and the result told at this step */
+   CheckpointWrite<UInt8>(c_out, m_eLastExplorationResult);
+   CheckpointWrite(c_out, m_sBulletin.Posted);
+   /* Wheel speeds, applied at the next step */
+   CheckpointWrite(c_out, m_fLeftWheelSpeed);
+   CheckpointWrite(c_out, m_fRightWheelSpeed);
+}
+
+/****************************************/
+/****************************************/
+
+void CFootBotForaging::LoadState(std::istream& c_in) {
+   UInt8 unByte;
+   UInt64 unValue;
+   /* Random number generator */
+   UInt32 unSeed;
+   CheckpointRead(c_in, unSeed);
+   m_pcRNG->SetSeed(unSeed);
+   m_pcRNG->Reset();
+   /* State machine */
+   CheckpointRead(c_in, unByte);
+   m_sStateData.State = static_cast<SStateData::EState>(unByte);
+   CheckpointRead(c_in, m_sStateData.InNest);
+   CheckpointRead(c_in, m_sStateData.FollowingLine);
+   CheckpointRead(c_in, m_sStateData.DriveLeft);
+   CheckpointRead(c_in, m_sStateData.DriveRight);
+   CheckpointRead(c_in, m_sStateData.RestToExploreProb);
+   CheckpointRead(c_in, m_sStateData.ExploreToRestProb);
+   CheckpointRead(c_in, unValue); m_sStateData.TimeRested = unValue;
+   /* Sleep, as steps of the restored clock */
+   CheckpointRead(c_in, m_sStateData.SleepTick);
+   CheckpointRead(c_in, m_sStateData.WakeTick);
+   CheckpointRead(c_in, unValue); m_sStateData.TimeExploringUnsuccessfully = unValue;
+   CheckpointRead(c_in, unValue); m_sStateData.TimeSearchingForPlaceInNest = unValue;
+   /* Turning state */
+   CheckpointRead(c_in, unByte);
+   m_sStateData.TurningMechanism = static_cast<SWheelTurningParams::ETurningMechanism>(unByte);
+   if(m_bBatched) {
+      CForagingSwarmEngine::GetInstance().SetTurningMechanism(m_unBatchSlot, unByte);
+   }
+   /* Food data */
+   CheckpointRead(c_in, m_sFoodData.HasFoodItem);
+   CheckpointRead(c_in, unValue); m_sFoodData.FoodItemIdx = unValue;
+   CheckpointRead(c_in, unValue); m_sFoodData.TotalFoodItems = unValue;
+   CheckpointRead(c_in, m_sFoodData.OnTrip);
+   CheckpointRead(c_in, m_sFoodData.TripStart);
+   CheckpointRead(c_in, m_sFoodData.PickupTick);
+   CheckpointRead(c_in, m_sFoodData.TripDistance);
+   Real fX, fY;
+   CheckpointRead(c_in, fX);
+   CheckpointRead(c_in, fY);
+   m_sFoodData.LastPosition.Set(fX, fY);
+   CheckpointRead(c_in, m_sFoodData.LineFollowingTicks);
+   CheckpointRead(c_in, m_sFoodData.FoundViaTrail);
+   /* Social rule, and the result told at the saved step */
+   CheckpointRead(c_in, unByte);
+   m_eLastExplorationResult = static_cast<ELastExplorationResult>(unByte);
+   m_sBulletin.Reset();
+   CheckpointRead(c_in, m_sBulletin.Posted);
+   /* Actuators: the result told and the wheel speeds are applied at the
+      next step as they would have been; LEDs follow the state */
+   m_pcRABA->ClearData();
+   m_pcRABA->SetData(0, UsesBulletin() ? static_cast<UInt8>(LAST_EXPLORATION_NONE) : m_sBulletin.Posted);
+   Real fLeft, fRight;
+   CheckpointRead(c_in, fLeft);
+   CheckpointRead(c_in, fRight);
+   SetWheelSpeeds(fLeft, fRight);
+   switch(m_sStateData.State) {
+      case SStateData::STATE_RESTING:        m_pcLEDs->SetAllColors(CColor::RED);    break;
+      case SStateData::STATE_EXPLORING:      m_pcLEDs->SetAllColors(CColor::GREEN);  break;
+      case SStateData::STATE_LINE_FOLLOWING: m_pcLEDs->SetAllColors(CColor::YELLOW); break;
+      case SStateData::STATE_RETURN_TO_NEST: m_pcLEDs->SetAllColors(CColor::BLUE);   break;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CFootBotForaging::LogStateChange(SStateData::EState e_from) {
+   CForagingEventLog& cLog = CForagingEventLog::GetInstance();
+   if(!cLog.IsEnabled()) return;
+   SForagingEvent sEvent;
+   ::memset(&sEvent, 0, sizeof(sEvent));
+   sEvent.Tick = CSimulator::GetInstance().GetSpace().GetSimulationClock();
+   sEvent.Robot = m_unEventId;
+   sEvent.Type = SForagingEvent::EVENT_STATE;
+   sEvent.From = e_from;
+   sEvent.To = m_sStateData.State;
+   sEvent.Item = m_sFoodData.FoodItemIdx;
+   cLog.Emit(sEvent);
 }
 
 /****************************************/
 /****************************************/
 
 CVector2 CFootBotForaging::CalculateVectorToLight() {
+   /* Computed for the whole swarm in batched mode */
+   if(m_bBatched) {
+      return CForagingSwarmEngine::GetInstance().GetVectorToLight(m_unBatchSlot);
+   }
    /* Get readings from light sensor */
    const CCI_FootBotLightSensor::TReadings& tLightReads = m_pcLight->GetReadings();
    /* Sum them together */
@@ -320,7 +479,24 @@ CVector2 CFootBotForaging::CalculateVectorToLight() {
 /****************************************/
 /****************************************/
 
+CVector2 CFootBotForaging::CalculateVectorToNest() {
+   if(m_pcHoming != NULL) {
+      const CCI_HomingSensor::SReading& sReading = m_pcHoming->GetReading();
+      if(sReading.Vector.SquareLength() > 0.0f) {
+         return sReading.Vector;
+      }
+   }
+   return CalculateVectorToLight();
+}
+
+/****************************************/
+/****************************************/
+
 CVector2 CFootBotForaging::DiffusionVector(bool& b_collision) {
+   /* Computed for the whole swarm in batched mode */
+   if(m_bBatched) {
+      return CForagingSwarmEngine::GetInstance().GetDiffusionVector(m_unBatchSlot, b_collision);
+   }
    /* Get readings from proximity sensor */
    const CCI_FootBotProximitySensor::TReadings& tProxReads = m_pcProximity->GetReadings();
    /* Sum them together */
@@ -331,8 +507,8 @@ CVector2 CFootBotForaging::DiffusionVector(bool& b_collision) {
    /* If the angle of the vector is small enough and the closest obstacle
       is far enough, ignore the vector and go straight, otherwise return
       it */
-   if(m_sDiffusionParams.GoStraightAngleRange.WithinMinBoundIncludedMaxBoundIncluded(cDiffusionVector.Angle()) &&
-      cDiffusionVector.Length() < m_sDiffusionParams.Delta ) {
+   if(m_psParams->Diffusion.GoStraightAngleRange.WithinMinBoundIncludedMaxBoundIncluded(cDiffusionVector.Angle()) &&
+      cDiffusionVector.Length() < m_psParams->Diffusion.Delta ) {
       b_collision = false;
       return CVector2::X;
    }
@@ -346,330 +522,6 @@ CVector2 CFootBotForaging::DiffusionVector(bool& b_collision) {
 /****************************************/
 /****************************************/
 
-void CFootBotForaging::SetWheelSpeedsFromVector(const CVector2& c_heading) {
-   /* Get the heading angle */
-   CRadians cHeadingAngle = c_heading.Angle().SignedNormalize();
-   /* Get the length of the heading vector */
-   Real fHeadingLength = c_heading.Length();
-   /* Clamp the speed so that it's not greater than MaxSpeed */
-   Real fBaseAngularWheelSpeed = Min<Real>(fHeadingLength, m_sWheelTurningParams.MaxSpeed);
-   /* State transition logic */
-   if(m_sWheelTurningParams.TurningMechanism == SWheelTurningParams::HARD_TURN) {
-      if(Abs(cHeadingAngle) <= m_sWheelTurningParams.SoftTurnOnAngleThreshold) {
-         m_sWheelTurningParams.TurningMechanism = SWheelTurningParams::SOFT_TURN;
-      }
-   }
-   if(m_sWheelTurningParams.TurningMechanism == SWheelTurningParams::SOFT_TURN) {
-      if(Abs(cHeadingAngle) > m_sWheelTurningParams.HardTurnOnAngleThreshold) {
-         m_sWheelTurningParams.TurningMechanism = SWheelTurningParams::HARD_TURN;
-      }
-      else if(Abs(cHeadingAngle) <= m_sWheelTurningParams.NoTurnAngleThreshold) {
-         m_sWheelTurningParams.TurningMechanism = SWheelTurningParams::NO_TURN;
-      }
-   }
-   if(m_sWheelTurningParams.TurningMechanism == SWheelTurningParams::NO_TURN) {
-      if(Abs(cHeadingAngle) > m_sWheelTurningParams.HardTurnOnAngleThreshold) {
-         m_sWheelTurningParams.TurningMechanism = SWheelTurningParams::HARD_TURN;
-      }
-      else if(Abs(cHeadingAngle) > m_sWheelTurningParams.NoTurnAngleThreshold) {
-         m_sWheelTurningParams.TurningMechanism = SWheelTurningParams::SOFT_TURN;
-      }
-   }
-   /* Wheel speeds based on current turning state */
-   Real fSpeed1, fSpeed2;
-   switch(m_sWheelTurningParams.TurningMechanism) {
-      case SWheelTurningParams::NO_TURN: {
-         /* Just go straight */
-         fSpeed1 = fBaseAngularWheelSpeed;
-         fSpeed2 = fBaseAngularWheelSpeed;
-         break;
-      }
-      case SWheelTurningParams::SOFT_TURN: {
-         /* Both wheels go straight, but one is faster than the other */
-         Real fSpeedFactor = (m_sWheelTurningParams.HardTurnOnAngleThreshold - Abs(cHeadingAngle)) / m_sWheelTurningParams.HardTurnOnAngleThreshold;
-         fSpeed1 = fBaseAngularWheelSpeed - fBaseAngularWheelSpeed * (1.0 - fSpeedFactor);
-         fSpeed2 = fBaseAngularWheelSpeed + fBaseAngularWheelSpeed * (1.0 - fSpeedFactor);
-         break;
-      }
-      case SWheelTurningParams::HARD_TURN: {
-         /* Opposite wheel speeds */
-         fSpeed1 = -m_sWheelTurningParams.MaxSpeed;
-         fSpeed2 =  m_sWheelTurningParams.MaxSpeed;
-         break;
-      }
-   }
-   /* Apply the calculated speeds to the appropriate wheels */
-   Real fLeftWheelSpeed, fRightWheelSpeed;
-   if(cHeadingAngle > CRadians::ZERO) {
-      /* Turn Left */
-      fLeftWheelSpeed  = fSpeed1;
-      fRightWheelSpeed = fSpeed2;
-   }
-   else {
-      /* Turn Right */
-      fLeftWheelSpeed  = fSpeed2;
-      fRightWheelSpeed = fSpeed1;
-   }
-   /* Finally, set the wheel speeds */
-   m_pcWheels->SetLinearVelocity(fLeftWheelSpeed, fRightWheelSpeed);
-}
-
-/****************************************/
-/****************************************/
-
-void CFootBotForaging::Rest() {
-   /* If we have stayed here enough, probabilistically switch to
-    * 'exploring' */
-   if(m_sStateData.TimeRested > m_sStateData.MinimumRestingTime &&
-      m_pcRNG->Uniform(m_sStateData.ProbRange) < m_sStateData.RestToExploreProb) {
-      m_pcLEDs->SetAllColors(CColor::GREEN);
-      m_sStateData.State = SStateData::STATE_EXPLORING;
-      m_sStateData.TimeRested = 0;
-   }
-   else {
-      ++m_sStateData.TimeRested;
-      /* Be sure not to send the last exploration result multiple times */
-      if(m_sStateData.TimeRested == 1) {
-         m_pcRABA->SetData(0, LAST_EXPLORATION_NONE);
-      }
-      /*
-       * Social rule: listen to what other people have found and modify
-       * probabilities accordingly
-       */
-      const CCI_RangeAndBearingSensor::TReadings& tPackets = m_pcRABS->GetReadings();
-      for(size_t i = 0; i < tPackets.size(); ++i) {
-         switch(tPackets[i].Data[0]) {
-            case LAST_EXPLORATION_SUCCESSFUL: {
-               m_sStateData.RestToExploreProb += m_sStateData.SocialRuleRestToExploreDeltaProb;
-               m_sStateData.ProbRange.TruncValue(m_sStateData.RestToExploreProb);
-               m_sStateData.ExploreToRestProb -= m_sStateData.SocialRuleExploreToRestDeltaProb;
-               m_sStateData.ProbRange.TruncValue(m_sStateData.ExploreToRestProb);
-               break;
-            }
-            case LAST_EXPLORATION_UNSUCCESSFUL: {
-               m_sStateData.ExploreToRestProb += m_sStateData.SocialRuleExploreToRestDeltaProb;
-               m_sStateData.ProbRange.TruncValue(m_sStateData.ExploreToRestProb);
-               m_sStateData.RestToExploreProb -= m_sStateData.SocialRuleRestToExploreDeltaProb;
-               m_sStateData.ProbRange.TruncValue(m_sStateData.RestToExploreProb);
-               break;
-            }
-         }
-      }
-   }
-}
-
-/****************************************/
-/****************************************/
-
-void CFootBotForaging::Explore() {
-   /* We switch to 'return to nest' in two situations:
-    * 1. if we have a food item
-    * 2. if we have not found a food item for some time;
-    *    in this case, the switch is probabilistic
-    */
-   bool bReturnToNest(false);
-   /*
-    * Test the first condition: have we found a food item?
-    * NOTE: the food data is updated by the loop functions, so
-    * here we just need to read it
-    */
-   if(m_sFoodData.HasFoodItem) {
-      /* Apply the food rule, decreasing ExploreToRestProb and increasing
-       * RestToExploreProb */
-      m_sStateData.ExploreToRestProb -= m_sStateData.FoodRuleExploreToRestDeltaProb;
-      m_sStateData.ProbRange.TruncValue(m_sStateData.ExploreToRestProb);
-      m_sStateData.RestToExploreProb += m_sStateData.FoodRuleRestToExploreDeltaProb;
-      m_sStateData.ProbRange.TruncValue(m_sStateData.RestToExploreProb);
-      /* Store the result of the expedition */
-      m_eLastExplorationResult = LAST_EXPLORATION_SUCCESSFUL;
-      /* Switch to 'return to nest' */
-      bReturnToNest = true;
-   }
-   /* Test the second condition: we probabilistically switch to 'return to
-    * nest' if we have been wandering for some time and found nothing */
-   else if(m_sStateData.TimeExploringUnsuccessfully > m_sStateData.MinimumUnsuccessfulExploreTime) {
-      if (m_pcRNG->Uniform(m_sStateData.ProbRange) < m_sStateData.ExploreToRestProb) {
-         /* Store the result of the expedition */
-         m_eLastExplorationResult = LAST_EXPLORATION_UNSUCCESSFUL;
-         /* Switch to 'return to nest' */
-         bReturnToNest = true;
-      }
-      else {
-         /* Apply the food rule, increasing ExploreToRestProb and
-          * decreasing RestToExploreProb */
-         m_sStateData.ExploreToRestProb += m_sStateData.FoodRuleExploreToRestDeltaProb;
-         m_sStateData.ProbRange.TruncValue(m_sStateData.ExploreToRestProb);
-         m_sStateData.RestToExploreProb -= m_sStateData.FoodRuleRestToExploreDeltaProb;
-         m_sStateData.ProbRange.TruncValue(m_sStateData.RestToExploreProb);
-      }
-   }
-   /* So, do we return to the nest now? */
-   if(bReturnToNest) {
-      /* Yes, we do! */
-      m_sStateData.TimeExploringUnsuccessfully = 0;
-      m_sStateData.TimeSearchingForPlaceInNest = 0;
-      m_pcLEDs->SetAllColors(CColor::BLUE);
-      m_sStateData.State = SStateData::STATE_RETURN_TO_NEST;
-   }
-
-   else {
-      /* No, perform the actual exploration */
-      ++m_sStateData.TimeExploringUnsuccessfully;
-      UpdateState();
-      /* Get the diffusion vector to perform obstacle avoidance */
-      bool bCollision;
-      CVector2 cDiffusion = DiffusionVector(bCollision);
-      /* Apply the collision rule, if a collision avoidance happened */
-      if(bCollision) {
-         /* Collision avoidance happened, increase ExploreToRestProb and
-          * decrease RestToExploreProb */
-         m_sStateData.ExploreToRestProb += m_sStateData.CollisionRuleExploreToRestDeltaProb;
-         m_sStateData.ProbRange.TruncValue(m_sStateData.ExploreToRestProb);
-         m_sStateData.RestToExploreProb -= m_sStateData.CollisionRuleExploreToRestDeltaProb;
-         m_sStateData.ProbRange.TruncValue(m_sStateData.RestToExploreProb);
-      }
-      /*
-       * If we are in the nest, we combine antiphototaxis with obstacle
-       * avoidance
-       * Outside the nest, we just use the diffusion vector
-       */
-      if(m_sStateData.InNest) {
-         /*
-          * The vector returned by CalculateVectorToLight() points to
-          * the light. Thus, the minus sign is because we want to go away
-          * from the light.
-          */
-         SetWheelSpeedsFromVector(
-            m_sWheelTurningParams.MaxSpeed * cDiffusion -
-            m_sWheelTurningParams.MaxSpeed * 0.25f * CalculateVectorToLight());
-      }
-      else {
-         /* Use the diffusion vector only */
-         SetWheelSpeedsFromVector(m_sWheelTurningParams.MaxSpeed * cDiffusion);
-      }
-   }
-}
-
-/****************************************/
-/****************************************/
-
-void CFootBotForaging::LineFollow() {
-
-    /* We switch to 'return to nest' if we have a food item*/
-    bool bReturnToNest(false);
-    /*
-     * Test the first condition: have we found a food item?
-     * NOTE: the food data is updated by the loop functions, so
-     * here we just need to read it
-     */
-    if(m_sFoodData.HasFoodItem) {
-        /* Apply the food rule, decreasing ExploreToRestProb and increasing
-         * RestToExploreProb */
-        m_sStateData.ExploreToRestProb -= m_sStateData.FoodRuleExploreToRestDeltaProb;
-        m_sStateData.ProbRange.TruncValue(m_sStateData.ExploreToRestProb);
-        m_sStateData.RestToExploreProb += m_sStateData.FoodRuleRestToExploreDeltaProb;
-        m_sStateData.ProbRange.TruncValue(m_sStateData.RestToExploreProb);
-        /* Store the result of the expedition */
-        m_eLastExplorationResult = LAST_EXPLORATION_SUCCESSFUL;
-        /* Switch to 'return to nest' */
-        bReturnToNest = true;
-    }
-    /* So, do we return to the nest now? */
-    if(bReturnToNest) {
-        /* Yes, we do! */
-        m_sStateData.TimeExploringUnsuccessfully = 0;
-        m_sStateData.TimeSearchingForPlaceInNest = 0;
-        m_pcLEDs->SetAllColors(CColor::BLUE);
-        m_sStateData.State = SStateData::STATE_RETURN_TO_NEST;
-    }
-    else {
-        /* No, perform the actual line following */
-        ++m_sStateData.TimeExploringUnsuccessfully;
-        UpdateState();
-        /* Get the diffusion vector to perform obstacle avoidance */
-        bool bCollision;
-        CVector2 cDiffusion = DiffusionVector(bCollision);
-        /*
-         * If we are in the nest, we combine antiphototaxis with obstacle
-         * avoidance
-         * Outside the nest, we just use the diffusion vector
-         */
-        if(m_sStateData.InNest) {
-            /*
-             * The vector returned by CalculateVectorToLight() points to
-             * the light. Thus, the minus sign is because we want to go away
-             * from the light.
-             */
-            SetWheelSpeedsFromVector(
-                    m_sWheelTurningParams.MaxSpeed * cDiffusion -
-                    m_sWheelTurningParams.MaxSpeed * 0.25f * CalculateVectorToLight());
-        }
-        else {
-
-            /* Use the diffusion vector only */
-
-//            RLOG << "Actually line following\n";
-
-            //indicate the agent is following the line
-            m_pcLEDs->SetAllColors(CColor::YELLOW);
-
-
-            //drive straight
-            if (m_sStateData.DriveRight && m_sStateData.DriveLeft){
-                m_pcWheels->SetLinearVelocity(m_sWheelTurningParams.MaxSpeed/2.0, m_sWheelTurningParams.MaxSpeed/2.0);
-            }
-            //drive right
-            else if (m_sStateData.DriveRight){
-                m_pcWheels->SetLinearVelocity(m_sWheelTurningParams.MaxSpeed, 0.0);
-            }
-            //drive straight
-            else if (m_sStateData.DriveLeft){
-                m_pcWheels->SetLinearVelocity(0.0, m_sWheelTurningParams.MaxSpeed);
-            }
-
-        }
-    }
-}
-
-/****************************************/
-/****************************************/
-
-void CFootBotForaging::ReturnToNest() {
-   /* As soon as you get to the nest, switch to 'resting' */
-   UpdateState();
-   /* Are we in the nest? */
-   if(m_sStateData.InNest) {
-      /* Have we looked for a place long enough? */
-      if(m_sStateData.TimeSearchingForPlaceInNest > m_sStateData.MinimumSearchForPlaceInNestTime) {
-         /* Yes, stop the wheels... */
-         m_pcWheels->SetLinearVelocity(0.0f, 0.0f);
-         /* Tell people about the last exploration attempt */
-         m_pcRABA->SetData(0, m_eLastExplorationResult);
-         /* ... and switch to state 'resting' */
-         m_pcLEDs->SetAllColors(CColor::RED);
-         m_sStateData.State = SStateData::STATE_RESTING;
-         m_sStateData.TimeSearchingForPlaceInNest = 0;
-         m_eLastExplorationResult = LAST_EXPLORATION_NONE;
-         return;
-      }
-      else {
-         /* No, keep looking */
-         ++m_sStateData.TimeSearchingForPlaceInNest;
-      }
-   }
-   else {
-      /* Still outside the nest */
-      m_sStateData.TimeSearchingForPlaceInNest = 0;
-   }
-   /* Keep going */
-   bool bCollision;
-   SetWheelSpeedsFromVector(
-      m_sWheelTurningParams.MaxSpeed * DiffusionVector(bCollision) +
-      m_sWheelTurningParams.MaxSpeed * CalculateVectorToLight());
-}
-/****************************************/
-/****************************************/
-
 /*
  * This statement notifies ARGoS of the existence of the controller.
  * It binds the class passed as first argument to the string passed as
@@ -679,5 +531,12 @@ void CFootBotForaging::ReturnToNest() {
  * When ARGoS reads that string in the XML file, it knows which controller
  * class to instantiate.
  * See also the XML configuration files for an example of how this is used.
+ * Each behaviour variant (see footbot_foraging_variant.h) is registered
+ * under its own name.
  */
-REGISTER_CONTROLLER(CFootBotForaging, "footbot_foraging_controller")
+REGISTER_CONTROLLER(CFootBotForagingDefault,         "footbot_foraging_controller")
+REGISTER_CONTROLLER(CFootBotForagingNoTrail,         "footbot_foraging_no_trail_controller")
+REGISTER_CONTROLLER(CFootBotForagingProportional,    "footbot_foraging_proportional_controller")
+REGISTER_CONTROLLER(CFootBotForagingAsocial,         "footbot_foraging_asocial_controller")
+REGISTER_CONTROLLER(CFootBotForagingNoCollisionRule, "footbot_foraging_no_collision_rule_controller")
+REGISTER_CONTROLLER(CFootBotForagingBulletin,        "footbot_foraging_bulletin_controller")
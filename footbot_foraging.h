@@ -29,8 +29,12 @@
 #include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_light_sensor.h>
 /* Definition of the foot-bot motor ground sensor */
 #include <argos3/plugins/robots/foot-bot/control_interface/ci_footbot_motor_ground_sensor.h>
+/* Definition of the homing sensor */
+#include "ci_homing_sensor.h"
 /* Definitions for random number generation */
 #include <argos3/core/utility/math/rng.h>
+/* Shared parameter blocks */
+#include <memory>
 
 /*
  * All the ARGoS stuff in the 'argos' namespace.
@@ -40,9 +44,16 @@ using namespace argos;
 
 /*
  * A controller is simply an implementation of the CCI_Controller class.
+ *
+ * This class holds what all the behaviour variants have in common; the
+ * state machine is implemented by CFootBotForagingVariant
+ * (footbot_foraging_variant.h), templated on the behaviour policies.
  */
 class CFootBotForaging : public CCI_Controller {
 
+   /* The batched engine works directly on the sensors and parameters */
+   friend class CForagingSwarmEngine;
+
 public:
 
    /*
@@ -53,6 +64,17 @@ public:
       size_t FoodItemIdx;    // the index of the current food item in the array of available food items
       size_t TotalFoodItems; // the total number of food items carried by this robot during the experiment
 
+      /* Metrics of the current trip, from leaving the nest to coming back.
+         They are updated by the loop functions, except LineFollowingTicks
+         which is counted by the controller. */
+      bool OnTrip;               // true while the robot is out of the nest
+      UInt32 TripStart;          // step at which the robot left the nest
+      UInt32 PickupTick;         // step at which the robot picked up its food item
+      Real TripDistance;         // distance travelled since leaving the nest
+      CVector2 LastPosition;     // position at the last step, for the distance
+      UInt32 LineFollowingTicks; // steps spent following the line
+      bool FoundViaTrail;        // true if the robot followed the line before the pickup
+
       SFoodData();
       void Reset();
    };
@@ -96,12 +118,12 @@ public:
        * The turning mechanism.
        * The robot can be in three different turning states.
        */
-      enum ETurningMechanism
+      enum ETurningMechanism : UInt8
       {
          NO_TURN = 0, // go straight
          SOFT_TURN,   // both wheels are turning forwards, but at different speeds
          HARD_TURN    // wheels are turning with opposite speeds
-      } TurningMechanism;
+      };
       /*
        * Angular thresholds to change turning state.
        */
@@ -115,35 +137,16 @@ public:
    };
 
    /*
-    * Contains all the state information about the controller.
+    * The parameters of the state machine. You can set their value
+    * in the <parameters> section of the XML configuration file, under the
+    * <controllers><footbot_foraging_controller><parameters><state>
+    * section.
     */
-   struct SStateData {
-      /* The three possible states in which the controller can be */
-      enum EState {
-         STATE_RESTING = 0,
-         STATE_EXPLORING,
-         STATE_LINE_FOLLOWING,
-         STATE_RETURN_TO_NEST
-      } State;
-
-      /* True when the robot is in the nest */
-      bool InNest;
-
-      bool FollowingLine = false;
-      bool DriveLeft = false;
-      bool DriveRight = false;
-//      int FollowLineDecay = 2; //if you change this you also have to change it in the header file
-
-      bool DepositPheromones = false;
-
+   struct SStateParams {
       /* Initial probability to switch from resting to exploring */
       Real InitialRestToExploreProb;
-      /* Current probability to switch from resting to exploring */
-      Real RestToExploreProb;
       /* Initial probability to switch from exploring to resting */
       Real InitialExploreToRestProb;
-      /* Current probability to switch from exploring to resting */
-      Real ExploreToRestProb;
       /* Used as a range for uniform number generation */
       CRange<Real> ProbRange;
       /* The increase of ExploreToRestProb due to the food rule */
@@ -159,13 +162,9 @@ public:
       /* The minimum number of steps in resting state before the robots
          starts thinking that it's time to move */
       size_t MinimumRestingTime;
-      /* The number of steps in resting state */
-      size_t TimeRested;
       /* The number of exploration steps without finding food after which
          a foot-bot starts thinking about going back to the nest */
       size_t MinimumUnsuccessfulExploreTime;
-      /* The number of exploration steps without finding food */
-      size_t TimeExploringUnsuccessfully;
       /* If the robots switched to resting as soon as it enters the nest,
          there would be overcrowding of robots in the border between the
          nest and the rest of the arena. To overcome this issue, the robot
@@ -174,11 +173,98 @@ public:
          robot must spend in state 'return to nest' looking for a place in
          the nest before switching to the resting state. */
       size_t MinimumSearchForPlaceInNestTime;
+
+      SStateParams();
+      void Init(TConfigurationNode& t_node);
+   };
+
+   /*
+    * All the parameters of the controller. They are parsed once per
+    * controller configuration (the id of the
+    * <footbot_foraging_controller> node) and shared, read-only, by all the
+    * robots using that configuration.
+    */
+   struct SParams {
+      SDiffusionParams Diffusion;
+      SWheelTurningParams WheelTurning;
+      SStateParams State;
+      /* True to run the robots in the swarm engine */
+      bool Batched;
+      /* True to skip the resting robots until something can happen */
+      bool Sleep;
+
+      SParams();
+      void Init(TConfigurationNode& t_node);
+   };
+
+   /*
+    * Contains all the state information about the controller.
+    * This is what changes at every step: it is kept small and packed, in
+    * 48 bytes. It is not aligned, so it may straddle two cache lines.
+    */
+   struct SStateData {
+      /* The four possible states in which the controller can be */
+      enum EState : UInt8 {
+         STATE_RESTING = 0,
+         STATE_EXPLORING,
+         STATE_LINE_FOLLOWING,
+         STATE_RETURN_TO_NEST
+      } State;
+
+      /* The current turning state of the wheels */
+      SWheelTurningParams::ETurningMechanism TurningMechanism;
+
+      /* True when the robot is in the nest */
+      bool InNest;
+
+      bool FollowingLine;
+      bool DriveLeft;
+      bool DriveRight;
+
+      /* Current probability to switch from resting to exploring */
+      Real RestToExploreProb;
+      /* Current probability to switch from exploring to resting */
+      Real ExploreToRestProb;
+      /* The number of steps in resting state */
+      UInt32 TimeRested;
+      /* The number of exploration steps without finding food */
+      UInt32 TimeExploringUnsuccessfully;
       /* The time spent searching for a place in the nest */
-      size_t TimeSearchingForPlaceInNest;
+      UInt32 TimeSearchingForPlaceInNest;
+      /* Sleeping resting robots: the step at which the robot fell asleep,
+         and the step at which it leaves the resting state; while asleep,
+         TimeRested is not updated. WakeTick is zero when awake. */
+      UInt32 SleepTick;
+      UInt32 WakeTick;
 
       SStateData();
-      void Init(TConfigurationNode& t_node);
+      void Reset(const SStateParams& s_params);
+   };
+
+   /*
+    * Used in the social rule to communicate the result of the last
+    * exploration attempt.
+    */
+   enum ELastExplorationResult {
+      LAST_EXPLORATION_NONE = 0,    // nothing to report
+      LAST_EXPLORATION_SUCCESSFUL,  // the last exploration resulted in a food item found
+      LAST_EXPLORATION_UNSUCCESSFUL // no food found in the last exploration
+   };
+
+   /*
+    * The mailbox of the robot on the nest bulletin board (see
+    * nest_bulletin.h). The robot writes Posted like it would set its range
+    * and bearing data; the loop functions fill in the results posted
+    * around the robot at the previous step. With the range and bearing
+    * social rule, Posted keeps what the robot broadcasts, for the
+    * checkpoints.
+    */
+   struct SBulletin {
+      UInt8 Posted;
+      UInt32 HeardSuccessful;
+      UInt32 HeardUnsuccessful;
+
+      SBulletin();
       void Reset();
    };
 
@@ -196,12 +282,6 @@ public:
     */
    virtual void Init(TConfigurationNode& t_node);
 
-   /*
-    * This function is called once every time step.
-    * The length of the time step is set in the XML file.
-    */
-   virtual void ControlStep();
-
    /*
     * This function resets the controller to its state right after the
     * Init().
@@ -211,11 +291,9 @@ public:
 
    /*
     * Called to cleanup what done by Init() when the experiment finishes.
-    * In this example controller there is no need for clean anything up,
-    * so the function could have been omitted. It's here just for
-    * completeness.
+    * In batched mode, it removes the robot from the swarm engine.
     */
-   virtual void Destroy() {}
+   virtual void Destroy();
 
    /*
     * Returns true if the robot is currently exploring.
@@ -238,6 +316,13 @@ public:
       return m_sStateData.State == SStateData::STATE_RETURN_TO_NEST;
    }
 
+   /*
+    * Returns the current state.
+    */
+   inline SStateData::EState GetState() const {
+      return m_sStateData.State;
+   }
+
    /*
     * Returns the food data
     */
@@ -245,57 +330,108 @@ public:
       return m_sFoodData;
    }
 
-private:
+   /*
+    * Sets the index of the robot in the event log (see
+    * foraging_event_log.h).
+    */
+   inline void SetEventId(UInt32 un_id) {
+      m_unEventId = un_id;
+   }
+
+   /*
+    * Returns the index of the robot in the event log.
+    */
+   inline UInt32 GetEventId() const {
+      return m_unEventId;
+   }
 
    /*
-    * Updates the state information.
-    * In pratice, it sets the SStateData::InNest flag.
-    * Future, more complex implementations should add their
-    * state update code here.
+    * Returns the mailbox on the nest bulletin board
     */
-   void UpdateState();
+   inline SBulletin& GetBulletin() {
+      return m_sBulletin;
+   }
 
    /*
-    * Calculates the vector to the light. Used to perform
-    * phototaxis and antiphototaxis.
+    * Returns true if the social rule uses the nest bulletin board.
     */
-   CVector2 CalculateVectorToLight();
+   virtual bool UsesBulletin() const = 0;
 
    /*
-    * Calculates the diffusion vector. If there is a close obstacle,
-    * it points away from it; it there is none, it points forwards.
-    * The b_collision parameter is used to return true or false whether
-    * a collision avoidance just happened or not. It is necessary for the
-    * collision rule.
+    * Writes the per-robot experiment state (state machine, sleep,
+    * turning state, food data, last exploration result, the result being
+    * told and the wheel speeds) into a checkpoint.
+    * Parameters coming from the XML file are not saved, so that a restored
+    * run can use different ones.
+    * The random number generator is reseeded with a fresh seed that is
+    * saved too: from here on, the saving run and every run restored from
+    * this checkpoint draw the same numbers, as long as the robots take
+    * the same decisions.
     */
-   CVector2 DiffusionVector(bool& b_collision);
+   void SaveState(std::ostream& c_out);
 
    /*
-    * Gets a direction vector as input and transforms it into wheel
-    * actuation.
+    * Restores what SaveState() wrote.
     */
-   void SetWheelSpeedsFromVector(const CVector2& c_heading);
+   void LoadState(std::istream& c_in);
+
+protected:
+
+   /*
+    * Executes the current state. Called by ControlStep(), or by the swarm
+    * engine in batched mode.
+    */
+   virtual void ExecuteState() = 0;
+
+   /*
+    * Returns true if the swarm engine can drive this variant.
+    */
+   virtual bool SupportsBatching() const = 0;
+
+   /*
+    * Returns the parameters for the controller configuration t_node
+    * belongs to, parsing them only for the first robot that asks.
+    */
+   static std::shared_ptr<const SParams> GetSharedParams(TConfigurationNode& t_node);
+
+   /*
+    * Adds a state change to the event log.
+    */
+   void LogStateChange(SStateData::EState e_from);
+
+   /*
+    * Calculates the vector to the light. Used to perform
+    * phototaxis and antiphototaxis.
+    */
+   CVector2 CalculateVectorToLight();
 
    /*
-    * Executes the resting state.
+    * Calculates the vector to follow to go back to the nest: the one of
+    * the homing sensor, which leads around the obstacles, if the robot
+    * has the sensor and it gives a direction; the vector to the light
+    * otherwise.
     */
-   void Rest();
+   CVector2 CalculateVectorToNest();
 
    /*
-    * Executes the exploring state.
+    * Calculates the diffusion vector. If there is a close obstacle,
+    * it points away from it; it there is none, it points forwards.
+    * The b_collision parameter is used to return true or false whether
+    * a collision avoidance just happened or not. It is necessary for the
+    * collision rule.
     */
-   void Explore();
+   CVector2 DiffusionVector(bool& b_collision);
 
-    /*
-     * Executes the line following state.
-     */
-    void LineFollow();
    /*
-    * Executes the return to nest state.
+    * Sets the wheel speeds, remembering them for the checkpoints.
     */
-   void ReturnToNest();
+   inline void SetWheelSpeeds(Real f_left, Real f_right) {
+      m_fLeftWheelSpeed = f_left;
+      m_fRightWheelSpeed = f_right;
+      m_pcWheels->SetLinearVelocity(f_left, f_right);
+   }
 
-private:
+protected:
 
    /* Pointer to the differential steering actuator */
    CCI_DifferentialSteeringActuator* m_pcWheels;
@@ -311,26 +447,34 @@ private:
    CCI_FootBotLightSensor* m_pcLight;
    /* Pointer to the foot-bot motor ground sensor */
    CCI_FootBotMotorGroundSensor* m_pcGround;
+   /* Pointer to the homing sensor, NULL if the configuration has none */
+   CCI_HomingSensor* m_pcHoming;
 
    /* The random number generator */
    CRandom::CRNG* m_pcRNG;
 
    /* Used in the social rule to communicate the result of the last
     * exploration attempt */
-   enum ELastExplorationResult {
-      LAST_EXPLORATION_NONE = 0,    // nothing to report
-      LAST_EXPLORATION_SUCCESSFUL,  // the last exploration resulted in a food item found
-      LAST_EXPLORATION_UNSUCCESSFUL // no food found in the last exploration
-   } m_eLastExplorationResult;
+   ELastExplorationResult m_eLastExplorationResult;
 
    /* The controller state information */
    SStateData m_sStateData;
-   /* The turning parameters */
-   SWheelTurningParams m_sWheelTurningParams;
-   /* The diffusion parameters */
-   SDiffusionParams m_sDiffusionParams;
+   /* The parameters, shared with the other robots of the same configuration */
+   std::shared_ptr<const SParams> m_psParams;
    /* The food data */
    SFoodData m_sFoodData;
+   /* The mailbox on the nest bulletin board */
+   SBulletin m_sBulletin;
+   /* The last wheel speeds, which the actuator applies at the next step */
+   Real m_fLeftWheelSpeed;
+   Real m_fRightWheelSpeed;
+
+   /* True when the robot is driven by the swarm engine */
+   bool m_bBatched;
+   /* The slot of the robot in the swarm engine */
+   UInt32 m_unBatchSlot;
+   /* Index of the robot in the event log */
+   UInt32 m_unEventId;
 
 };
 
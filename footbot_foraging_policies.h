@@ -0,0 +1,397 @@
+/*
+ * Behaviour policies of the foot-bot foraging controller.
+ *
+ * CFootBotForagingVariant (footbot_foraging_variant.h) is templated on one
+ * policy of each kind: trail following, turning, social rule and collision
+ * rule. A policy is a struct of static inline functions, and all the
+ * policies of a kind have the same interface, so each variant is compiled
+ * with only the behaviours it uses and no runtime switch between them.
+ */
+
+#ifndef FOOTBOT_FORAGING_POLICIES_H
+#define FOOTBOT_FORAGING_POLICIES_H
+
+#include "footbot_foraging.h"
+#include <atomic>
+
+/****************************************/
+/****************************************/
+
+/*
+ * Trail following policies.
+ *
+ * Detect() is called by every state update, with the motor ground
+ * readings; it sets the FollowingLine, DriveLeft and DriveRight flags and
+ * may switch the robot to STATE_LINE_FOLLOWING.
+ * Drive() computes the wheel speeds while following the trail, returning
+ * false when the trail gives no direction.
+ */
+
+/* Follows the yellow line painted on the floor */
+struct SLineTrail {
+
+   static inline void Detect(const CCI_FootBotMotorGroundSensor::TReadings& t_ground,
+                             CFootBotForaging::SStateData& s_state) {
+      /* The line is yellow, 0.886 on the ground sensor */
+      const Real fYellowLowerBound = 0.81;
+      const Real fYellowUpperBound = 0.91;
+      /* Robots going home ignore the line */
+      if(s_state.State == CFootBotForaging::SStateData::STATE_RETURN_TO_NEST) return;
+      bool bOnLine[4];
+      for(size_t i = 0; i < 4; ++i) {
+         bOnLine[i] = (t_ground[i].Value > fYellowLowerBound &&
+                       t_ground[i].Value < fYellowUpperBound);
+      }
+      if(bOnLine[0] || bOnLine[1] || bOnLine[2] || bOnLine[3]) {
+         /* Time to follow the line */
+         s_state.FollowingLine = true;
+         s_state.State = CFootBotForaging::SStateData::STATE_LINE_FOLLOWING;
+         /* Sensors 0 and 3 are on the left, 1 and 2 on the right; if
+            both sides see the line, the robot drives straight */
+         s_state.DriveLeft  = bOnLine[0] || bOnLine[3];
+         s_state.DriveRight = bOnLine[1] || bOnLine[2];
+      }
+   }
+
+   static inline bool Drive(const CFootBotForaging::SStateData& s_state,
+                            Real f_max_speed,
+                            Real& f_left,
+                            Real& f_right) {
+      if(s_state.DriveRight && s_state.DriveLeft) {
+         /* Drive straight */
+         f_left  = f_max_speed / 2.0;
+         f_right = f_max_speed / 2.0;
+      }
+      else if(s_state.DriveRight) {
+         /* Drive right */
+         f_left  = f_max_speed;
+         f_right = 0.0;
+      }
+      else if(s_state.DriveLeft) {
+         /* Drive left */
+         f_left  = 0.0;
+         f_right = f_max_speed;
+      }
+      else {
+         return false;
+      }
+      return true;
+   }
+
+};
+
+/* Ignores the trail: the robots never enter line following */
+struct SNoTrail {
+
+   static inline void Detect(const CCI_FootBotMotorGroundSensor::TReadings&,
+                             CFootBotForaging::SStateData&) {}
+
+   static inline bool Drive(const CFootBotForaging::SStateData&,
+                            Real, Real&, Real&) {
+      return false;
+   }
+
+};
+
+/****************************************/
+/****************************************/
+
+/*
+ * Turning policies.
+ *
+ * WheelSpeeds() turns a heading into wheel speeds, updating the turning
+ * mechanism of the robot if the policy uses one.
+ * BATCHABLE tells whether the swarm engine, which implements
+ * SThreeStateTurning, can drive the variant.
+ */
+
+/* No turn, soft turn and hard turn, with hysteresis between them */
+struct SThreeStateTurning {
+
+   static const bool BATCHABLE = true;
+
+   static inline void WheelSpeeds(const CFootBotForaging::SWheelTurningParams& s_params,
+                                  CFootBotForaging::SWheelTurningParams::ETurningMechanism& e_mechanism,
+                                  const CVector2& c_heading,
+                                  Real& f_left,
+                                  Real& f_right) {
+      typedef CFootBotForaging::SWheelTurningParams SParams;
+      /* Get the heading angle */
+      CRadians cHeadingAngle = c_heading.Angle().SignedNormalize();
+      CRadians cAbsAngle = Abs(cHeadingAngle);
+      /* Clamp the speed so that it's not greater than MaxSpeed */
+      Real fBaseAngularWheelSpeed = Min<Real>(c_heading.Length(), s_params.MaxSpeed);
+      /* State transition logic */
+      if(e_mechanism == SParams::HARD_TURN) {
+         if(cAbsAngle <= s_params.SoftTurnOnAngleThreshold) {
+            e_mechanism = SParams::SOFT_TURN;
+         }
+      }
+      if(e_mechanism == SParams::SOFT_TURN) {
+         if(cAbsAngle > s_params.HardTurnOnAngleThreshold) {
+            e_mechanism = SParams::HARD_TURN;
+         }
+         else if(cAbsAngle <= s_params.NoTurnAngleThreshold) {
+            e_mechanism = SParams::NO_TURN;
+         }
+      }
+      if(e_mechanism == SParams::NO_TURN) {
+         if(cAbsAngle > s_params.HardTurnOnAngleThreshold) {
+            e_mechanism = SParams::HARD_TURN;
+         }
+         else if(cAbsAngle > s_params.NoTurnAngleThreshold) {
+            e_mechanism = SParams::SOFT_TURN;
+         }
+      }
+      /* Wheel speeds based on current turning state */
+      Real fSpeed1, fSpeed2;
+      if(e_mechanism == SParams::NO_TURN) {
+         /* Just go straight */
+         fSpeed1 = fBaseAngularWheelSpeed;
+         fSpeed2 = fBaseAngularWheelSpeed;
+      }
+      else if(e_mechanism == SParams::SOFT_TURN) {
+         /* Both wheels go straight, but one is faster than the other */
+         Real fSpeedFactor = (s_params.HardTurnOnAngleThreshold - cAbsAngle) / s_params.HardTurnOnAngleThreshold;
+         fSpeed1 = fBaseAngularWheelSpeed - fBaseAngularWheelSpeed * (1.0 - fSpeedFactor);
+         fSpeed2 = fBaseAngularWheelSpeed + fBaseAngularWheelSpeed * (1.0 - fSpeedFactor);
+      }
+      else {
+         /* Opposite wheel speeds */
+         fSpeed1 = -s_params.MaxSpeed;
+         fSpeed2 =  s_params.MaxSpeed;
+      }
+      /* Turn left for positive angles, right otherwise */
+      if(cHeadingAngle > CRadians::ZERO) {
+         f_left  = fSpeed1;
+         f_right = fSpeed2;
+      }
+      else {
+         f_left  = fSpeed2;
+         f_right = fSpeed1;
+      }
+   }
+
+};
+
+/*
+ * Stateless turning: the difference between the wheel speeds grows
+ * linearly with the heading angle, up to turning on the spot at the hard
+ * turn threshold.
+ */
+struct SProportionalTurning {
+
+   static const bool BATCHABLE = false;
+
+   static inline void WheelSpeeds(const CFootBotForaging::SWheelTurningParams& s_params,
+                                  CFootBotForaging::SWheelTurningParams::ETurningMechanism&,
+                                  const CVector2& c_heading,
+                                  Real& f_left,
+                                  Real& f_right) {
+      CRadians cHeadingAngle = c_heading.Angle().SignedNormalize();
+      Real fBaseAngularWheelSpeed = Min<Real>(c_heading.Length(), s_params.MaxSpeed);
+      Real fTurn = cHeadingAngle / s_params.HardTurnOnAngleThreshold;
+      if(fTurn >  1.0) fTurn =  1.0;
+      if(fTurn < -1.0) fTurn = -1.0;
+      /* Positive angles turn left */
+      f_left  = fBaseAngularWheelSpeed * (1.0 - 2.0 * Max<Real>(fTurn, 0.0));
+      f_right = fBaseAngularWheelSpeed * (1.0 + 2.0 * Min<Real>(fTurn, 0.0));
+   }
+
+};
+
+/****************************************/
+/****************************************/
+
+/*
+ * Social rule policies.
+ *
+ * Listen() is called by the resting robots to update their probabilities
+ * from what the others report; Tell() broadcasts the result of the last
+ * exploration at the given step.
+ * HasNews() tells the sleeping robots whether Listen() could find anything
+ * at the given step; if it returns false, they are not woken up.
+ * BULLETIN tells the loop functions whether the robots use the nest
+ * bulletin board.
+ */
+
+/*
+ * The last step at which any robot told a result, shared by the channels
+ * that can wake sleeping robots. A result told at step t is received at
+ * step t+1, and the robot stops telling it at step t+1 too.
+ */
+struct SResultStamp {
+
+   static inline void Record(UInt8 un_result, UInt32 un_tick) {
+      if(un_result != CFootBotForaging::LAST_EXPLORATION_NONE) {
+         Tick().store(un_tick, std::memory_order_relaxed);
+      }
+   }
+
+   static inline bool HasNews(UInt32 un_tick) {
+      UInt32 unTold = Tick().load(std::memory_order_relaxed);
+      return unTold == un_tick || unTold + 1 == un_tick;
+   }
+
+private:
+
+   static inline std::atomic<UInt32>& Tick() {
+      static std::atomic<UInt32> unTick(0);
+      return unTick;
+   }
+
+};
+
+/*
+ * Applies the social rule for un_successful successful and
+ * un_unsuccessful unsuccessful results.
+ */
+inline void ApplySocialRule(UInt32 un_successful,
+                            UInt32 un_unsuccessful,
+                            CFootBotForaging::SStateData& s_state,
+                            const CFootBotForaging::SStateParams& s_params) {
+   for(UInt32 i = 0; i < un_successful; ++i) {
+      s_state.RestToExploreProb += s_params.SocialRuleRestToExploreDeltaProb;
+      s_params.ProbRange.TruncValue(s_state.RestToExploreProb);
+      s_state.ExploreToRestProb -= s_params.SocialRuleExploreToRestDeltaProb;
+      s_params.ProbRange.TruncValue(s_state.ExploreToRestProb);
+   }
+   for(UInt32 i = 0; i < un_unsuccessful; ++i) {
+      s_state.ExploreToRestProb += s_params.SocialRuleExploreToRestDeltaProb;
+      s_params.ProbRange.TruncValue(s_state.ExploreToRestProb);
+      s_state.RestToExploreProb -= s_params.SocialRuleRestToExploreDeltaProb;
+      s_params.ProbRange.TruncValue(s_state.RestToExploreProb);
+   }
+}
+
+/* Exploration results travel on the range and bearing channel */
+struct SRABSocial {
+
+   static const bool BULLETIN = false;
+
+   static inline void Listen(const CCI_RangeAndBearingSensor& c_rabs,
+                             const CFootBotForaging::SBulletin&,
+                             CFootBotForaging::SStateData& s_state,
+                             const CFootBotForaging::SStateParams& s_params) {
+      const CCI_RangeAndBearingSensor::TReadings& tPackets = c_rabs.GetReadings();
+      for(size_t i = 0; i < tPackets.size(); ++i) {
+         switch(tPackets[i].Data[0]) {
+            case CFootBotForaging::LAST_EXPLORATION_SUCCESSFUL: {
+               ApplySocialRule(1, 0, s_state, s_params);
+               break;
+            }
+            case CFootBotForaging::LAST_EXPLORATION_UNSUCCESSFUL: {
+               ApplySocialRule(0, 1, s_state, s_params);
+               break;
+            }
+         }
+      }
+   }
+
+   static inline void Tell(CCI_RangeAndBearingActuator& c_raba,
+                           CFootBotForaging::SBulletin& s_bulletin,
+                           UInt8 un_result,
+                           UInt32 un_tick) {
+      c_raba.SetData(0, un_result);
+      /* Only for the checkpoints: the loop functions do not read it */
+      s_bulletin.Posted = un_result;
+      SResultStamp::Record(un_result, un_tick);
+   }
+
+   static inline bool HasNews(UInt32 un_tick) {
+      return SResultStamp::HasNews(un_tick);
+   }
+
+};
+
+/*
+ * Exploration results are posted on the nest bulletin board kept by the
+ * loop functions (see nest_bulletin.h), which count, for each resting
+ * robot, the results posted around it. Listening costs the same whatever
+ * the number of robots in the nest.
+ */
+struct SBulletinSocial {
+
+   static const bool BULLETIN = true;
+
+   static inline void Listen(const CCI_RangeAndBearingSensor&,
+                             const CFootBotForaging::SBulletin& s_bulletin,
+                             CFootBotForaging::SStateData& s_state,
+                             const CFootBotForaging::SStateParams& s_params) {
+      ApplySocialRule(s_bulletin.HeardSuccessful,
+                      s_bulletin.HeardUnsuccessful,
+                      s_state,
+                      s_params);
+   }
+
+   static inline void Tell(CCI_RangeAndBearingActuator&,
+                           CFootBotForaging::SBulletin& s_bulletin,
+                           UInt8 un_result,
+                           UInt32 un_tick) {
+      s_bulletin.Posted = un_result;
+      SResultStamp::Record(un_result, un_tick);
+   }
+
+   static inline bool HasNews(UInt32 un_tick) {
+      return SResultStamp::HasNews(un_tick);
+   }
+
+};
+
+/* The robots neither listen nor talk */
+struct SNoSocial {
+
+   static const bool BULLETIN = false;
+
+   static inline void Listen(const CCI_RangeAndBearingSensor&,
+                             const CFootBotForaging::SBulletin&,
+                             CFootBotForaging::SStateData&,
+                             const CFootBotForaging::SStateParams&) {}
+
+   static inline void Tell(CCI_RangeAndBearingActuator&,
+                           CFootBotForaging::SBulletin&,
+                           UInt8, UInt32) {}
+
+   static inline bool HasNews(UInt32) {
+      return false;
+   }
+
+};
+
+/****************************************/
+/****************************************/
+
+/*
+ * Collision rule policies.
+ *
+ * Apply() is called by the exploring robots after obstacle avoidance.
+ */
+
+/* Collisions make the robots more likely to rest */
+struct SCollisionRule {
+
+   static inline void Apply(bool b_collision,
+                            CFootBotForaging::SStateData& s_state,
+                            const CFootBotForaging::SStateParams& s_params) {
+      if(b_collision) {
+         /* Collision avoidance happened, increase ExploreToRestProb and
+          * decrease RestToExploreProb */
+         s_state.ExploreToRestProb += s_params.CollisionRuleExploreToRestDeltaProb;
+         s_params.ProbRange.TruncValue(s_state.ExploreToRestProb);
+         s_state.RestToExploreProb -= s_params.CollisionRuleExploreToRestDeltaProb;
+         s_params.ProbRange.TruncValue(s_state.RestToExploreProb);
+      }
+   }
+
+};
+
+/* Collisions do not change the probabilities */
+struct SNoCollisionRule {
+
+   static inline void Apply(bool,
+                            CFootBotForaging::SStateData&,
+                            const CFootBotForaging::SStateParams&) {}
+
+};
+
+#endif
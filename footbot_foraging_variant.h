@@ -0,0 +1,490 @@
+/*
+ * The foot-bot foraging controller, composed at compile time from one
+ * policy of each kind (see footbot_foraging_policies.h):
+ *
+ *    TRAIL     - trail following
+ *    TURNING   - conversion of headings into wheel speeds
+ *    SOCIAL    - social rule
+ *    COLLISION - collision rule
+ *
+ * CFootBotForaging holds the data, the sensors and actuators and all that
+ * is the same for every variant; this class implements the state machine.
+ * Each combination in use is registered under its own name at the end of
+ * footbot_foraging.cpp.
+ */
+
+#ifndef FOOTBOT_FORAGING_VARIANT_H
+#define FOOTBOT_FORAGING_VARIANT_H
+
+#include "footbot_foraging_policies.h"
+#include "foraging_swarm_engine.h"
+#include <argos3/core/utility/logging/argos_log.h>
+#include <argos3/core/simulator/simulator.h>
+#include <cmath>
+#include <limits>
+
+template <class TRAIL, class TURNING, class SOCIAL, class COLLISION>
+class CFootBotForagingVariant : public CFootBotForaging {
+
+public:
+
+   virtual ~CFootBotForagingVariant() {}
+
+   /*
+    * In batched mode, the swarm engine calls ExecuteState() instead.
+    */
+   virtual void ControlStep() {
+      if(!m_bBatched) {
+         Execute();
+      }
+   }
+
+protected:
+
+   virtual void ExecuteState() {
+      Execute();
+   }
+
+   virtual bool SupportsBatching() const {
+      return TURNING::BATCHABLE;
+   }
+
+public:
+
+   virtual bool UsesBulletin() const {
+      return SOCIAL::BULLETIN;
+   }
+
+private:
+
+   /* Executes the current state */
+   inline void Execute();
+
+   /*
+    * Updates the state information: the SStateData::InNest flag and the
+    * trail flags.
+    */
+   void UpdateState();
+
+   /*
+    * Gets a direction vector as input and transforms it into wheel
+    * actuation.
+    */
+   void SetWheelSpeedsFromVector(const CVector2& c_heading);
+
+   /* Executes the resting state */
+   void Rest();
+
+   /*
+    * Executes the resting state for a robot that may be asleep. The robot
+    * sleeps until the step at which it would leave the resting state,
+    * drawn in advance, or until another robot tells a result.
+    */
+   inline void RestOrSleep();
+
+   /*
+    * Draws the step at which a robot that has just rested leaves the
+    * resting state, if nothing changes its probability before.
+    */
+   void Sleep(UInt32 un_tick);
+
+   /* Returns the current simulation step */
+   inline UInt32 GetTick() const {
+      return CSimulator::GetInstance().GetSpace().GetSimulationClock();
+   }
+
+   /* Executes the exploring state */
+   void Explore();
+
+   /* Executes the line following state */
+   void LineFollow();
+
+   /* Executes the return to nest state */
+   void ReturnToNest();
+
+};
+
+/****************************************/
+/****************************************/
+
+template <class TRAIL, class TURNING, class SOCIAL, class COLLISION>
+void CFootBotForagingVariant<TRAIL, TURNING, SOCIAL, COLLISION>::Execute() {
+   typename SStateData::EState ePrevious = m_sStateData.State;
+   switch(m_sStateData.State) {
+      case SStateData::STATE_RESTING: {
+         if(m_psParams->Sleep) {
+            RestOrSleep();
+         }
+         else {
+            Rest();
+         }
+         break;
+      }
+      case SStateData::STATE_EXPLORING: {
+         Explore();
+         break;
+      }
+      case SStateData::STATE_LINE_FOLLOWING: {
+         LineFollow();
+         break;
+      }
+      case SStateData::STATE_RETURN_TO_NEST: {
+         ReturnToNest();
+         break;
+      }
+      default: {
+         LOGERR << "We can't be here, there's a bug!" << std::endl;
+      }
+   }
+   /* Trip metrics and events */
+   if(m_sStateData.State == SStateData::STATE_LINE_FOLLOWING) {
+      ++m_sFoodData.LineFollowingTicks;
+   }
+   if(m_sStateData.State != ePrevious) {
+      LogStateChange(ePrevious);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+template <class TRAIL, class TURNING, class SOCIAL, class COLLISION>
+void CFootBotForagingVariant<TRAIL, TURNING, SOCIAL, COLLISION>::UpdateState() {
+   /* Reset state flags */
+   m_sStateData.InNest = false;
+   m_sStateData.FollowingLine = false;
+   m_sStateData.DriveLeft = false;
+   m_sStateData.DriveRight = false;
+   /* Read stuff from the ground sensor */
+   const CCI_FootBotMotorGroundSensor::TReadings& tGroundReads = m_pcGround->GetReadings();
+   /*
+    * You can say whether you are in the nest by checking the ground sensor
+    * placed close to the wheel motors. It returns a value between 0 and 1.
+    * It is 1 when the robot is on a white area, it is 0 when the robot
+    * is on a black area and it is around 0.5 when the robot is on a gray
+    * area.
+    * The foot-bot has 4 sensors like this, two in the front
+    * (corresponding to readings 0 and 1) and two in the back
+    * (corresponding to reading 2 and 3).  Here we want the back sensors
+    * (readings 2 and 3) to tell us whether we are on gray: if so, the
+    * robot is completely in the nest, otherwise it's outside.
+    */
+   const Real fGrayLowerBound = 0.45;
+   const Real fGrayUpperBound = 0.55;
+   if(tGroundReads[2].Value > fGrayLowerBound &&
+      tGroundReads[2].Value < fGrayUpperBound &&
+      tGroundReads[3].Value > fGrayLowerBound &&
+      tGroundReads[3].Value < fGrayUpperBound) {
+      m_sStateData.InNest = true;
+   }
+   /* Look for the trail */
+   TRAIL::Detect(tGroundReads, m_sStateData);
+   /* Off the trail, go back to exploring */
+   if(!m_sStateData.FollowingLine && m_sStateData.State == SStateData::STATE_LINE_FOLLOWING) {
+      m_sStateData.State = SStateData::STATE_EXPLORING;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+template <class TRAIL, class TURNING, class SOCIAL, class COLLISION>
+void CFootBotForagingVariant<TRAIL, TURNING, SOCIAL, COLLISION>::SetWheelSpeedsFromVector(const CVector2& c_heading) {
+   /* The swarm engine converts all the headings at once in batched mode */
+   if(m_bBatched) {
+      CForagingSwarmEngine::GetInstance().SetHeading(m_unBatchSlot, c_heading);
+      return;
+   }
+   Real fLeftWheelSpeed, fRightWheelSpeed;
+   TURNING::WheelSpeeds(m_psParams->WheelTurning,
+                        m_sStateData.TurningMechanism,
+                        c_heading,
+                        fLeftWheelSpeed,
+                        fRightWheelSpeed);
+   /* Finally, set the wheel speeds */
+   SetWheelSpeeds(fLeftWheelSpeed, fRightWheelSpeed);
+}
+
+/****************************************/
+/****************************************/
+
+template <class TRAIL, class TURNING, class SOCIAL, class COLLISION>
+void CFootBotForagingVariant<TRAIL, TURNING, SOCIAL, COLLISION>::Rest() {
+   /* If we have stayed here enough, probabilistically switch to
+    * 'exploring' */
+   if(m_sStateData.TimeRested > m_psParams->State.MinimumRestingTime &&
+      m_pcRNG->Uniform(m_psParams->State.ProbRange) < m_sStateData.RestToExploreProb) {
+      m_pcLEDs->SetAllColors(CColor::GREEN);
+      m_sStateData.State = SStateData::STATE_EXPLORING;
+      m_sStateData.TimeRested = 0;
+   }
+   else {
+      ++m_sStateData.TimeRested;
+      /* Be sure not to send the last exploration result multiple times */
+      if(m_sStateData.TimeRested == 1) {
+         SOCIAL::Tell(*m_pcRABA, m_sBulletin, LAST_EXPLORATION_NONE, GetTick());
+      }
+      /*
+       * Social rule: listen to what other people have found and modify
+       * probabilities accordingly
+       */
+      SOCIAL::Listen(*m_pcRABS, m_sBulletin, m_sStateData, m_psParams->State);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+template <class TRAIL, class TURNING, class SOCIAL, class COLLISION>
+void CFootBotForagingVariant<TRAIL, TURNING, SOCIAL, COLLISION>::RestOrSleep() {
+   UInt32 unTick = GetTick();
+   if(m_sStateData.WakeTick > 0) {
+      if(unTick >= m_sStateData.WakeTick) {
+         /* The drawn step: the switch to 'exploring' succeeds without
+            drawing again */
+         m_pcLEDs->SetAllColors(CColor::GREEN);
+         m_sStateData.State = SStateData::STATE_EXPLORING;
+         m_sStateData.TimeRested = 0;
+         m_sStateData.WakeTick = 0;
+         return;
+      }
+      if(!SOCIAL::HasNews(unTick)) {
+         /* Nothing can happen in this step */
+         return;
+      }
+      /* Woken up by a result: count the steps slept and rest as usual.
+         Failing to switch so far tells nothing about this step, so it
+         is drawn again. */
+      m_sStateData.TimeRested += unTick - m_sStateData.SleepTick - 1;
+      m_sStateData.WakeTick = 0;
+   }
+   Rest();
+   if(m_sStateData.State == SStateData::STATE_RESTING) {
+      Sleep(unTick);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+template <class TRAIL, class TURNING, class SOCIAL, class COLLISION>
+void CFootBotForagingVariant<TRAIL, TURNING, SOCIAL, COLLISION>::Sleep(UInt32 un_tick) {
+   /* At step un_tick + j, Rest() would test TimeRested + j - 1 against
+      MinimumRestingTime: the first step that may switch is j0 */
+   UInt64 unFirst = 1;
+   if(m_psParams->State.MinimumRestingTime + 1 > m_sStateData.TimeRested) {
+      unFirst = m_psParams->State.MinimumRestingTime + 2 - m_sStateData.TimeRested;
+   }
+   /* From then on, each step switches with probability RestToExploreProb:
+      the number of steps until the switch is geometric */
+   UInt64 unWake = std::numeric_limits<UInt32>::max();
+   Real fProb = m_sStateData.RestToExploreProb;
+   if(fProb >= 1.0) {
+      unWake = un_tick + unFirst;
+   }
+   else if(fProb > 0.0) {
+      Real fUniform = m_pcRNG->Uniform(m_psParams->State.ProbRange);
+      if(fUniform <= 0.0) fUniform = std::numeric_limits<Real>::min();
+      Real fFailures = std::floor(std::log(fUniform) / std::log1p(-fProb));
+      if(fFailures < std::numeric_limits<UInt32>::max()) {
+         unWake = Min<UInt64>(un_tick + unFirst + static_cast<UInt64>(fFailures),
+                              std::numeric_limits<UInt32>::max());
+      }
+   }
+   m_sStateData.SleepTick = un_tick;
+   m_sStateData.WakeTick = unWake;
+}
+
+/****************************************/
+/****************************************/
+
+template <class TRAIL, class TURNING, class SOCIAL, class COLLISION>
+void CFootBotForagingVariant<TRAIL, TURNING, SOCIAL, COLLISION>::Explore() {
+   /* We switch to 'return to nest' in two situations:
+    * 1. if we have a food item
+    * 2. if we have not found a food item for some time;
+    *    in this case, the switch is probabilistic
+    */
+   bool bReturnToNest(false);
+   /*
+    * Test the first condition: have we found a food item?
+    * NOTE: the food data is updated by the loop functions, so
+    * here we just need to read it
+    */
+   if(m_sFoodData.HasFoodItem) {
+      /* Apply the food rule, decreasing ExploreToRestProb and increasing
+       * RestToExploreProb */
+      m_sStateData.ExploreToRestProb -= m_psParams->State.FoodRuleExploreToRestDeltaProb;
+      m_psParams->State.ProbRange.TruncValue(m_sStateData.ExploreToRestProb);
+      m_sStateData.RestToExploreProb += m_psParams->State.FoodRuleRestToExploreDeltaProb;
+      m_psParams->State.ProbRange.TruncValue(m_sStateData.RestToExploreProb);
+      /* Store the result of the expedition */
+      m_eLastExplorationResult = LAST_EXPLORATION_SUCCESSFUL;
+      /* Switch to 'return to nest' */
+      bReturnToNest = true;
+   }
+   /* Test the second condition: we probabilistically switch to 'return to
+    * nest' if we have been wandering for some time and found nothing */
+   else if(m_sStateData.TimeExploringUnsuccessfully > m_psParams->State.MinimumUnsuccessfulExploreTime) {
+      if (m_pcRNG->Uniform(m_psParams->State.ProbRange) < m_sStateData.ExploreToRestProb) {
+         /* Store the result of the expedition */
+         m_eLastExplorationResult = LAST_EXPLORATION_UNSUCCESSFUL;
+         /* Switch to 'return to nest' */
+         bReturnToNest = true;
+      }
+      else {
+         /* Apply the food rule, increasing ExploreToRestProb and
+          * decreasing RestToExploreProb */
+         m_sStateData.ExploreToRestProb += m_psParams->State.FoodRuleExploreToRestDeltaProb;
+         m_psParams->State.ProbRange.TruncValue(m_sStateData.ExploreToRestProb);
+         m_sStateData.RestToExploreProb -= m_psParams->State.FoodRuleRestToExploreDeltaProb;
+         m_psParams->State.ProbRange.TruncValue(m_sStateData.RestToExploreProb);
+      }
+   }
+   /* So, do we return to the nest now? */
+   if(bReturnToNest) {
+      /* Yes, we do! */
+      m_sStateData.TimeExploringUnsuccessfully = 0;
+      m_sStateData.TimeSearchingForPlaceInNest = 0;
+      m_pcLEDs->SetAllColors(CColor::BLUE);
+      m_sStateData.State = SStateData::STATE_RETURN_TO_NEST;
+   }
+   else {
+      /* No, perform the actual exploration */
+      ++m_sStateData.TimeExploringUnsuccessfully;
+      UpdateState();
+      /* Get the diffusion vector to perform obstacle avoidance */
+      bool bCollision;
+      CVector2 cDiffusion = DiffusionVector(bCollision);
+      /* Apply the collision rule, if a collision avoidance happened */
+      COLLISION::Apply(bCollision, m_sStateData, m_psParams->State);
+      /*
+       * If we are in the nest, we combine antiphototaxis with obstacle
+       * avoidance
+       * Outside the nest, we just use the diffusion vector
+       */
+      if(m_sStateData.InNest) {
+         /*
+          * The vector returned by CalculateVectorToLight() points to
+          * the light. Thus, the minus sign is because we want to go away
+          * from the light.
+          */
+         SetWheelSpeedsFromVector(
+            m_psParams->WheelTurning.MaxSpeed * cDiffusion -
+            m_psParams->WheelTurning.MaxSpeed * 0.25f * CalculateVectorToLight());
+      }
+      else {
+         /* Use the diffusion vector only */
+         SetWheelSpeedsFromVector(m_psParams->WheelTurning.MaxSpeed * cDiffusion);
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+template <class TRAIL, class TURNING, class SOCIAL, class COLLISION>
+void CFootBotForagingVariant<TRAIL, TURNING, SOCIAL, COLLISION>::LineFollow() {
+   /* We switch to 'return to nest' if we have a food item */
+   if(m_sFoodData.HasFoodItem) {
+      /* Apply the food rule, decreasing ExploreToRestProb and increasing
+       * RestToExploreProb */
+      m_sStateData.ExploreToRestProb -= m_psParams->State.FoodRuleExploreToRestDeltaProb;
+      m_psParams->State.ProbRange.TruncValue(m_sStateData.ExploreToRestProb);
+      m_sStateData.RestToExploreProb += m_psParams->State.FoodRuleRestToExploreDeltaProb;
+      m_psParams->State.ProbRange.TruncValue(m_sStateData.RestToExploreProb);
+      /* Store the result of the expedition */
+      m_eLastExplorationResult = LAST_EXPLORATION_SUCCESSFUL;
+      /* Switch to 'return to nest' */
+      m_sStateData.TimeExploringUnsuccessfully = 0;
+      m_sStateData.TimeSearchingForPlaceInNest = 0;
+      m_pcLEDs->SetAllColors(CColor::BLUE);
+      m_sStateData.State = SStateData::STATE_RETURN_TO_NEST;
+      return;
+   }
+   /* No, perform the actual line following */
+   ++m_sStateData.TimeExploringUnsuccessfully;
+   UpdateState();
+   /* Get the diffusion vector to perform obstacle avoidance */
+   bool bCollision;
+   CVector2 cDiffusion = DiffusionVector(bCollision);
+   if(m_sStateData.InNest) {
+      /* In the nest, combine antiphototaxis with obstacle avoidance */
+      SetWheelSpeedsFromVector(
+         m_psParams->WheelTurning.MaxSpeed * cDiffusion -
+         m_psParams->WheelTurning.MaxSpeed * 0.25f * CalculateVectorToLight());
+   }
+   else {
+      /* Indicate the robot is following the line */
+      m_pcLEDs->SetAllColors(CColor::YELLOW);
+      /* Drive along the line; the wheels are left as they are if the
+         line gives no direction */
+      Real fLeftWheelSpeed, fRightWheelSpeed;
+      if(TRAIL::Drive(m_sStateData,
+                      m_psParams->WheelTurning.MaxSpeed,
+                      fLeftWheelSpeed,
+                      fRightWheelSpeed)) {
+         SetWheelSpeeds(fLeftWheelSpeed, fRightWheelSpeed);
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+template <class TRAIL, class TURNING, class SOCIAL, class COLLISION>
+void CFootBotForagingVariant<TRAIL, TURNING, SOCIAL, COLLISION>::ReturnToNest() {
+   /* As soon as you get to the nest, switch to 'resting' */
+   UpdateState();
+   /* Are we in the nest? */
+   if(m_sStateData.InNest) {
+      /* Have we looked for a place long enough? */
+      if(m_sStateData.TimeSearchingForPlaceInNest > m_psParams->State.MinimumSearchForPlaceInNestTime) {
+         /* Yes, stop the wheels... */
+         SetWheelSpeeds(0.0f, 0.0f);
+         /* Tell people about the last exploration attempt */
+         SOCIAL::Tell(*m_pcRABA, m_sBulletin, m_eLastExplorationResult, GetTick());
+         /* ... and switch to state 'resting' */
+         m_pcLEDs->SetAllColors(CColor::RED);
+         m_sStateData.State = SStateData::STATE_RESTING;
+         m_sStateData.TimeSearchingForPlaceInNest = 0;
+         m_eLastExplorationResult = LAST_EXPLORATION_NONE;
+         return;
+      }
+      else {
+         /* No, keep looking */
+         ++m_sStateData.TimeSearchingForPlaceInNest;
+      }
+   }
+   else {
+      /* Still outside the nest */
+      m_sStateData.TimeSearchingForPlaceInNest = 0;
+   }
+   /* Keep going */
+   bool bCollision;
+   SetWheelSpeedsFromVector(
+      m_psParams->WheelTurning.MaxSpeed * DiffusionVector(bCollision) +
+      m_psParams->WheelTurning.MaxSpeed * CalculateVectorToNest());
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * The variants registered in footbot_foraging.cpp.
+ */
+
+/* The original controller: line trail, three-state turning, both rules */
+typedef CFootBotForagingVariant<SLineTrail, SThreeStateTurning, SRABSocial, SCollisionRule> CFootBotForagingDefault;
+/* No trail following */
+typedef CFootBotForagingVariant<SNoTrail, SThreeStateTurning, SRABSocial, SCollisionRule> CFootBotForagingNoTrail;
+/* Proportional turning */
+typedef CFootBotForagingVariant<SLineTrail, SProportionalTurning, SRABSocial, SCollisionRule> CFootBotForagingProportional;
+/* No social rule */
+typedef CFootBotForagingVariant<SLineTrail, SThreeStateTurning, SNoSocial, SCollisionRule> CFootBotForagingAsocial;
+/* No collision rule */
+typedef CFootBotForagingVariant<SLineTrail, SThreeStateTurning, SRABSocial, SNoCollisionRule> CFootBotForagingNoCollisionRule;
+/* Social rule on the nest bulletin board */
+typedef CFootBotForagingVariant<SLineTrail, SThreeStateTurning, SBulletinSocial, SCollisionRule> CFootBotForagingBulletin;
+
+#endif
@@ -0,0 +1,242 @@
+/*
+ * Benchmark of the Buzz foraging controller against CFootBotForaging.
+ *
+ * Runs the same experiment with the C++ controller (foraging.argos) and
+ * with the Buzz one (foraging_buzz.argos), for each seed, and times the
+ * simulation steps after a warm-up. The arena, the physics and the loop
+ * functions are the same in both, so the difference is the cost of the
+ * controllers. The collected food is printed too, to compare the
+ * behaviours.
+ *
+ * Each run is a child process loading its own copy of the configuration,
+ * with the visualization disabled, the given seed and robot count, and
+ * the output of the loop functions in the work directory.
+ *
+ * Example:
+ *
+ *    foraging_buzz_benchmark -s 1-5 -t 5000 -n 30
+ */
+
+#include <argos3/core/simulator/simulator.h>
+#include <argos3/core/simulator/dynamic_loading.h>
+#include <argos3/core/utility/configuration/argos_configuration.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace argos;
+
+/****************************************/
+/****************************************/
+
+static void PrintUsage(const char* pch_name) {
+   std::cerr << "Usage: " << pch_name << " [-c <C++ config>] [-b <Buzz config>] [-s <seeds, e.g. 1,2,5-9>]" << std::endl
+             << "          [-t <steps>] [-u <warm-up steps>] [-n <robots>] [-w <work dir>]" << std::endl;
+}
+
+/****************************************/
+/****************************************/
+
+static std::vector<UInt32> ParseSeeds(const std::string& str_arg) {
+   std::vector<UInt32> vecSeeds;
+   std::istringstream cIn(str_arg);
+   std::string strToken;
+   while(std::getline(cIn, strToken, ',')) {
+      if(strToken.empty()) continue;
+      size_t unDash = strToken.find('-');
+      if(unDash == std::string::npos) {
+         vecSeeds.push_back(std::strtoul(strToken.c_str(), NULL, 10));
+      }
+      else {
+         UInt32 unFrom = std::strtoul(strToken.substr(0, unDash).c_str(), NULL, 10);
+         UInt32 unTo   = std::strtoul(strToken.substr(unDash + 1).c_str(), NULL, 10);
+         for(UInt32 s = unFrom; s <= unTo; ++s) vecSeeds.push_back(s);
+      }
+   }
+   return vecSeeds;
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * Writes the configuration of a run: headless, with the given seed, robot
+ * count (zero to keep it) and output file.
+ */
+static void WriteRunConfig(const std::string& str_template,
+                           const std::string& str_config,
+                           const std::string& str_output,
+                           UInt32 un_seed,
+                           UInt32 un_robots) {
+   ticpp::Document tDocument(str_template);
+   tDocument.LoadFile();
+   TConfigurationNode& tRoot = *tDocument.FirstChildElement("argos-configuration");
+   TConfigurationNode& tExperiment = GetNode(GetNode(tRoot, "framework"), "experiment");
+   tExperiment.SetAttribute("random_seed", un_seed);
+   tExperiment.SetAttribute("length", 0);
+   GetNode(GetNode(tRoot, "loop_functions"), "foraging").SetAttribute("output", str_output);
+   if(un_robots > 0) {
+      GetNode(GetNode(GetNode(tRoot, "arena"), "distribute"), "entity").SetAttribute("quantity", un_robots);
+   }
+   /* No visualization: an empty node makes ARGoS run headless */
+   if(NodeExists(tRoot, "visualization")) {
+      GetNode(tRoot, "visualization").Clear();
+   }
+   tDocument.SaveFile(str_config);
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * Reads the collected food from the last data line of a loop functions
+ * output file: clock, walking, resting, collected_food, energy.
+ */
+static bool ReadCollectedFood(const std::string& str_file, UInt32& un_collected) {
+   std::ifstream cIn(str_file.c_str());
+   std::string strLine, strLast;
+   while(std::getline(cIn, strLine)) {
+      if(!strLine.empty() && strLine[0] != '#') strLast = strLine;
+   }
+   if(strLast.empty()) return false;
+   std::istringstream cLine(strLast);
+   UInt32 unClock, unWalking, unResting;
+   cLine >> unClock >> unWalking >> unResting >> un_collected;
+   return !cLine.fail();
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * Runs the experiment in a child process and returns the average time of
+ * a step in milliseconds, or a negative value if the run failed.
+ */
+static Real TimeRun(const std::string& str_config, UInt32 un_warmup, UInt32 un_steps) {
+   int pnPipe[2];
+   if(pipe(pnPipe) != 0) {
+      THROW_ARGOSEXCEPTION("pipe() failed: " << std::strerror(errno));
+   }
+   pid_t tPid = fork();
+   if(tPid < 0) {
+      THROW_ARGOSEXCEPTION("fork() failed: " << std::strerror(errno));
+   }
+   if(tPid == 0) {
+      /* Child: run the experiment and send the time to the parent */
+      close(pnPipe[0]);
+      try {
+         CDynamicLoading::LoadAllLibraries();
+         CSimulator& cSimulator = CSimulator::GetInstance();
+         cSimulator.SetExperimentFileName(str_config);
+         cSimulator.LoadExperiment();
+         for(UInt32 t = 0; t < un_warmup; ++t) {
+            cSimulator.UpdateSpace();
+         }
+         std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+         for(UInt32 t = 0; t < un_steps; ++t) {
+            cSimulator.UpdateSpace();
+         }
+         Real fTime = std::chrono::duration<Real, std::milli>(std::chrono::steady_clock::now() - tStart).count() / un_steps;
+         cSimulator.Destroy();
+         std::ostringstream cOut;
+         cOut << std::setprecision(9) << fTime;
+         std::string strOut = cOut.str();
+         if(write(pnPipe[1], strOut.c_str(), strOut.size()) != static_cast<ssize_t>(strOut.size())) {
+            _exit(1);
+         }
+         _exit(0);
+      }
+      catch(CARGoSException& ex) {
+         std::cerr << ex.what() << std::endl;
+         _exit(1);
+      }
+   }
+   /* Parent: read the time and wait for the child */
+   close(pnPipe[1]);
+   std::string strIn;
+   char pchBuffer[64];
+   ssize_t nRead;
+   while((nRead = read(pnPipe[0], pchBuffer, sizeof(pchBuffer))) > 0) {
+      strIn.append(pchBuffer, nRead);
+   }
+   close(pnPipe[0]);
+   int nStatus;
+   waitpid(tPid, &nStatus, 0);
+   if(!WIFEXITED(nStatus) || WEXITSTATUS(nStatus) != 0 || strIn.empty()) {
+      return -1.0;
+   }
+   return std::atof(strIn.c_str());
+}
+
+/****************************************/
+/****************************************/
+
+int main(int argc, char** argv) {
+   std::string pstrTemplates[2] = { "foraging.argos", "foraging_buzz.argos" };
+   const char* pchNames[2] = { "cpp", "buzz" };
+   std::string strWorkDir = "buzz_benchmark";
+   std::vector<UInt32> vecSeeds(1, 1);
+   UInt32 unSteps = 2000;
+   UInt32 unWarmup = 500;
+   UInt32 unRobots = 0;
+   int nOpt;
+   while((nOpt = getopt(argc, argv, "c:b:s:t:u:n:w:h")) != -1) {
+      switch(nOpt) {
+         case 'c': pstrTemplates[0] = optarg; break;
+         case 'b': pstrTemplates[1] = optarg; break;
+         case 's': vecSeeds = ParseSeeds(optarg); break;
+         case 't': unSteps = std::strtoul(optarg, NULL, 10); break;
+         case 'u': unWarmup = std::strtoul(optarg, NULL, 10); break;
+         case 'n': unRobots = std::strtoul(optarg, NULL, 10); break;
+         case 'w': strWorkDir = optarg; break;
+         default: PrintUsage(argv[0]); return 1;
+      }
+   }
+   if(vecSeeds.empty() || unSteps == 0) {
+      PrintUsage(argv[0]);
+      return 1;
+   }
+   try {
+      if(mkdir(strWorkDir.c_str(), 0755) != 0 && errno != EEXIST) {
+         THROW_ARGOSEXCEPTION("Cannot create work directory \"" << strWorkDir << "\": " << std::strerror(errno));
+      }
+      std::cout << "# " << unSteps << " steps after " << unWarmup << " warm-up steps" << std::endl
+                << "# controller\tseed\tms_per_step\tcollected_food" << std::endl;
+      Real pfTotal[2] = { 0.0, 0.0 };
+      for(size_t s = 0; s < vecSeeds.size(); ++s) {
+         for(size_t c = 0; c < 2; ++c) {
+            std::ostringstream cBase;
+            cBase << strWorkDir << "/" << pchNames[c] << "_" << vecSeeds[s];
+            std::string strConfig = cBase.str() + ".argos";
+            std::string strOutput = cBase.str() + ".txt";
+            WriteRunConfig(pstrTemplates[c], strConfig, strOutput, vecSeeds[s], unRobots);
+            Real fTime = TimeRun(strConfig, unWarmup, unSteps);
+            UInt32 unCollected = 0;
+            if(fTime < 0.0 || !ReadCollectedFood(strOutput, unCollected)) {
+               THROW_ARGOSEXCEPTION("The run \"" << strConfig << "\" failed");
+            }
+            pfTotal[c] += fTime;
+            std::cout << pchNames[c] << "\t" << vecSeeds[s] << "\t"
+                      << std::fixed << std::setprecision(3) << fTime << "\t"
+                      << unCollected << std::endl;
+         }
+      }
+      std::cout << "# mean ms_per_step: cpp " << pfTotal[0] / vecSeeds.size()
+                << ", buzz " << pfTotal[1] / vecSeeds.size()
+                << ", buzz/cpp " << pfTotal[1] / pfTotal[0] << std::endl;
+   }
+   catch(CARGoSException& ex) {
+      std::cerr << ex.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}
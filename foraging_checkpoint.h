@@ -0,0 +1,63 @@
+/*
+ * Helpers for the binary checkpoint format shared by the loop functions
+ * and the foraging controller.
+ *
+ * Values are written as raw bytes in host order: a checkpoint is meant to
+ * be restored on the machine (or cluster) that produced it.
+ */
+
+#ifndef FORAGING_CHECKPOINT_H
+#define FORAGING_CHECKPOINT_H
+
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <istream>
+#include <ostream>
+#include <string>
+
+using namespace argos;
+
+/* Magic number and version at the start of every checkpoint file */
+static const UInt32 FORAGING_CHECKPOINT_MAGIC   = 0x4B434746; // "FGCK"
+static const UInt32 FORAGING_CHECKPOINT_VERSION = 7;
+
+/*
+ * Writes a plain value.
+ */
+template <typename T>
+inline void CheckpointWrite(std::ostream& c_out, const T& t_value) {
+   c_out.write(reinterpret_cast<const char*>(&t_value), sizeof(T));
+}
+
+/*
+ * Reads a plain value, throwing if the file is truncated.
+ */
+template <typename T>
+inline void CheckpointRead(std::istream& c_in, T& t_value) {
+   c_in.read(reinterpret_cast<char*>(&t_value), sizeof(T));
+   if(!c_in) {
+      THROW_ARGOSEXCEPTION("Checkpoint file is truncated");
+   }
+}
+
+/*
+ * Strings are written as their length followed by their characters.
+ */
+inline void CheckpointWrite(std::ostream& c_out, const std::string& str_value) {
+   CheckpointWrite<UInt32>(c_out, str_value.size());
+   c_out.write(str_value.data(), str_value.size());
+}
+
+inline void CheckpointRead(std::istream& c_in, std::string& str_value) {
+   UInt32 unSize;
+   CheckpointRead(c_in, unSize);
+   str_value.resize(unSize);
+   if(unSize > 0) {
+      c_in.read(&str_value[0], unSize);
+   }
+   if(!c_in) {
+      THROW_ARGOSEXCEPTION("Checkpoint file is truncated");
+   }
+}
+
+#endif
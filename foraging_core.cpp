@@ -0,0 +1,182 @@
+#include "foraging_core.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+
+/****************************************/
+/****************************************/
+
+CForagingCore::CForagingCore() :
+   m_fFoodSquareRadius(0.0),
+   m_cForagingArenaSideX(1.1f, 1.9f),
+   m_cForagingArenaSideY(-0.35f, 0.35f),
+   m_unCollectedFood(0),
+   m_nEnergy(0),
+   m_unEnergyPerFoodItem(1),
+   m_unEnergyPerWalkingRobot(1),
+   unHeight(0),
+   unWidth(0),
+   unResolution(1),
+   unIntensity(0),
+   unDissipation(0),
+   unRadius(0),
+   m_fEvaporation(0.0),
+   m_fEvaporationThreshold(0.0) {}
+
+/****************************************/
+/****************************************/
+
+CForagingCore::EOutcome CForagingCore::StepRobot(const CVector2& c_pos,
+                                                 bool& b_has_food_item,
+                                                 size_t& un_food_item_idx) {
+   /* The robot has a food item */
+   if(b_has_food_item) {
+      EOutcome eOutcome = OUTCOME_NONE;
+      /* Check whether the robot is in the nest */
+      if(c_pos.GetX() < -1.0f) {
+         /* Place a new food item on the ground */
+         ++m_vecFoodRespawns[un_food_item_idx];
+         m_cFoodPos[un_food_item_idx] = m_cFoodRNG.Position(un_food_item_idx,
+                                                            m_vecFoodRespawns[un_food_item_idx],
+                                                            m_cForagingArenaSideX,
+                                                            m_cForagingArenaSideY);
+         /* Drop the food item */
+         b_has_food_item = false;
+         un_food_item_idx = 0;
+         /* Increase the energy and food count */
+         m_nEnergy += m_unEnergyPerFoodItem;
+         ++m_unCollectedFood;
+         eOutcome = OUTCOME_DROP;
+      }
+      /* put the pheromone trail into the field, adding to the intensity if the cell is already filled */
+      m_cPheromoneField.DepositStamp(m_cPheromoneField.ToCell(c_pos.GetX()),
+                                     m_cPheromoneField.ToCell(c_pos.GetY()),
+                                     unRadius,
+                                     unIntensity);
+      return eOutcome;
+   }
+   /* The robot has no food item: check whether it is out of the nest */
+   if(c_pos.GetX() > -1.0f) {
+      /* Check whether the robot is on a food item */
+      for(size_t i = 0; i < m_cFoodPos.size(); ++i) {
+         if((c_pos - m_cFoodPos[i]).SquareLength() < m_fFoodSquareRadius) {
+            /* If so, we move that item out of sight */
+            m_cFoodPos[i].Set(100.0f, 100.f);
+            /* The robot is now carrying an item */
+            b_has_food_item = true;
+            un_food_item_idx = i;
+            return OUTCOME_PICKUP;
+         }
+      }
+   }
+   return OUTCOME_NONE;
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingCore::DepositAt(const CVector2& c_pos, Real f_amount) {
+   m_cPheromoneField.DepositStamp(m_cPheromoneField.ToCell(c_pos.GetX()),
+                                  m_cPheromoneField.ToCell(c_pos.GetY()),
+                                  unRadius,
+                                  f_amount);
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingCore::EndRobots(UInt32 un_walking) {
+   /* Update energy expediture due to walking robots */
+   m_nEnergy -= un_walking * m_unEnergyPerWalkingRobot;
+   /* The deposits of this step are done: the decay can start while the
+      robots sense the field and act */
+   if(m_cPheromoneField.GetDecay() == CPheromoneField::DECAY_EXPONENTIAL) {
+      m_cPheromoneField.BeginDecay(m_fEvaporation);
+   }
+   else {
+      m_cPheromoneField.BeginDecay(unDissipation);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingCore::GetSetup(SForagingSetup& s_setup) const {
+   s_setup.FoodSquareRadius = m_fFoodSquareRadius;
+   s_setup.FoodMinX = m_cForagingArenaSideX.GetMin();
+   s_setup.FoodMaxX = m_cForagingArenaSideX.GetMax();
+   s_setup.FoodMinY = m_cForagingArenaSideY.GetMin();
+   s_setup.FoodMaxY = m_cForagingArenaSideY.GetMax();
+   s_setup.FoodItems = m_cFoodPos.size();
+   s_setup.EnergyPerFoodItem = m_unEnergyPerFoodItem;
+   s_setup.EnergyPerWalkingRobot = m_unEnergyPerWalkingRobot;
+   s_setup.Width = unWidth;
+   s_setup.Height = unHeight;
+   s_setup.Resolution = unResolution;
+   s_setup.Intensity = unIntensity;
+   s_setup.Dissipation = unDissipation;
+   s_setup.Radius = unRadius;
+   s_setup.Decay = m_cPheromoneField.GetDecay();
+   s_setup.Evaporation = m_fEvaporation;
+   s_setup.Threshold = m_fEvaporationThreshold;
+   s_setup.DecayPeriod = m_cPheromoneField.GetDecayPeriod();
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingCore::Setup(const SForagingSetup& s_setup,
+                          bool b_pipelined, bool b_pyramid, UInt32 un_threads,
+                          UInt32 un_decay_period) {
+   if(s_setup.Resolution <= 0) {
+      THROW_ARGOSEXCEPTION("The pheromone resolution must be positive");
+   }
+   m_fFoodSquareRadius = s_setup.FoodSquareRadius;
+   m_cForagingArenaSideX.Set(s_setup.FoodMinX, s_setup.FoodMaxX);
+   m_cForagingArenaSideY.Set(s_setup.FoodMinY, s_setup.FoodMaxY);
+   m_cFoodPos.assign(s_setup.FoodItems, CVector2());
+   m_vecFoodRespawns.assign(s_setup.FoodItems, 0);
+   m_unEnergyPerFoodItem = s_setup.EnergyPerFoodItem;
+   m_unEnergyPerWalkingRobot = s_setup.EnergyPerWalkingRobot;
+   unWidth = s_setup.Width;
+   unHeight = s_setup.Height;
+   unResolution = s_setup.Resolution;
+   unIntensity = s_setup.Intensity;
+   unDissipation = s_setup.Dissipation;
+   unRadius = s_setup.Radius;
+   m_fEvaporation = s_setup.Evaporation;
+   m_fEvaporationThreshold = s_setup.Threshold;
+   m_cPheromoneField.Init(unWidth, unHeight, unResolution, unRadius,
+                          b_pipelined, b_pyramid, un_threads, un_decay_period,
+                          static_cast<CPheromoneField::EDecay>(s_setup.Decay),
+                          m_fEvaporationThreshold);
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingCore::PlaceFood(UInt32 un_key) {
+   m_cFoodRNG.SetKey(un_key);
+   m_vecFoodRespawns.assign(m_cFoodPos.size(), 0);
+   m_cFoodRNG.Positions(m_vecFoodRespawns, m_cForagingArenaSideX, m_cForagingArenaSideY, m_cFoodPos);
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingCore::StartTrial(UInt32 un_food_key, UInt32 un_collected_food, SInt64 n_energy,
+                               const std::vector<CVector2>& vec_food_pos,
+                               const std::vector<UInt32>& vec_food_respawns,
+                               const std::vector<CPheromoneField::SCell>& vec_pheromone) {
+   if(vec_food_pos.size() != m_cFoodPos.size() ||
+      vec_food_respawns.size() != m_cFoodPos.size()) {
+      THROW_ARGOSEXCEPTION("The trial has " << vec_food_pos.size() << " food items, the setup " << m_cFoodPos.size());
+   }
+   m_cFoodRNG.SetKey(un_food_key);
+   m_unCollectedFood = un_collected_food;
+   m_nEnergy = n_energy;
+   m_cFoodPos = vec_food_pos;
+   m_vecFoodRespawns = vec_food_respawns;
+   m_cPheromoneField.Clear();
+   for(size_t i = 0; i < vec_pheromone.size(); ++i) {
+      m_cPheromoneField.Deposit(vec_pheromone[i].X, vec_pheromone[i].Y, vec_pheromone[i].Value);
+   }
+}
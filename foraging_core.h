@@ -0,0 +1,168 @@
+/*
+ * The food and pheromone logic of the foraging loop functions, apart from
+ * ARGoS: the food items, their pick-up and drop, the trail laid by the
+ * carrying robots, and the food and energy counters.
+ *
+ * CForagingLoopFunctions feeds it the foot-bots of the space at each
+ * step. The replay driver (foraging_replay.cpp) feeds it the inputs
+ * recorded by CForagingInputRecorder instead, without physics nor
+ * controllers.
+ */
+
+#ifndef FORAGING_CORE_H
+#define FORAGING_CORE_H
+
+#include <argos3/core/utility/math/range.h>
+#include <argos3/core/utility/math/vector2.h>
+#include "food_rng.h"
+#include "pheromone_field.h"
+#include <vector>
+
+using namespace argos;
+
+/*
+ * The parameters of the logic, as read from the loop functions
+ * configuration.
+ */
+struct SForagingSetup {
+   Real FoodSquareRadius;
+   Real FoodMinX, FoodMaxX, FoodMinY, FoodMaxY;
+   UInt32 FoodItems;
+   UInt32 EnergyPerFoodItem;
+   UInt32 EnergyPerWalkingRobot;
+   /* The <pheromones> node */
+   SInt32 Width, Height, Resolution, Intensity, Dissipation, Radius;
+   /* A CPheromoneField::EDecay, the parameters of exponential decay, and
+      the steps between two sweeps of the field */
+   UInt32 Decay;
+   Real Evaporation, Threshold;
+   UInt32 DecayPeriod;
+};
+
+class CForagingCore {
+
+public:
+
+   /* What happened to a robot in a step */
+   enum EOutcome {
+      OUTCOME_NONE = 0,
+      /* It brought its item back to the nest */
+      OUTCOME_DROP,
+      /* It picked an item */
+      OUTCOME_PICKUP
+   };
+
+public:
+
+   CForagingCore();
+
+   /*
+    * Runs the logic for a robot at the given position: if it carries an
+    * item, drops it in the nest and lays the trail; otherwise, picks the
+    * first item it is on. b_has_food_item and un_food_item_idx are the
+    * food data of the robot, and are updated.
+    */
+   EOutcome StepRobot(const CVector2& c_pos, bool& b_has_food_item, size_t& un_food_item_idx);
+
+   /*
+    * Lays a stamp of f_amount at the given position, with the radius of
+    * the trail. Must be called before EndRobots().
+    */
+   void DepositAt(const CVector2& c_pos, Real f_amount);
+
+   /*
+    * Must be called once all the robots of the step have been processed:
+    * charges the walking robots and starts the decay of the field.
+    */
+   void EndRobots(UInt32 un_walking);
+
+   /*
+    * Returns the parameters of the logic.
+    */
+   void GetSetup(SForagingSetup& s_setup) const;
+
+   /*
+    * Sets the parameters of the logic and allocates the field, for a
+    * caller other than the loop functions, which must then call
+    * StartTrial().
+    */
+   void Setup(const SForagingSetup& s_setup,
+              bool b_pipelined, bool b_pyramid, UInt32 un_threads,
+              UInt32 un_decay_period = 1);
+
+   /*
+    * Keys the food generator and places every item at its first position.
+    */
+   void PlaceFood(UInt32 un_key);
+
+   /*
+    * Starts a trial from the given state: key of the food generator,
+    * counters, food positions and respawn counts, and the cells of the
+    * pheromone field, which replace its contents.
+    */
+   void StartTrial(UInt32 un_food_key, UInt32 un_collected_food, SInt64 n_energy,
+                   const std::vector<CVector2>& vec_food_pos,
+                   const std::vector<UInt32>& vec_food_respawns,
+                   const std::vector<CPheromoneField::SCell>& vec_pheromone);
+
+   inline UInt32 GetFoodKey() const {
+      return m_cFoodRNG.GetKey();
+   }
+
+   /*
+    * How many times each item has been respawned since PlaceFood().
+    */
+   inline const std::vector<UInt32>& GetFoodRespawns() const {
+      return m_vecFoodRespawns;
+   }
+
+   inline const std::vector<CVector2>& GetFoodPositions() const {
+      return m_cFoodPos;
+   }
+
+   inline UInt32 GetCollectedFood() const {
+      return m_unCollectedFood;
+   }
+
+   inline SInt64 GetEnergy() const {
+      return m_nEnergy;
+   }
+
+   /*
+    * Returns the pheromone field. With pyramid="true" on the <pheromones>
+    * node, controllers can use its range queries through the
+    * pheromone_trail sensor (see ci_pheromone_trail_sensor.h).
+    */
+   inline const CPheromoneField& GetPheromoneField() const {
+      return m_cPheromoneField;
+   }
+
+protected:
+
+    Real m_fFoodSquareRadius;
+    CRange<Real> m_cForagingArenaSideX, m_cForagingArenaSideY;
+    std::vector<CVector2> m_cFoodPos;
+    /* The positions of the items are drawn from their respawn counts */
+    CFoodRNG m_cFoodRNG;
+    std::vector<UInt32> m_vecFoodRespawns;
+
+    UInt32 m_unCollectedFood;
+    SInt64 m_nEnergy;
+    UInt32 m_unEnergyPerFoodItem;
+    UInt32 m_unEnergyPerWalkingRobot;
+
+    CPheromoneField m_cPheromoneField;
+    int unHeight;
+    int unWidth;
+    int unResolution;
+    int unIntensity;
+    int unDissipation;
+    int unRadius;
+    /* Exponential decay: fraction lost per step, and value below which a
+       cell is emptied */
+    Real m_fEvaporation;
+    Real m_fEvaporationThreshold;
+
+};
+
+#endif
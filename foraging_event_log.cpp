@@ -0,0 +1,76 @@
+#include "foraging_event_log.h"
+#include "foraging_checkpoint.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <algorithm>
+#include <cstring>
+
+/****************************************/
+/****************************************/
+
+CForagingEventLog& CForagingEventLog::GetInstance() {
+   static CForagingEventLog cInstance;
+   return cInstance;
+}
+
+/****************************************/
+/****************************************/
+
+CForagingEventLog::CForagingEventLog() :
+   m_bEnabled(false),
+   m_unNext(0) {}
+
+/****************************************/
+/****************************************/
+
+void CForagingEventLog::Open(const std::string& str_file,
+                             UInt32 un_capacity,
+                             const std::vector<std::string>& vec_robot_ids) {
+   Close();
+   m_cFile.open(str_file.c_str(), std::ios_base::binary | std::ios_base::trunc | std::ios_base::out);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Cannot open event file \"" << str_file << "\" for writing");
+   }
+   CheckpointWrite(m_cFile, MAGIC);
+   CheckpointWrite(m_cFile, VERSION);
+   CheckpointWrite<UInt32>(m_cFile, sizeof(SForagingEvent));
+   CheckpointWrite<UInt32>(m_cFile, vec_robot_ids.size());
+   for(size_t i = 0; i < vec_robot_ids.size(); ++i) {
+      CheckpointWrite(m_cFile, vec_robot_ids[i]);
+   }
+   m_vecRecords.resize(un_capacity);
+   m_unNext.store(0);
+   m_bEnabled = true;
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingEventLog::Close() {
+   if(!m_bEnabled) return;
+   m_bEnabled = false;
+   m_cFile.close();
+   m_vecRecords.clear();
+   m_unNext.store(0);
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingEventLog::Flush(UInt32 un_tick) {
+   if(!m_bEnabled) return;
+   UInt32 unEmitted = m_unNext.load();
+   UInt32 unKept = std::min<UInt32>(unEmitted, m_vecRecords.size());
+   if(unKept > 0) {
+      m_cFile.write(reinterpret_cast<const char*>(&m_vecRecords[0]),
+                    unKept * sizeof(SForagingEvent));
+   }
+   if(unEmitted > unKept) {
+      SForagingEvent sOverflow;
+      ::memset(&sOverflow, 0, sizeof(sOverflow));
+      sOverflow.Tick = un_tick;
+      sOverflow.Type = SForagingEvent::EVENT_OVERFLOW;
+      sOverflow.Item = unEmitted - unKept;
+      CheckpointWrite(m_cFile, sOverflow);
+   }
+   m_unNext.store(0);
+}
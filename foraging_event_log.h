@@ -0,0 +1,141 @@
+/*
+ * Stream of foraging events, written in binary.
+ *
+ * The loop functions and the controllers emit fixed-size records into a
+ * preallocated buffer. A record takes its slot with an atomic increment,
+ * so the controllers can emit from the ARGoS worker threads without
+ * locks. The loop functions flush the buffer at the end of every step.
+ * Records that do not fit in the buffer are dropped and counted, so the
+ * cost of a step is bounded whatever happens.
+ *
+ * File layout, in host byte order:
+ *
+ *    UInt32 magic "FGEV", UInt32 version, UInt32 record size,
+ *    UInt32 number of robots, then for each robot its id as
+ *    UInt32 length and characters; then the records, until the end of
+ *    the file.
+ *
+ * The robot field of a record is the index of the robot in that table.
+ */
+
+#ifndef FORAGING_EVENT_LOG_H
+#define FORAGING_EVENT_LOG_H
+
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace argos;
+
+/*
+ * An event record.
+ */
+struct SForagingEvent {
+   enum EType : UInt8 {
+      /* The robot changed state: From and To are SStateData::EState */
+      EVENT_STATE = 0,
+      /* The robot left the nest: a trip starts */
+      EVENT_LEAVE_NEST,
+      /* The robot picked up food item Item */
+      EVENT_PICKUP,
+      /* The robot dropped food item Item in the nest: the trip fields
+         are filled in */
+      EVENT_DROP,
+      /* The robot came back to the nest without food: the trip fields
+         are filled in */
+      EVENT_RETURN_EMPTY,
+      /* A new trial starts: Item is the trial number */
+      EVENT_TRIAL,
+      /* Item records were dropped because the buffer was full */
+      EVENT_OVERFLOW
+   };
+
+   /* Flags */
+   static const UInt8 FLAG_FOUND_VIA_TRAIL = 0x01;
+
+   UInt32 Tick;
+   UInt32 Robot;
+   UInt8 Type;
+   UInt8 From;
+   UInt8 To;
+   UInt8 Flags;
+   UInt32 Item;
+   /* Trip: step the robot left the nest, step of the pickup, steps spent
+      following the line */
+   UInt32 TripStart;
+   UInt32 Pickup;
+   UInt32 LineFollowing;
+   /* Trip: distance travelled, in meters */
+   float Distance;
+   /* Position of the robot */
+   float X;
+   float Y;
+};
+
+class CForagingEventLog {
+
+public:
+
+   static const UInt32 MAGIC   = 0x56454746; // "FGEV"
+   static const UInt32 VERSION = 1;
+
+   /*
+    * Returns the log shared by the loop functions and the controllers.
+    */
+   static CForagingEventLog& GetInstance();
+
+   /*
+    * Opens the file and writes the header. Until then, Emit() does
+    * nothing.
+    */
+   void Open(const std::string& str_file,
+             UInt32 un_capacity,
+             const std::vector<std::string>& vec_robot_ids);
+
+   /*
+    * Flushes and closes the file.
+    */
+   void Close();
+
+   /*
+    * Returns true if the log is open.
+    */
+   inline bool IsEnabled() const {
+      return m_bEnabled;
+   }
+
+   /*
+    * Adds a record to the buffer. Thread-safe, and never blocks.
+    */
+   inline void Emit(const SForagingEvent& s_event) {
+      if(!m_bEnabled) return;
+      UInt32 unSlot = m_unNext.fetch_add(1, std::memory_order_relaxed);
+      if(unSlot < m_vecRecords.size()) {
+         m_vecRecords[unSlot] = s_event;
+      }
+   }
+
+   /*
+    * Writes the buffered records to the file, followed by an overflow
+    * record at step un_tick if some were dropped. Must be called when no
+    * thread is emitting.
+    */
+   void Flush(UInt32 un_tick);
+
+private:
+
+   CForagingEventLog();
+
+private:
+
+   bool m_bEnabled;
+   std::ofstream m_cFile;
+   /* Preallocated records, and the next free slot */
+   std::vector<SForagingEvent> m_vecRecords;
+   std::atomic<UInt32> m_unNext;
+
+};
+
+#endif
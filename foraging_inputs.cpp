@@ -0,0 +1,198 @@
+#include "foraging_inputs.h"
+#include "foraging_checkpoint.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <cstring>
+
+/****************************************/
+/****************************************/
+
+CForagingInputRecorder::CForagingInputRecorder() :
+   m_unTick(0) {}
+
+/****************************************/
+/****************************************/
+
+void CForagingInputRecorder::Open(const std::string& str_file, const CForagingCore& c_core) {
+   Close();
+   m_cFile.open(str_file.c_str(), std::ios_base::binary | std::ios_base::trunc | std::ios_base::out);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Cannot open input recording \"" << str_file << "\" for writing");
+   }
+   SForagingSetup sSetup;
+   c_core.GetSetup(sSetup);
+   CheckpointWrite(m_cFile, FORAGING_INPUTS_MAGIC);
+   CheckpointWrite(m_cFile, FORAGING_INPUTS_VERSION);
+   CheckpointWrite(m_cFile, sSetup);
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingInputRecorder::Close() {
+   if(m_cFile.is_open()) {
+      m_cFile.close();
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingInputRecorder::BeginTrial(UInt32 un_trial, UInt32 un_tick, const CForagingCore& c_core) {
+   const std::vector<CVector2>& vecFoodPos = c_core.GetFoodPositions();
+   const std::vector<UInt32>& vecFoodRespawns = c_core.GetFoodRespawns();
+   CheckpointWrite(m_cFile, FORAGING_INPUTS_TRIAL);
+   CheckpointWrite(m_cFile, un_trial);
+   CheckpointWrite(m_cFile, un_tick);
+   CheckpointWrite(m_cFile, c_core.GetFoodKey());
+   CheckpointWrite(m_cFile, c_core.GetCollectedFood());
+   CheckpointWrite(m_cFile, c_core.GetEnergy());
+   CheckpointWrite<UInt32>(m_cFile, vecFoodPos.size());
+   for(size_t i = 0; i < vecFoodPos.size(); ++i) {
+      CheckpointWrite(m_cFile, vecFoodPos[i].GetX());
+      CheckpointWrite(m_cFile, vecFoodPos[i].GetY());
+      CheckpointWrite(m_cFile, vecFoodRespawns[i]);
+   }
+   /* The field a restored checkpoint starts from, empty otherwise */
+   c_core.GetPheromoneField().GetCells(m_vecCells);
+   CheckpointWrite<UInt32>(m_cFile, m_vecCells.size());
+   for(size_t i = 0; i < m_vecCells.size(); ++i) {
+      CheckpointWrite(m_cFile, m_vecCells[i].X);
+      CheckpointWrite(m_cFile, m_vecCells[i].Y);
+      CheckpointWrite(m_cFile, m_vecCells[i].Value);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingInputRecorder::BeginStep(UInt32 un_tick) {
+   m_unTick = un_tick;
+   m_vecRobots.clear();
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingInputRecorder::Record(const CVector2& c_pos, bool b_resting,
+                                    bool b_has_food_item, UInt32 un_food_item_idx) {
+   SForagingInputRobot sRobot;
+   ::memset(&sRobot, 0, sizeof(sRobot));
+   sRobot.X = c_pos.GetX();
+   sRobot.Y = c_pos.GetY();
+   sRobot.FoodItemIdx = un_food_item_idx;
+   sRobot.Flags = (b_resting ? SForagingInputRobot::FLAG_RESTING : 0) |
+                  (b_has_food_item ? SForagingInputRobot::FLAG_HAS_FOOD : 0);
+   m_vecRobots.push_back(sRobot);
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingInputRecorder::EndStep(const SForagingInputCounters& s_counters) {
+   CheckpointWrite(m_cFile, FORAGING_INPUTS_STEP);
+   CheckpointWrite(m_cFile, m_unTick);
+   CheckpointWrite<UInt32>(m_cFile, m_vecRobots.size());
+   if(!m_vecRobots.empty()) {
+      m_cFile.write(reinterpret_cast<const char*>(&m_vecRobots[0]),
+                    m_vecRobots.size() * sizeof(SForagingInputRobot));
+   }
+   CheckpointWrite(m_cFile, s_counters);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Error writing the input recording");
+   }
+}
+
+/****************************************/
+/****************************************/
+
+CForagingInputReader::CForagingInputReader() :
+   m_unTrial(0),
+   m_unFoodKey(0),
+   m_unStartCollectedFood(0),
+   m_nStartEnergy(0),
+   m_unTick(0) {
+   ::memset(&m_sSetup, 0, sizeof(m_sSetup));
+   ::memset(&m_sCounters, 0, sizeof(m_sCounters));
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingInputReader::Open(const std::string& str_file) {
+   m_cFile.close();
+   m_cFile.clear();
+   m_cFile.open(str_file.c_str(), std::ios_base::binary | std::ios_base::in);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Cannot open input recording \"" << str_file << "\"");
+   }
+   try {
+      UInt32 unMagic, unVersion;
+      CheckpointRead(m_cFile, unMagic);
+      CheckpointRead(m_cFile, unVersion);
+      if(unMagic != FORAGING_INPUTS_MAGIC || unVersion != FORAGING_INPUTS_VERSION) {
+         THROW_ARGOSEXCEPTION("Not an input recording, or unsupported version");
+      }
+      CheckpointRead(m_cFile, m_sSetup);
+   }
+   catch(CARGoSException& ex) {
+      THROW_ARGOSEXCEPTION_NESTED("Error reading input recording \"" << str_file << "\"", ex);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+UInt8 CForagingInputReader::Next() {
+   UInt8 unTag;
+   if(!m_cFile.read(reinterpret_cast<char*>(&unTag), sizeof(unTag))) {
+      return 0;
+   }
+   try {
+      if(unTag == FORAGING_INPUTS_TRIAL) {
+         UInt32 unItems;
+         CheckpointRead(m_cFile, m_unTrial);
+         CheckpointRead(m_cFile, m_unTick);
+         CheckpointRead(m_cFile, m_unFoodKey);
+         CheckpointRead(m_cFile, m_unStartCollectedFood);
+         CheckpointRead(m_cFile, m_nStartEnergy);
+         CheckpointRead(m_cFile, unItems);
+         if(unItems != m_sSetup.FoodItems) return 0;
+         m_vecFoodPos.resize(unItems);
+         m_vecFoodRespawns.resize(unItems);
+         for(UInt32 i = 0; i < unItems; ++i) {
+            Real fX, fY;
+            CheckpointRead(m_cFile, fX);
+            CheckpointRead(m_cFile, fY);
+            CheckpointRead(m_cFile, m_vecFoodRespawns[i]);
+            m_vecFoodPos[i].Set(fX, fY);
+         }
+         UInt32 unCells;
+         CheckpointRead(m_cFile, unCells);
+         m_vecPheromone.resize(unCells);
+         for(UInt32 i = 0; i < unCells; ++i) {
+            CheckpointRead(m_cFile, m_vecPheromone[i].X);
+            CheckpointRead(m_cFile, m_vecPheromone[i].Y);
+            CheckpointRead(m_cFile, m_vecPheromone[i].Value);
+         }
+      }
+      else if(unTag == FORAGING_INPUTS_STEP) {
+         UInt32 unRobots;
+         CheckpointRead(m_cFile, m_unTick);
+         CheckpointRead(m_cFile, unRobots);
+         m_vecRobots.resize(unRobots);
+         for(UInt32 i = 0; i < unRobots; ++i) {
+            CheckpointRead(m_cFile, m_vecRobots[i]);
+         }
+         CheckpointRead(m_cFile, m_sCounters);
+      }
+      else {
+         /* Not a record */
+         return 0;
+      }
+   }
+   catch(CARGoSException&) {
+      /* A record cut by a crash */
+      return 0;
+   }
+   return unTag;
+}
@@ -0,0 +1,182 @@
+/*
+ * Recording of the inputs of the foraging logic, for replay.
+ *
+ * At each step, CForagingLoopFunctions::PreStep() reads the position of
+ * every foot-bot and whether it is resting and carrying an item; nothing
+ * else of the simulation reaches CForagingCore. The recorder writes these
+ * inputs, with the counters the step produced, so that the replay driver
+ * (foraging_replay.cpp) can run the same logic again without physics
+ * nor controllers, and check that it produces the same counters.
+ *
+ * Layout, in host byte order:
+ *
+ *    header:  magic, version, SForagingSetup
+ *    records: a UInt8 tag followed by
+ *             FORAGING_INPUTS_TRIAL: trial, step, key of the food
+ *                                    generator, collected food, energy,
+ *                                    for each item its position (two
+ *                                    Reals) and respawn count (UInt32),
+ *                                    the cell count of the pheromone
+ *                                    field and, for each cell, SInt32 x
+ *                                    and y and its Real value
+ *             FORAGING_INPUTS_STEP:  step, robot count, the
+ *                                    SForagingInputRobot of every robot,
+ *                                    SForagingInputCounters
+ *
+ * The food positions are a function of the key and the respawn counts
+ * (see food_rng.h), so the trial record holds all the randomness of the
+ * trial. The field is not empty at the start of a trial restored from a
+ * checkpoint, so the trial record holds its cells too. The file ends at
+ * the last complete record, so a crashed run can be replayed up to its
+ * last step.
+ */
+
+#ifndef FORAGING_INPUTS_H
+#define FORAGING_INPUTS_H
+
+#include "foraging_core.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+/* Magic number and version at the start of the file */
+static const UInt32 FORAGING_INPUTS_MAGIC   = 0x4E494746; // "FGIN"
+static const UInt32 FORAGING_INPUTS_VERSION = 4;
+
+/* Record tags */
+static const UInt8 FORAGING_INPUTS_TRIAL = 1;
+static const UInt8 FORAGING_INPUTS_STEP  = 2;
+
+/* What PreStep() reads of a foot-bot */
+struct SForagingInputRobot {
+   enum {
+      FLAG_RESTING   = 0x01,
+      FLAG_HAS_FOOD  = 0x02
+   };
+   Real X;
+   Real Y;
+   UInt32 FoodItemIdx;
+   UInt8 Flags;
+   UInt8 Padding[3];
+};
+
+/* The counters at the end of PreStep() */
+struct SForagingInputCounters {
+   UInt32 Walking;
+   UInt32 Resting;
+   UInt32 CollectedFood;
+   UInt32 ActiveCells;
+   SInt64 Energy;
+   Real PheromoneTotal;
+};
+
+/****************************************/
+/****************************************/
+
+class CForagingInputRecorder {
+
+public:
+
+   CForagingInputRecorder();
+
+   /*
+    * Opens the file and writes the header.
+    */
+   void Open(const std::string& str_file, const CForagingCore& c_core);
+
+   void Close();
+
+   inline bool IsEnabled() const {
+      return m_cFile.is_open();
+   }
+
+   /*
+    * Writes the start of a trial.
+    */
+   void BeginTrial(UInt32 un_trial, UInt32 un_tick, const CForagingCore& c_core);
+
+   /*
+    * Starts the record of a step.
+    */
+   void BeginStep(UInt32 un_tick);
+
+   /*
+    * Adds a foot-bot to the step, before the core processes it.
+    */
+   void Record(const CVector2& c_pos, bool b_resting, bool b_has_food_item, UInt32 un_food_item_idx);
+
+   /*
+    * Writes the step with the counters it produced.
+    */
+   void EndStep(const SForagingInputCounters& s_counters);
+
+private:
+
+   std::ofstream m_cFile;
+   UInt32 m_unTick;
+   std::vector<SForagingInputRobot> m_vecRobots;
+   /* The cells of the field at the start of a trial */
+   std::vector<CPheromoneField::SCell> m_vecCells;
+
+};
+
+/****************************************/
+/****************************************/
+
+class CForagingInputReader {
+
+public:
+
+   CForagingInputReader();
+
+   /*
+    * Opens the file and reads the header.
+    */
+   void Open(const std::string& str_file);
+
+   inline const SForagingSetup& GetSetup() const {
+      return m_sSetup;
+   }
+
+   /*
+    * Reads the next record; returns its tag, or zero at the end of the
+    * file or at a record cut by a crash.
+    */
+   UInt8 Next();
+
+   /*
+    * The last trial record.
+    */
+   inline UInt32 GetTrial() const { return m_unTrial; }
+   inline UInt32 GetFoodKey() const { return m_unFoodKey; }
+   inline UInt32 GetStartCollectedFood() const { return m_unStartCollectedFood; }
+   inline SInt64 GetStartEnergy() const { return m_nStartEnergy; }
+   inline const std::vector<CVector2>& GetFoodPositions() const { return m_vecFoodPos; }
+   inline const std::vector<UInt32>& GetFoodRespawns() const { return m_vecFoodRespawns; }
+   inline const std::vector<CPheromoneField::SCell>& GetPheromoneCells() const { return m_vecPheromone; }
+
+   /*
+    * The last step record, and the step of the last trial record.
+    */
+   inline UInt32 GetTick() const { return m_unTick; }
+   inline const std::vector<SForagingInputRobot>& GetRobots() const { return m_vecRobots; }
+   inline const SForagingInputCounters& GetCounters() const { return m_sCounters; }
+
+private:
+
+   std::ifstream m_cFile;
+   SForagingSetup m_sSetup;
+   UInt32 m_unTrial;
+   UInt32 m_unFoodKey;
+   UInt32 m_unStartCollectedFood;
+   SInt64 m_nStartEnergy;
+   std::vector<CVector2> m_vecFoodPos;
+   std::vector<UInt32> m_vecFoodRespawns;
+   std::vector<CPheromoneField::SCell> m_vecPheromone;
+   UInt32 m_unTick;
+   std::vector<SForagingInputRobot> m_vecRobots;
+   SForagingInputCounters m_sCounters;
+
+};
+
+#endif
@@ -1,21 +1,60 @@
 #include "foraging_loop_functions.h"
 #include <argos3/core/simulator/simulator.h>
 #include <argos3/core/utility/configuration/argos_configuration.h>
+#include <argos3/core/utility/logging/argos_log.h>
+#include <argos3/core/utility/math/rng.h>
 #include <argos3/plugins/robots/foot-bot/simulator/footbot_entity.h>
+#include <argos3/plugins/simulator/entities/box_entity.h>
 #include <footbot_foraging.h>
+#include <foraging_swarm_engine.h>
+#include "buzz_controller_foraging.h"
+#include "foraging_checkpoint.h"
+#include "foraging_event_log.h"
+#include <cstring>
+#include <limits>
 
 /****************************************/
 /****************************************/
 
 CForagingLoopFunctions::CForagingLoopFunctions() :
-   m_cForagingArenaSideX(1.1f, 1.9f),
-   m_cForagingArenaSideY(-0.35f, 0.35f),
    m_pcFloor(NULL),
    m_pcRNG(NULL),
-   m_unCollectedFood(0),
-   m_nEnergy(0),
-   m_unEnergyPerFoodItem(1),
-   m_unEnergyPerWalkingRobot(1) {
+   m_unTrial(0),
+   m_unFloorLevel(0),
+   m_unCheckpointSaveAt(0),
+   m_eTerminationReason(TERMINATION_NONE),
+   m_unHistoryTicks(0),
+   m_bStats(false),
+   m_unStatsInterval(0),
+   m_bPerStepOutput(true),
+   m_unWalking(0),
+   m_unResting(0),
+   m_unRateStartTick(0),
+   m_fStepsPerSecond(0.0),
+   m_unPheromoneFramesInterval(0) {
+}
+
+/****************************************/
+/****************************************/
+
+CForagingLoopFunctions::STerminationParams::STerminationParams() :
+   SteadyWindow(0),
+   SteadyTolerance(0.05),
+   FoodTarget(0),
+   EnergyTarget(0),
+   WallClockBudget(0.0) {}
+
+void CForagingLoopFunctions::STerminationParams::Init(TConfigurationNode& t_node) {
+   try {
+      GetNodeAttributeOrDefault(t_node, "steady_window", SteadyWindow, SteadyWindow);
+      GetNodeAttributeOrDefault(t_node, "steady_tolerance", SteadyTolerance, SteadyTolerance);
+      GetNodeAttributeOrDefault(t_node, "food_target", FoodTarget, FoodTarget);
+      GetNodeAttributeOrDefault(t_node, "energy_target", EnergyTarget, EnergyTarget);
+      GetNodeAttributeOrDefault(t_node, "wall_clock_budget", WallClockBudget, WallClockBudget);
+   }
+   catch(CARGoSException& ex) {
+      THROW_ARGOSEXCEPTION_NESTED("Error initializing termination parameters.", ex);
+   }
 }
 
 /****************************************/
@@ -32,19 +71,21 @@ void CForagingLoopFunctions::Init(TConfigurationNode& t_node) {
       /* Get the number of food items we want to be scattered from XML */
       GetNodeAttribute(tForaging, "radius", m_fFoodSquareRadius);
       m_fFoodSquareRadius *= m_fFoodSquareRadius;
-      /* Create a new RNG */
+      /* Distribute uniformly the items in the environment, from a key
+         drawn from the seed of the experiment */
       m_pcRNG = CRandom::CreateRNG("argos");
-      /* Distribute uniformly the items in the environment */
-      for(UInt32 i = 0; i < unFoodItems; ++i) {
-      m_cFoodPos.push_back(
-         CVector2(m_pcRNG->Uniform(m_cForagingArenaSideX),
-                  m_pcRNG->Uniform(m_cForagingArenaSideY)));
-      }
+      m_cFoodPos.resize(unFoodItems);
+      PlaceFood(m_pcRNG->Uniform(CRange<UInt32>(0, std::numeric_limits<UInt32>::max())));
       /* Get the output file name from XML */
       GetNodeAttribute(tForaging, "output", m_strOutput);
+      /* Give the file a large buffer: it must be set before opening */
+      m_vecOutputBuffer.resize(1 << 16);
+      m_cOutput.rdbuf()->pubsetbuf(&m_vecOutputBuffer[0], m_vecOutputBuffer.size());
       /* Open the file, erasing its contents */
       m_cOutput.open(m_strOutput.c_str(), std::ios_base::trunc | std::ios_base::out);
-      m_cOutput << "# clock\twalking\tresting\tcollected_food\tenergy" << std::endl;
+      m_unTrial = 0;
+      m_cOutput << "# trial\t" << m_unTrial << "\n"
+                << "# clock\twalking\tresting\tcollected_food\tenergy" << std::endl;
       /* Get energy gain per item collected */
       GetNodeAttribute(tForaging, "energy_per_item", m_unEnergyPerFoodItem);
       /* Get energy loss per walking robot */
@@ -56,15 +97,243 @@ void CForagingLoopFunctions::Init(TConfigurationNode& t_node) {
       GetNodeAttribute(tPheromones, "interior_height", unHeight);
       GetNodeAttribute(tPheromones, "resolution", unResolution);
       GetNodeAttribute(tPheromones, "intensity", unIntensity);
-      GetNodeAttribute(tPheromones, "dissipation", unDissipation);
       GetNodeAttribute(tPheromones, "radius", unRadius);
+      /* Linear decay subtracts dissipation at each step, exponential decay
+         removes the evaporation fraction */
+      std::string strDecay = "linear";
+      GetNodeAttributeOrDefault(tPheromones, "decay", strDecay, strDecay);
+      CPheromoneField::EDecay eDecay;
+      UInt32 unDecayPeriod = 1;
+      if(strDecay == "linear") {
+         eDecay = CPheromoneField::DECAY_LINEAR;
+         GetNodeAttribute(tPheromones, "dissipation", unDissipation);
+      }
+      else if(strDecay == "exponential") {
+         eDecay = CPheromoneField::DECAY_EXPONENTIAL;
+         GetNodeAttribute(tPheromones, "evaporation", m_fEvaporation);
+         if(m_fEvaporation <= 0.0 || m_fEvaporation >= 1.0) {
+            THROW_ARGOSEXCEPTION("The pheromone evaporation must be between 0 and 1, excluded");
+         }
+         m_fEvaporationThreshold = 1.0;
+         GetNodeAttributeOrDefault(tPheromones, "threshold", m_fEvaporationThreshold, m_fEvaporationThreshold);
+         /* The sweep only drops the cells that ran out */
+         unDecayPeriod = 10;
+      }
+      else {
+         THROW_ARGOSEXCEPTION("Unknown pheromone decay \"" << strDecay << "\", expected linear or exponential");
+      }
       GetNodeAttribute(tPheromones, "strong", unStrong);
+      /* Decay the field in a background thread, overlapping the step? */
+      bool bPipelined = false;
+      GetNodeAttributeOrDefault(tPheromones, "pipelined", bPipelined, bPipelined);
+      /* Maintain a mip pyramid of the field? */
+      bool bPyramid = false;
+      GetNodeAttributeOrDefault(tPheromones, "pyramid", bPyramid, bPyramid);
+      /* Split the field among threads? */
+      UInt32 unPheromoneThreads = 1;
+      GetNodeAttributeOrDefault(tPheromones, "threads", unPheromoneThreads, unPheromoneThreads);
+      /* Sweep the decay every so many steps? */
+      GetNodeAttributeOrDefault(tPheromones, "decay_period", unDecayPeriod, unDecayPeriod);
+      /* Allocate the field once and for all */
+      m_cPheromoneField.Init(unWidth, unHeight, unResolution, unRadius,
+                             bPipelined, bPyramid, unPheromoneThreads, unDecayPeriod,
+                             eDecay, m_fEvaporationThreshold);
+      /* With the pyramid, a floor texel coarser than a cell shows the
+         largest value of the block of cells it covers */
+      m_unFloorLevel = 0;
+      TConfigurationNode& tArena = GetNode(CSimulator::GetInstance().GetConfigurationRoot(), "arena");
+      if(bPyramid && NodeExists(tArena, "floor")) {
+         Real fPixelsPerMeter = 0.0;
+         GetNodeAttributeOrDefault(GetNode(tArena, "floor"), "pixels_per_meter", fPixelsPerMeter, fPixelsPerMeter);
+         while(fPixelsPerMeter > 0.0 &&
+               m_unFloorLevel + 1 < m_cPheromoneField.GetPyramidLevels() &&
+               (1 << (m_unFloorLevel + 1)) * fPixelsPerMeter <= unResolution) {
+            ++m_unFloorLevel;
+         }
+      }
+
+      /* The bulletin board covers the arena, with cells as large as the
+         range and bearing range of the foot-bots by default */
+      Real fBulletinRange = 3.0;
+      if(NodeExists(t_node, "bulletin")) {
+         GetNodeAttributeOrDefault(GetNode(t_node, "bulletin"), "range", fBulletinRange, fBulletinRange);
+      }
+      if(fBulletinRange <= 0.0) {
+         THROW_ARGOSEXCEPTION("The bulletin board range must be positive");
+      }
+      const CVector3& cArenaSize = GetSpace().GetArenaSize();
+      const CVector3& cArenaCenter = GetSpace().GetArenaCenter();
+      m_cBulletin.Init(CVector2(cArenaCenter.GetX() - cArenaSize.GetX() * 0.5,
+                                cArenaCenter.GetY() - cArenaSize.GetY() * 0.5),
+                       CVector2(cArenaCenter.GetX() + cArenaSize.GetX() * 0.5,
+                                cArenaCenter.GetY() + cArenaSize.GetY() * 0.5),
+                       fBulletinRange);
+
+      /* Stop criteria are optional */
+      if(NodeExists(t_node, "termination")) {
+         m_sTerminationParams.Init(GetNode(t_node, "termination"));
+      }
+      m_vecCollectedHistory.assign(2 * m_sTerminationParams.SteadyWindow + 1, 0);
+      m_unHistoryTicks = 0;
+      m_eTerminationReason = TERMINATION_NONE;
+      m_tStartTime = std::chrono::steady_clock::now();
 
-        /* dynamic 2D array assignment of pheromone matrix*/
-//        PheromoneTrail = new int*[unHeight*unResolution];
-//        for (int i = 0; i < unHeight*unResolution; ++i) {
-//            PheromoneTrail[i] = new int[unWidth*unResolution];
-//        }
+      /* Checkpoints are optional */
+      if(NodeExists(t_node, "checkpoint")) {
+         TConfigurationNode& tCheckpoint = GetNode(t_node, "checkpoint");
+         GetNodeAttributeOrDefault(tCheckpoint, "save", m_strCheckpointSave, m_strCheckpointSave);
+         GetNodeAttributeOrDefault(tCheckpoint, "save_at", m_unCheckpointSaveAt, m_unCheckpointSaveAt);
+         GetNodeAttributeOrDefault(tCheckpoint, "restore", m_strCheckpointRestore, m_strCheckpointRestore);
+      }
+      if(!m_strCheckpointRestore.empty()) {
+         RestoreCheckpoint(m_strCheckpointRestore);
+      }
+
+      /* Streaming statistics are optional */
+      if(NodeExists(t_node, "stats")) {
+         TConfigurationNode& tStats = GetNode(t_node, "stats");
+         UInt32 unWindow = 1000;
+         GetNodeAttributeOrDefault(tStats, "interval", m_unStatsInterval, m_unStatsInterval);
+         GetNodeAttributeOrDefault(tStats, "window", unWindow, unWindow);
+         GetNodeAttributeOrDefault(tStats, "per_step", m_bPerStepOutput, m_bPerStepOutput);
+         if(unWindow == 0) {
+            THROW_ARGOSEXCEPTION("The statistics window must be positive");
+         }
+         m_cStats.Init(unWindow);
+         m_bStats = true;
+      }
+
+      /* Live metrics are optional */
+      if(NodeExists(t_node, "metrics")) {
+         std::string strShm = "/foraging";
+         GetNodeAttributeOrDefault(GetNode(t_node, "metrics"), "shm", strShm, strShm);
+         m_cMetrics.Open(strShm);
+      }
+      m_tRateStart = std::chrono::steady_clock::now();
+      m_unRateStartTick = GetSpace().GetSimulationClock();
+      m_fStepsPerSecond = 0.0;
+
+      /* The event stream is optional. The robots are numbered in the order
+         of the foot-bot map, which is sorted by id. */
+      CSpace::TMapPerType& m_cFootbots = GetSpace().GetEntitiesByType("foot-bot");
+      std::vector<std::string> vecRobotIds;
+      UInt32 unBuzzRobots = 0;
+      for(CSpace::TMapPerType::iterator it = m_cFootbots.begin();
+          it != m_cFootbots.end();
+          ++it) {
+         CFootBotEntity& cFootBot = *any_cast<CFootBotEntity*>(it->second);
+         CCI_Controller& cController = cFootBot.GetControllableEntity().GetController();
+         CFootBotForaging* pcController = dynamic_cast<CFootBotForaging*>(&cController);
+         if(pcController != NULL) {
+            pcController->SetEventId(vecRobotIds.size());
+         }
+         else {
+            dynamic_cast<CBuzzControllerForaging&>(cController).SetEventId(vecRobotIds.size());
+            ++unBuzzRobots;
+         }
+         vecRobotIds.push_back(cFootBot.GetId());
+      }
+      if(NodeExists(t_node, "events")) {
+         TConfigurationNode& tEvents = GetNode(t_node, "events");
+         std::string strEventFile;
+         UInt32 unCapacity = 65536;
+         GetNodeAttribute(tEvents, "file", strEventFile);
+         GetNodeAttributeOrDefault(tEvents, "capacity", unCapacity, unCapacity);
+         if(unCapacity == 0) {
+            THROW_ARGOSEXCEPTION("The event buffer capacity must be positive");
+         }
+         CForagingEventLog::GetInstance().Open(strEventFile, unCapacity, vecRobotIds);
+      }
+
+      /* The trajectory recorder is optional, and numbers the robots the
+         same way */
+      if(NodeExists(t_node, "trajectory")) {
+         TConfigurationNode& tTrajectory = GetNode(t_node, "trajectory");
+         std::string strTrajectoryFile;
+         Real fQuantum = 0.001;
+         UInt32 unChunkTicks = 100;
+         GetNodeAttribute(tTrajectory, "file", strTrajectoryFile);
+         GetNodeAttributeOrDefault(tTrajectory, "quantum", fQuantum, fQuantum);
+         GetNodeAttributeOrDefault(tTrajectory, "chunk", unChunkTicks, unChunkTicks);
+         m_cTrajectory.Open(strTrajectoryFile, fQuantum, unChunkTicks, vecRobotIds);
+      }
+
+      /* The visitation heatmap is optional, and covers the arena */
+      if(NodeExists(t_node, "heatmap")) {
+         TConfigurationNode& tHeatmap = GetNode(t_node, "heatmap");
+         std::string strHeatmapFile;
+         Real fCellSize = 0.05;
+         UInt32 unInterval = 1;
+         GetNodeAttribute(tHeatmap, "file", strHeatmapFile);
+         GetNodeAttributeOrDefault(tHeatmap, "resolution", fCellSize, fCellSize);
+         GetNodeAttributeOrDefault(tHeatmap, "interval", unInterval, unInterval);
+         m_cHeatmap.Open(strHeatmapFile,
+                         CVector2(cArenaCenter.GetX() - cArenaSize.GetX() * 0.5,
+                                  cArenaCenter.GetY() - cArenaSize.GetY() * 0.5),
+                         CVector2(cArenaCenter.GetX() + cArenaSize.GetX() * 0.5,
+                                  cArenaCenter.GetY() + cArenaSize.GetY() * 0.5),
+                         fCellSize,
+                         unInterval);
+      }
+
+      /* The homing field is optional, and covers the arena */
+      if(NodeExists(t_node, "homing")) {
+         TConfigurationNode& tHoming = GetNode(t_node, "homing");
+         Real fCellSize = 0.05;
+         Real fClearance = 0.1;
+         GetNodeAttributeOrDefault(tHoming, "resolution", fCellSize, fCellSize);
+         GetNodeAttributeOrDefault(tHoming, "clearance", fClearance, fClearance);
+         m_cHomingField.Init(CVector2(cArenaCenter.GetX() - cArenaSize.GetX() * 0.5,
+                                      cArenaCenter.GetY() - cArenaSize.GetY() * 0.5),
+                             CVector2(cArenaCenter.GetX() + cArenaSize.GetX() * 0.5,
+                                      cArenaCenter.GetY() + cArenaSize.GetY() * 0.5),
+                             fCellSize);
+         /* The arena may have no box at all */
+         CSpace::TMapPerTypePerId& cEntities = GetSpace().GetEntityMapPerTypePerId();
+         CSpace::TMapPerTypePerId::iterator itBoxes = cEntities.find("box");
+         if(itBoxes != cEntities.end()) {
+            for(CSpace::TMapPerType::iterator it = itBoxes->second.begin();
+                it != itBoxes->second.end();
+                ++it) {
+               CBoxEntity& cBox = *any_cast<CBoxEntity*>(it->second);
+               const SAnchor& sAnchor = cBox.GetEmbodiedEntity().GetOriginAnchor();
+               CRadians cYaw, cPitch, cRoll;
+               sAnchor.Orientation.ToEulerAngles(cYaw, cPitch, cRoll);
+               m_cHomingField.AddBox(CVector2(sAnchor.Position.GetX(), sAnchor.Position.GetY()),
+                                     CVector2(cBox.GetSize().GetX(), cBox.GetSize().GetY()),
+                                     cYaw,
+                                     fClearance);
+            }
+         }
+         /* The nest, as in CForagingCore::StepRobot() */
+         m_cHomingField.Compute(-1.0);
+      }
+
+      /* Pheromone field snapshots are optional */
+      if(NodeExists(t_node, "pheromone_frames")) {
+         TConfigurationNode& tFrames = GetNode(t_node, "pheromone_frames");
+         std::string strFramesFile;
+         UInt32 unKeyframeInterval = 50;
+         m_unPheromoneFramesInterval = 10;
+         GetNodeAttribute(tFrames, "file", strFramesFile);
+         GetNodeAttributeOrDefault(tFrames, "interval", m_unPheromoneFramesInterval, m_unPheromoneFramesInterval);
+         GetNodeAttributeOrDefault(tFrames, "keyframe", unKeyframeInterval, unKeyframeInterval);
+         if(m_unPheromoneFramesInterval == 0) {
+            THROW_ARGOSEXCEPTION("The pheromone frame interval must be positive");
+         }
+         m_cPheromoneFrames.Open(strFramesFile, m_cPheromoneField, unKeyframeInterval);
+      }
+
+      /* The input recording is optional */
+      if(NodeExists(t_node, "inputs")) {
+         std::string strInputsFile;
+         GetNodeAttribute(GetNode(t_node, "inputs"), "file", strInputsFile);
+         if(unBuzzRobots > 0) {
+            THROW_ARGOSEXCEPTION("The input recording does not support Buzz controllers: their deposits are not recorded");
+         }
+         m_cInputs.Open(strInputsFile, *this);
+         m_cInputs.BeginTrial(m_unTrial, GetSpace().GetSimulationClock(), *this);
+      }
    }
    catch(CARGoSException& ex) {
       THROW_ARGOSEXCEPTION_NESTED("Error parsing loop functions!", ex);
@@ -75,31 +344,97 @@ void CForagingLoopFunctions::Init(TConfigurationNode& t_node) {
 /****************************************/
 
 void CForagingLoopFunctions::Reset() {
+   std::chrono::steady_clock::time_point tSetupStart = std::chrono::steady_clock::now();
+   /* Summarise the trial that just ended */
+   if(m_bStats) {
+      WriteStats("summary");
+      m_cStats.Reset();
+   }
    /* Zero the counters */
    m_unCollectedFood = 0;
    m_nEnergy = 0;
-   /* Close the file */
-   m_cOutput.close();
-   /* Open the file, erasing its contents */
-   m_cOutput.open(m_strOutput.c_str(), std::ios_base::trunc | std::ios_base::out);
-   m_cOutput << "# clock\twalking\tresting\tcollected_food\tenergy" << std::endl;
-   /* Distribute uniformly the items in the environment */
-   for(UInt32 i = 0; i < m_cFoodPos.size(); ++i) {
-      m_cFoodPos[i].Set(m_pcRNG->Uniform(m_cForagingArenaSideX),
-                        m_pcRNG->Uniform(m_cForagingArenaSideY));
+   /* Start a new section of the output file instead of truncating it */
+   ++m_unTrial;
+   m_cOutput << "# trial\t" << m_unTrial << "\n"
+             << "# clock\twalking\tresting\tcollected_food\tenergy\n";
+   /* Distribute uniformly the items in the environment, from a key drawn
+      again from the reseeded generator */
+   PlaceFood(m_pcRNG->Uniform(CRange<UInt32>(0, std::numeric_limits<UInt32>::max())));
+
+   /* Clear the pheromone field, keeping its memory */
+   m_cPheromoneField.Clear();
+   m_vecCarrying.clear();
+
+   /* Restart the stop criteria */
+   std::fill(m_vecCollectedHistory.begin(), m_vecCollectedHistory.end(), 0);
+   m_unHistoryTicks = 0;
+   m_eTerminationReason = TERMINATION_NONE;
+   m_tStartTime = std::chrono::steady_clock::now();
+   m_unWalking = 0;
+   m_unResting = 0;
+
+   /* Start again from the checkpoint, if any */
+   if(!m_strCheckpointRestore.empty()) {
+      RestoreCheckpoint(m_strCheckpointRestore);
+   }
+   if(m_cInputs.IsEnabled()) {
+      m_cInputs.BeginTrial(m_unTrial, GetSpace().GetSimulationClock(), *this);
    }
 
-   /* Clear the pheromone map */
-   PheromoneMap.clear();
+   /* The step counter restarts */
+   m_tRateStart = std::chrono::steady_clock::now();
+   m_unRateStartTick = GetSpace().GetSimulationClock();
 
+   /* Mark the start of the trial in the event stream */
+   CForagingEventLog& cEventLog = CForagingEventLog::GetInstance();
+   if(cEventLog.IsEnabled()) {
+      SForagingEvent sEvent;
+      ::memset(&sEvent, 0, sizeof(sEvent));
+      sEvent.Tick = GetSpace().GetSimulationClock();
+      sEvent.Type = SForagingEvent::EVENT_TRIAL;
+      sEvent.Item = m_unTrial;
+      cEventLog.Emit(sEvent);
+      cEventLog.Flush(sEvent.Tick);
+   }
+
+   /* Report how long the setup took, to compare it with the trial length */
+   std::chrono::duration<Real, std::micro> tSetup = std::chrono::steady_clock::now() - tSetupStart;
+   m_cOutput << "# trial_setup_us\t" << tSetup.count() << std::endl;
+   LOG << "[INFO] Trial " << m_unTrial << " set up in " << tSetup.count() << " us" << std::endl;
 }
 
 /****************************************/
 /****************************************/
 
 void CForagingLoopFunctions::Destroy() {
-   /* Close the file */
+   /* If none of our criteria fired, ARGoS stopped on the experiment
+      length, or the run was stopped before it (by the user, or with no
+      length) */
+   if(m_eTerminationReason == TERMINATION_NONE) {
+      UInt32 unLength = CSimulator::GetInstance().GetMaxSimulationClock();
+      if(unLength > 0 && GetSpace().GetSimulationClock() >= unLength) {
+         LogTermination("experiment_length");
+      }
+      else {
+         LogTermination("stopped");
+      }
+   }
+   if(m_bStats) {
+      WriteStats("summary");
+   }
+   /* Tell the monitors we are done */
+   if(m_cMetrics.IsEnabled()) {
+      PublishMetrics(true);
+      m_cMetrics.Close();
+   }
+   /* Close the files */
    m_cOutput.close();
+   m_cTrajectory.Close();
+   m_cHeatmap.Close();
+   m_cPheromoneFrames.Close();
+   m_cInputs.Close();
+   CForagingEventLog::GetInstance().Flush(GetSpace().GetSimulationClock());
+   CForagingEventLog::GetInstance().Close();
 }
 
 /****************************************/
@@ -116,18 +451,20 @@ CColor CForagingLoopFunctions::GetFloorColor(const CVector2& c_position_on_plane
       }
    }
    /* find the coordinate position after discretizing with the resolution */
-   int xLoc = std::round(c_position_on_plane.GetX()*unResolution);
-   int yLoc = std::round(c_position_on_plane.GetY()*unResolution);
-   /* Grab the iterator of the given location; if none, find() will return the iterator that end() returns */
-   std::map<std::pair<int,int>, int>::iterator itr = PheromoneMap.find(std::pair<int,int>(xLoc,yLoc));
+   Real fPheromone = m_unFloorLevel == 0 ?
+      m_cPheromoneField.Get(m_cPheromoneField.ToCell(c_position_on_plane.GetX()),
+                            m_cPheromoneField.ToCell(c_position_on_plane.GetY())) :
+      m_cPheromoneField.GetBlockMax(m_cPheromoneField.ToCell(c_position_on_plane.GetX()),
+                                    m_cPheromoneField.ToCell(c_position_on_plane.GetY()),
+                                    m_unFloorLevel);
    /* Check if the current location has a pheromone value */
-   if (itr != PheromoneMap.end()) {
+   if (fPheromone > 0.0) {
       /* return color of pheromone based on intensity. If above the strong threshold, the color is just yellow. */
-      if (itr->second >= unStrong) {
+      if (fPheromone >= unStrong) {
          return CColor::YELLOW;
       }
       else {
-         UInt8 alpha = 255 * (itr->second % unStrong) / unStrong;
+         UInt8 alpha = 255 * std::fmod(fPheromone, unStrong) / unStrong;
          /* create color with alpha based on how much pheromone is left*/
          CColor mixed = CColor(255,255,0,alpha);
          return mixed.Blend(CColor::WHITE);
@@ -148,122 +485,555 @@ void CForagingLoopFunctions::PreStep() {
     */
    UInt32 unWalkingFBs = 0;
    UInt32 unRestingFBs = 0;
+   UInt32 unCollectedNow = 0;
+   UInt32 punStateCounts[CForagingStats::NUM_STATES] = { 0 };
+   /* The bulletin board holds the results of the last step only */
+   m_cBulletin.Clear();
+   m_vecBulletinReaders.clear();
+   /* The robots carrying an item, for the viewer */
+   m_vecCarrying.clear();
    /* Check whether a robot is on a food item */
    CSpace::TMapPerType& m_cFootbots = GetSpace().GetEntitiesByType("foot-bot");
+   if(m_cTrajectory.IsEnabled()) {
+      m_cTrajectory.BeginStep(m_unTrial, GetSpace().GetSimulationClock());
+   }
+   if(m_cInputs.IsEnabled()) {
+      m_cInputs.BeginStep(GetSpace().GetSimulationClock());
+   }
+   /* Whether the heatmap bins the robots in this step */
+   bool bHeatmap = m_cHeatmap.BeginStep(GetSpace().GetSimulationClock());
 
    for(CSpace::TMapPerType::iterator it = m_cFootbots.begin();
        it != m_cFootbots.end();
        ++it) {
       /* Get handle to foot-bot entity and controller */
       CFootBotEntity& cFootBot = *any_cast<CFootBotEntity*>(it->second);
-      CFootBotForaging& cController = dynamic_cast<CFootBotForaging&>(cFootBot.GetControllableEntity().GetController());
-      /* Count how many foot-bots are in which state */
-      if(! cController.IsResting()) ++unWalkingFBs;
-      else ++unRestingFBs;
       /* Get the position of the foot-bot on the ground as a CVector2 */
       CVector2 cPos;
       cPos.Set(cFootBot.GetEmbodiedEntity().GetOriginAnchor().Position.GetX(),
                cFootBot.GetEmbodiedEntity().GetOriginAnchor().Position.GetY());
-      /* Get food data */
-      CFootBotForaging::SFoodData& sFoodData = cController.GetFoodData();
-      /* The foot-bot has a food item */
-      if(sFoodData.HasFoodItem) {
-         /* Check whether the foot-bot is in the nest */
-         if(cPos.GetX() < -1.0f) {
-            /* Place a new food item on the ground */
-            m_cFoodPos[sFoodData.FoodItemIdx].Set(m_pcRNG->Uniform(m_cForagingArenaSideX),
-                                                  m_pcRNG->Uniform(m_cForagingArenaSideY));
-            /* Drop the food item */
-            sFoodData.HasFoodItem = false;
-            sFoodData.FoodItemIdx = 0;
-            ++sFoodData.TotalFoodItems;
-            /* Increase the energy and food count */
-            m_nEnergy += m_unEnergyPerFoodItem;
-            ++m_unCollectedFood;
-            /* The floor texture must be updated */
-            m_pcFloor->SetChanged();
+      CCI_Controller& cCIController = cFootBot.GetControllableEntity().GetController();
+      CFootBotForaging* pcController = dynamic_cast<CFootBotForaging*>(&cCIController);
+      if(pcController == NULL) {
+         /* A Buzz foot-bot: the script told its state, and its deposits
+            are laid with the trail */
+         CBuzzControllerForaging& cBuzzController = dynamic_cast<CBuzzControllerForaging&>(cCIController);
+         if(! cBuzzController.IsResting()) ++unWalkingFBs;
+         else ++unRestingFBs;
+         ++punStateCounts[cBuzzController.GetState()];
+         if(bHeatmap) {
+            m_cHeatmap.AddVisit(cPos, cBuzzController.GetState());
          }
-         /* put the location of the pheromone trail into the hashmap, adding to the intensity if the value is already filled */
-         for (int y = -1*unRadius; y <= unRadius; y++) {
-            for (int x = -1*unRadius; x <= unRadius; x++) {
-               /* calculate distance from center */
-               float distance = sqrt((x)^2+(y)^2);
-               /* find the coordinate position after discretizing with the resolution */
-               int xMat = std::round(cPos.GetX()*unResolution) + x;
-               int yMat = std::round(cPos.GetY()*unResolution) + y;
-               /* Grab the iterator of the current location; if none find() will return the iterator that end() returns */
-               std::map<std::pair<int,int>, int>::iterator itr = PheromoneMap.find(std::pair<int,int>(xMat,yMat));
-               if (itr != PheromoneMap.end()) {
-                  /* Add pheromone intensity to the current location */
-                  itr->second += unIntensity;// - std::round(unIntensity*distance/sqrt(2*(unRadius)^2));
-               }
-                  /* If the current location is devoid of pheromones */
-               else {
-                  /* add pheromone at the current location to the hashmap */
-                  PheromoneMap.insert(std::pair<std::pair<int,int>,int>(std::pair<int,int>(xMat,yMat), unIntensity )); //- std::round(unIntensity*distance/sqrt(2*(unRadius)^2))));
-               }
+         CFootBotForaging::SFoodData& sFoodData = cBuzzController.GetFoodData();
+         if(m_cTrajectory.IsEnabled()) {
+            CRadians cYaw, cPitch, cRoll;
+            cFootBot.GetEmbodiedEntity().GetOriginAnchor().Orientation.ToEulerAngles(cYaw, cPitch, cRoll);
+            UInt8 unState = cBuzzController.GetState();
+            if(sFoodData.HasFoodItem) {
+               unState |= TRAJECTORY_CARRYING_FOOD;
             }
+            m_cTrajectory.Record(cPos, cYaw, unState);
+         }
+         Real fDeposit = cBuzzController.TakeDeposit();
+         if(fDeposit > 0.0) {
+            DepositAt(cPos, fDeposit);
+         }
+         StepFoodData(sFoodData, cBuzzController.GetEventId(), cBuzzController.IsResting(), cPos, unCollectedNow);
+         if(sFoodData.HasFoodItem) {
+            m_vecCarrying.push_back(&cFootBot);
          }
+         continue;
       }
-      else {
-         /* The foot-bot has no food item */
-         /* Check whether the foot-bot is out of the nest */
-         if(cPos.GetX() > -1.0f) {
-            /* Check whether the foot-bot is on a food item */
-            bool bDone = false;
-            for(size_t i = 0; i < m_cFoodPos.size() && !bDone; ++i) {
-               if((cPos - m_cFoodPos[i]).SquareLength() < m_fFoodSquareRadius) {
-                  /* If so, we move that item out of sight */
-                  m_cFoodPos[i].Set(100.0f, 100.f);
-                  /* The foot-bot is now carrying an item */
-                  sFoodData.HasFoodItem = true;
-                  sFoodData.FoodItemIdx = i;
-                  /* The floor texture must be updated */
-                  m_pcFloor->SetChanged();
-                  /* We are done */
-                  bDone = true;
-               }
-            }
+      CFootBotForaging& cController = *pcController;
+      /* Count how many foot-bots are in which state */
+      if(! cController.IsResting()) ++unWalkingFBs;
+      else ++unRestingFBs;
+      ++punStateCounts[cController.GetState()];
+      if(bHeatmap) {
+         m_cHeatmap.AddVisit(cPos, cController.GetState());
+      }
+      /* Record the pose and the state the robot had in the last step */
+      if(m_cTrajectory.IsEnabled()) {
+         CRadians cYaw, cPitch, cRoll;
+         cFootBot.GetEmbodiedEntity().GetOriginAnchor().Orientation.ToEulerAngles(cYaw, cPitch, cRoll);
+         UInt8 unState = cController.GetState();
+         if(cController.GetFoodData().HasFoodItem) {
+            unState |= TRAJECTORY_CARRYING_FOOD;
+         }
+         m_cTrajectory.Record(cPos, cYaw, unState);
+      }
+      /* Post the result told in the last step, and remember who listens */
+      if(cController.UsesBulletin()) {
+         const CFootBotForaging::SBulletin& sBulletin = cController.GetBulletin();
+         if(sBulletin.Posted != CFootBotForaging::LAST_EXPLORATION_NONE) {
+            m_cBulletin.Post(cPos, sBulletin.Posted == CFootBotForaging::LAST_EXPLORATION_SUCCESSFUL);
          }
+         if(cController.IsResting()) {
+            m_vecBulletinReaders.push_back(std::make_pair(&cController, cPos));
+         }
+      }
+      /* Pick or drop food, and lay the trail */
+      StepFoodData(cController.GetFoodData(), cController.GetEventId(), cController.IsResting(), cPos, unCollectedNow);
+      if(cController.GetFoodData().HasFoodItem) {
+         m_vecCarrying.push_back(&cFootBot);
+      }
+   }
+   /* Deliver the bulletin board, without the robots' own results */
+   for(size_t i = 0; i < m_vecBulletinReaders.size(); ++i) {
+      CFootBotForaging::SBulletin& sBulletin = m_vecBulletinReaders[i].first->GetBulletin();
+      m_cBulletin.Read(m_vecBulletinReaders[i].second,
+                       sBulletin.HeardSuccessful,
+                       sBulletin.HeardUnsuccessful);
+      if(sBulletin.Posted == CFootBotForaging::LAST_EXPLORATION_SUCCESSFUL) {
+         --sBulletin.HeardSuccessful;
+      }
+      else if(sBulletin.Posted == CFootBotForaging::LAST_EXPLORATION_UNSUCCESSFUL) {
+         --sBulletin.HeardUnsuccessful;
       }
    }
-   /* Update energy expediture due to walking robots */
-   m_nEnergy -= unWalkingFBs * m_unEnergyPerWalkingRobot;
+   if(m_cTrajectory.IsEnabled()) {
+      m_cTrajectory.EndStep();
+   }
+   m_unWalking = unWalkingFBs;
+   m_unResting = unRestingFBs;
+   /* Charge the walking robots; the decay can start while the robots
+      sense the field and act */
+   EndRobots(unWalkingFBs);
+   if(m_cInputs.IsEnabled()) {
+      SForagingInputCounters sCounters;
+      sCounters.Walking = unWalkingFBs;
+      sCounters.Resting = unRestingFBs;
+      sCounters.CollectedFood = m_unCollectedFood;
+      sCounters.ActiveCells = m_cPheromoneField.GetActiveCellCount();
+      sCounters.Energy = m_nEnergy;
+      sCounters.PheromoneTotal = m_cPheromoneField.GetTotal();
+      m_cInputs.EndStep(sCounters);
+   }
    /* Output stuff to file */
-   m_cOutput << GetSpace().GetSimulationClock() << "\t"
-             << unWalkingFBs << "\t"
-             << unRestingFBs << "\t"
-             << m_unCollectedFood << "\t"
-             << m_nEnergy << std::endl;
-
+   if(m_bPerStepOutput) {
+      m_cOutput << GetSpace().GetSimulationClock() << "\t"
+                << unWalkingFBs << "\t"
+                << unRestingFBs << "\t"
+                << m_unCollectedFood << "\t"
+                << m_nEnergy << "\n";
+   }
+   /* Update the streaming statistics, and report them at the interval */
+   if(m_bStats) {
+      m_cStats.AddStep(GetSpace().GetSimulationClock(), unCollectedNow, m_nEnergy, punStateCounts);
+      if(m_unStatsInterval > 0 &&
+         GetSpace().GetSimulationClock() % m_unStatsInterval == 0) {
+         WriteStats("stats");
+      }
+   }
+   /* Keep the collected food history for the steady-state criterion */
+   if(m_sTerminationParams.SteadyWindow > 0) {
+      m_vecCollectedHistory[m_unHistoryTicks % m_vecCollectedHistory.size()] = m_unCollectedFood;
+      ++m_unHistoryTicks;
+   }
 }
 /****************************************/
 /****************************************/
 
 void CForagingLoopFunctions::PostStep() {
 
-   /* Create an iterator for looping through the pheromone map */
-   std::map<std::pair<int,int>, int>::iterator it = PheromoneMap.begin();
+   /* All the robots have sensed: run the batched controllers, if any */
+   CForagingSwarmEngine& cEngine = CForagingSwarmEngine::GetInstance();
+   if(!cEngine.IsEmpty()) {
+      cEngine.Step();
+   }
 
-   /* Loop through the entire pheromone map to dissipate pheromones */
-   while (it != PheromoneMap.end()){
-      /* Read out the pheromone map */
-//      std::cout << it->first.first << ", " << it->first.second << " :: " << it->second << std::endl;
-      /* Reduce pheromone by the dissipation rate */
-      it->second -= unDissipation;
-      /* If the pheromone reaches zero, delete the item from the map */
-      if (it->second <= 0) {
-         it = PheromoneMap.erase(it);
-      }
-      else{
-         /* Increment the Iterator to point to next entry */
-         it ++;
-      }
+   /* Reduce pheromone by the dissipation rate; cells reaching zero are removed */
+   m_cPheromoneField.EndDecay();
+
+   /* Snapshot the field; it is encoded in the background */
+   if(m_cPheromoneFrames.IsEnabled() &&
+      GetSpace().GetSimulationClock() % m_unPheromoneFramesInterval == 0) {
+      m_cPheromoneFrames.Submit(m_unTrial, GetSpace().GetSimulationClock(), m_cPheromoneField);
    }
 
    /* The floor texture must be updated */
    m_pcFloor->SetChanged();
 
+   /* Write the checkpoint at the end of the requested step */
+   if(!m_strCheckpointSave.empty() &&
+      GetSpace().GetSimulationClock() == m_unCheckpointSaveAt) {
+      SaveCheckpoint(m_strCheckpointSave);
+   }
+
+   /* The controllers are done: write the events of this step */
+   CForagingEventLog::GetInstance().Flush(GetSpace().GetSimulationClock());
+
+   /* Let the monitors see the end of the step */
+   if(m_cMetrics.IsEnabled()) {
+      PublishMetrics(false);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+bool CForagingLoopFunctions::IsExperimentFinished() {
+   if(m_eTerminationReason != TERMINATION_NONE) {
+      return true;
+   }
+   /* Food and energy targets */
+   if(m_sTerminationParams.FoodTarget > 0 &&
+      m_unCollectedFood >= m_sTerminationParams.FoodTarget) {
+      m_eTerminationReason = TERMINATION_FOOD_TARGET;
+      LogTermination("food_target");
+      return true;
+   }
+   /* Energy starts at zero: a positive target is reached from below, a
+      negative one (an energy budget) from above */
+   if((m_sTerminationParams.EnergyTarget > 0 &&
+       m_nEnergy >= m_sTerminationParams.EnergyTarget) ||
+      (m_sTerminationParams.EnergyTarget < 0 &&
+       m_nEnergy <= m_sTerminationParams.EnergyTarget)) {
+      m_eTerminationReason = TERMINATION_ENERGY_TARGET;
+      LogTermination("energy_target");
+      return true;
+   }
+   /* Steady collection rate: compare the food collected in the last window
+      with the food collected in the window before it */
+   UInt32 unWindow = m_sTerminationParams.SteadyWindow;
+   if(unWindow > 0 && m_unHistoryTicks >= m_vecCollectedHistory.size()) {
+      UInt32 unSize = m_vecCollectedHistory.size();
+      UInt32 unNow  = m_vecCollectedHistory[(m_unHistoryTicks - 1) % unSize];
+      UInt32 unMid  = m_vecCollectedHistory[(m_unHistoryTicks - 1 - unWindow) % unSize];
+      UInt32 unOld  = m_vecCollectedHistory[(m_unHistoryTicks - 1 - 2 * unWindow) % unSize];
+      Real fRecentRate = static_cast<Real>(unNow - unMid) / unWindow;
+      Real fPreviousRate = static_cast<Real>(unMid - unOld) / unWindow;
+      if(fRecentRate > 0.0 &&
+         Abs(fRecentRate - fPreviousRate) <= m_sTerminationParams.SteadyTolerance * fRecentRate) {
+         m_eTerminationReason = TERMINATION_STEADY_STATE;
+         LogTermination("steady_state");
+         return true;
+      }
+   }
+   /* Wall-clock budget */
+   if(m_sTerminationParams.WallClockBudget > 0.0) {
+      std::chrono::duration<Real> tElapsed = std::chrono::steady_clock::now() - m_tStartTime;
+      if(tElapsed.count() >= m_sTerminationParams.WallClockBudget) {
+         m_eTerminationReason = TERMINATION_WALL_CLOCK;
+         LogTermination("wall_clock_budget");
+         return true;
+      }
+   }
+   return false;
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingLoopFunctions::LogTermination(const std::string& str_reason) {
+   std::chrono::duration<Real> tElapsed = std::chrono::steady_clock::now() - m_tStartTime;
+   m_cOutput << "# stopped\t" << str_reason
+             << "\tclock\t" << GetSpace().GetSimulationClock()
+             << "\twall_seconds\t" << tElapsed.count() << std::endl;
+   LOG << "[INFO] Experiment stopped at step " << GetSpace().GetSimulationClock()
+       << ": " << str_reason << std::endl;
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingLoopFunctions::WriteStats(const std::string& str_tag) {
+   Real fCellSide = 1.0 / m_cPheromoneField.GetResolution();
+   m_cOutput << "# " << str_tag
+             << "\tclock\t" << GetSpace().GetSimulationClock()
+             << "\tcollected_food\t" << m_unCollectedFood
+             << "\tenergy\t" << m_nEnergy
+             << "\trate\t" << m_cStats.GetRate()
+             << "\twindow_rate\t" << m_cStats.GetWindowRate()
+             << "\ttrips\t" << m_cStats.GetTrips()
+             << "\ttrip_mean\t" << m_cStats.GetTripMean()
+             << "\ttrip_p50\t" << m_cStats.GetTripQuantile(0.5)
+             << "\ttrip_p90\t" << m_cStats.GetTripQuantile(0.9)
+             << "\ttrip_p99\t" << m_cStats.GetTripQuantile(0.99)
+             << "\tresting\t" << m_cStats.GetStateSteps(CFootBotForaging::SStateData::STATE_RESTING)
+             << "\texploring\t" << m_cStats.GetStateSteps(CFootBotForaging::SStateData::STATE_EXPLORING)
+             << "\tline_following\t" << m_cStats.GetStateSteps(CFootBotForaging::SStateData::STATE_LINE_FOLLOWING)
+             << "\treturning\t" << m_cStats.GetStateSteps(CFootBotForaging::SStateData::STATE_RETURN_TO_NEST)
+             << "\tpheromone_mass\t" << m_cPheromoneField.GetTotal()
+             << "\tpheromone_area\t" << m_cPheromoneField.GetActiveCellCount() * fCellSide * fCellSide
+             << "\tenergy_slope\t" << m_cStats.GetEnergySlope()
+             << "\twindow_energy_slope\t" << m_cStats.GetWindowEnergySlope()
+             << "\n";
+   if(str_tag == "summary") {
+      m_cOutput.flush();
+      LOG << "[INFO] Trial " << m_unTrial << ": "
+          << m_cStats.GetTrips() << " trips, mean " << m_cStats.GetTripMean()
+          << " steps, p90 " << m_cStats.GetTripQuantile(0.9)
+          << " steps; " << m_cStats.GetRate() << " items/step; energy slope "
+          << m_cStats.GetEnergySlope() << std::endl;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingLoopFunctions::PublishMetrics(bool b_finished) {
+   /* Update the speed when enough time has passed for it to be stable */
+   UInt32 unTick = GetSpace().GetSimulationClock();
+   std::chrono::steady_clock::time_point tNow = std::chrono::steady_clock::now();
+   std::chrono::duration<Real> tElapsed = tNow - m_tRateStart;
+   if(tElapsed.count() >= 0.5) {
+      m_fStepsPerSecond = (unTick - m_unRateStartTick) / tElapsed.count();
+      m_tRateStart = tNow;
+      m_unRateStartTick = unTick;
+   }
+   SForagingMetrics sMetrics;
+   sMetrics.Tick = unTick;
+   sMetrics.Trial = m_unTrial;
+   sMetrics.Walking = m_unWalking;
+   sMetrics.Resting = m_unResting;
+   sMetrics.CollectedFood = m_unCollectedFood;
+   sMetrics.Energy = m_nEnergy;
+   sMetrics.PheromoneMass = m_cPheromoneField.GetTotal();
+   sMetrics.StepsPerSecond = m_fStepsPerSecond;
+   sMetrics.Finished = b_finished ? 1 : 0;
+   m_cMetrics.Publish(sMetrics);
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingLoopFunctions::LogTripEvent(UInt8 un_type,
+                                          const CFootBotForaging::SFoodData& s_food_data,
+                                          UInt32 un_robot,
+                                          const CVector2& c_pos,
+                                          UInt32 un_item) {
+   CForagingEventLog& cEventLog = CForagingEventLog::GetInstance();
+   if(!cEventLog.IsEnabled()) return;
+   SForagingEvent sEvent;
+   ::memset(&sEvent, 0, sizeof(sEvent));
+   sEvent.Tick = GetSpace().GetSimulationClock();
+   sEvent.Robot = un_robot;
+   sEvent.Type = un_type;
+   sEvent.Flags = s_food_data.FoundViaTrail ? SForagingEvent::FLAG_FOUND_VIA_TRAIL : 0;
+   sEvent.Item = un_item;
+   sEvent.TripStart = s_food_data.TripStart;
+   sEvent.Pickup = s_food_data.PickupTick;
+   sEvent.LineFollowing = s_food_data.LineFollowingTicks;
+   sEvent.Distance = s_food_data.TripDistance;
+   sEvent.X = c_pos.GetX();
+   sEvent.Y = c_pos.GetY();
+   cEventLog.Emit(sEvent);
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingLoopFunctions::StepFoodData(CFootBotForaging::SFoodData& s_food_data,
+                                          UInt32 un_robot,
+                                          bool b_resting,
+                                          const CVector2& c_pos,
+                                          UInt32& un_collected_now) {
+   /* Trip metrics: a trip starts when the robot leaves the nest */
+   if(s_food_data.OnTrip) {
+      s_food_data.TripDistance += (c_pos - s_food_data.LastPosition).Length();
+   }
+   else if(c_pos.GetX() > -1.0f) {
+      s_food_data.OnTrip = true;
+      s_food_data.TripStart = GetSpace().GetSimulationClock();
+      s_food_data.PickupTick = 0;
+      s_food_data.TripDistance = 0.0;
+      s_food_data.LineFollowingTicks = 0;
+      s_food_data.FoundViaTrail = false;
+      LogTripEvent(SForagingEvent::EVENT_LEAVE_NEST, s_food_data, un_robot, c_pos, 0);
+   }
+   s_food_data.LastPosition = c_pos;
+   if(m_cInputs.IsEnabled()) {
+      m_cInputs.Record(c_pos, b_resting, s_food_data.HasFoodItem, s_food_data.FoodItemIdx);
+   }
+   /* Pick or drop food, and lay the trail */
+   size_t unFoodItemIdx = s_food_data.FoodItemIdx;
+   bool bHadFoodItem = s_food_data.HasFoodItem;
+   CForagingCore::EOutcome eOutcome = StepRobot(c_pos, s_food_data.HasFoodItem, s_food_data.FoodItemIdx);
+   if(eOutcome == OUTCOME_DROP) {
+      /* The trip is over */
+      LogTripEvent(SForagingEvent::EVENT_DROP, s_food_data, un_robot, c_pos, unFoodItemIdx);
+      if(m_bStats) {
+         m_cStats.AddTrip(GetSpace().GetSimulationClock() - s_food_data.TripStart);
+      }
+      s_food_data.OnTrip = false;
+      ++un_collected_now;
+      ++s_food_data.TotalFoodItems;
+      /* The floor texture must be updated */
+      m_pcFloor->SetChanged();
+   }
+   else if(eOutcome == OUTCOME_PICKUP) {
+      s_food_data.PickupTick = GetSpace().GetSimulationClock();
+      s_food_data.FoundViaTrail = s_food_data.LineFollowingTicks > 0;
+      LogTripEvent(SForagingEvent::EVENT_PICKUP, s_food_data, un_robot, c_pos, s_food_data.FoodItemIdx);
+      if(m_cHeatmap.IsEnabled()) {
+         m_cHeatmap.AddPickup(c_pos);
+      }
+      /* The floor texture must be updated */
+      m_pcFloor->SetChanged();
+   }
+   else if(!bHadFoodItem && !(c_pos.GetX() > -1.0f) && s_food_data.OnTrip) {
+      /* Back in the nest empty-handed */
+      LogTripEvent(SForagingEvent::EVENT_RETURN_EMPTY, s_food_data, un_robot, c_pos, 0);
+      s_food_data.OnTrip = false;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingLoopFunctions::SaveCheckpoint(const std::string& str_file) {
+   std::ofstream cOut(str_file.c_str(), std::ios_base::binary | std::ios_base::trunc | std::ios_base::out);
+   if(!cOut) {
+      THROW_ARGOSEXCEPTION("Cannot open checkpoint file \"" << str_file << "\" for writing");
+   }
+   CheckpointWrite(cOut, FORAGING_CHECKPOINT_MAGIC);
+   CheckpointWrite(cOut, FORAGING_CHECKPOINT_VERSION);
+   CheckpointWrite<UInt32>(cOut, GetSpace().GetSimulationClock());
+   /* Counters */
+   CheckpointWrite(cOut, m_unCollectedFood);
+   CheckpointWrite(cOut, m_nEnergy);
+   /* Food items: the key of their generator, then their positions and
+      respawn counts */
+   CheckpointWrite(cOut, GetFoodKey());
+   CheckpointWrite<UInt32>(cOut, m_cFoodPos.size());
+   for(size_t i = 0; i < m_cFoodPos.size(); ++i) {
+      CheckpointWrite(cOut, m_cFoodPos[i].GetX());
+      CheckpointWrite(cOut, m_cFoodPos[i].GetY());
+      CheckpointWrite(cOut, m_vecFoodRespawns[i]);
+   }
+   /* Pheromone field, without the cells that ran out since the last sweep */
+   m_cPheromoneField.Settle();
+   CheckpointWrite<UInt32>(cOut, m_cPheromoneField.GetActiveCellCount());
+   for(size_t i = 0; i < m_cPheromoneField.GetActiveCellCount(); ++i) {
+      SInt32 nX, nY;
+      Real fValue;
+      m_cPheromoneField.GetActiveCell(i, nX, nY, fValue);
+      CheckpointWrite(cOut, nX);
+      CheckpointWrite(cOut, nY);
+      CheckpointWrite(cOut, fValue);
+   }
+   /* Foot-bots: pose and controller state */
+   CSpace::TMapPerType& m_cFootbots = GetSpace().GetEntitiesByType("foot-bot");
+   CheckpointWrite<UInt32>(cOut, m_cFootbots.size());
+   for(CSpace::TMapPerType::iterator it = m_cFootbots.begin();
+       it != m_cFootbots.end();
+       ++it) {
+      CFootBotEntity& cFootBot = *any_cast<CFootBotEntity*>(it->second);
+      CFootBotForaging* pcController = dynamic_cast<CFootBotForaging*>(&cFootBot.GetControllableEntity().GetController());
+      if(pcController == NULL) {
+         THROW_ARGOSEXCEPTION("Foot-bot \"" << cFootBot.GetId() << "\" runs a Buzz controller, which cannot be checkpointed");
+      }
+      const SAnchor& sAnchor = cFootBot.GetEmbodiedEntity().GetOriginAnchor();
+      CheckpointWrite(cOut, cFootBot.GetId());
+      CheckpointWrite(cOut, sAnchor.Position.GetX());
+      CheckpointWrite(cOut, sAnchor.Position.GetY());
+      CheckpointWrite(cOut, sAnchor.Position.GetZ());
+      CheckpointWrite(cOut, sAnchor.Orientation.GetW());
+      CheckpointWrite(cOut, sAnchor.Orientation.GetX());
+      CheckpointWrite(cOut, sAnchor.Orientation.GetY());
+      CheckpointWrite(cOut, sAnchor.Orientation.GetZ());
+      pcController->SaveState(cOut);
+   }
+   if(!cOut) {
+      THROW_ARGOSEXCEPTION("Error writing checkpoint file \"" << str_file << "\"");
+   }
+   LOG << "[INFO] Checkpoint saved to \"" << str_file << "\" at step "
+       << GetSpace().GetSimulationClock() << std::endl;
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingLoopFunctions::RestoreCheckpoint(const std::string& str_file) {
+   std::ifstream cIn(str_file.c_str(), std::ios_base::binary | std::ios_base::in);
+   if(!cIn) {
+      THROW_ARGOSEXCEPTION("Cannot open checkpoint file \"" << str_file << "\"");
+   }
+   try {
+      UInt32 unMagic, unVersion, unClock;
+      CheckpointRead(cIn, unMagic);
+      CheckpointRead(cIn, unVersion);
+      if(unMagic != FORAGING_CHECKPOINT_MAGIC || unVersion != FORAGING_CHECKPOINT_VERSION) {
+         THROW_ARGOSEXCEPTION("Not a foraging checkpoint, or unsupported version");
+      }
+      CheckpointRead(cIn, unClock);
+      /* Counters */
+      CheckpointRead(cIn, m_unCollectedFood);
+      CheckpointRead(cIn, m_nEnergy);
+      /* Food items */
+      UInt32 unFoodKey;
+      CheckpointRead(cIn, unFoodKey);
+      m_cFoodRNG.SetKey(unFoodKey);
+      UInt32 unItems;
+      CheckpointRead(cIn, unItems);
+      if(unItems != m_cFoodPos.size()) {
+         THROW_ARGOSEXCEPTION("The checkpoint has " << unItems << " food items, the experiment " << m_cFoodPos.size());
+      }
+      for(size_t i = 0; i < m_cFoodPos.size(); ++i) {
+         Real fX, fY;
+         CheckpointRead(cIn, fX);
+         CheckpointRead(cIn, fY);
+         CheckpointRead(cIn, m_vecFoodRespawns[i]);
+         m_cFoodPos[i].Set(fX, fY);
+      }
+      /* Pheromone field */
+      m_cPheromoneField.Clear();
+      UInt32 unCells;
+      CheckpointRead(cIn, unCells);
+      for(UInt32 i = 0; i < unCells; ++i) {
+         SInt32 nX, nY;
+         Real fValue;
+         CheckpointRead(cIn, nX);
+         CheckpointRead(cIn, nY);
+         CheckpointRead(cIn, fValue);
+         m_cPheromoneField.Deposit(nX, nY, fValue);
+      }
+      /* Foot-bots, matched by id */
+      CSpace::TMapPerType& m_cFootbots = GetSpace().GetEntitiesByType("foot-bot");
+      UInt32 unRobots;
+      CheckpointRead(cIn, unRobots);
+      if(unRobots != m_cFootbots.size()) {
+         THROW_ARGOSEXCEPTION("The checkpoint has " << unRobots << " foot-bots, the experiment " << m_cFootbots.size());
+      }
+      for(UInt32 i = 0; i < unRobots; ++i) {
+         std::string strId;
+         Real fPX, fPY, fPZ, fQW, fQX, fQY, fQZ;
+         CheckpointRead(cIn, strId);
+         CheckpointRead(cIn, fPX);
+         CheckpointRead(cIn, fPY);
+         CheckpointRead(cIn, fPZ);
+         CheckpointRead(cIn, fQW);
+         CheckpointRead(cIn, fQX);
+         CheckpointRead(cIn, fQY);
+         CheckpointRead(cIn, fQZ);
+         CSpace::TMapPerType::iterator it = m_cFootbots.find(strId);
+         if(it == m_cFootbots.end()) {
+            THROW_ARGOSEXCEPTION("Foot-bot \"" << strId << "\" is not in the experiment");
+         }
+         CFootBotEntity& cFootBot = *any_cast<CFootBotEntity*>(it->second);
+         /* The saved configuration was collision-free, but robots may be
+            temporarily overlapping while we move them one by one */
+         cFootBot.GetEmbodiedEntity().MoveTo(CVector3(fPX, fPY, fPZ),
+                                             CQuaternion(fQW, fQX, fQY, fQZ),
+                                             false,
+                                             true);
+         CFootBotForaging* pcController = dynamic_cast<CFootBotForaging*>(&cFootBot.GetControllableEntity().GetController());
+         if(pcController == NULL) {
+            THROW_ARGOSEXCEPTION("Foot-bot \"" << strId << "\" runs a Buzz controller, which cannot be checkpointed");
+         }
+         pcController->LoadState(cIn);
+      }
+      /* The clock goes on from the saved step, so that the steps saved
+         by the robots, such as the start of their trips, stay in the past */
+      GetSpace().SetSimulationClock(unClock);
+      m_pcFloor->SetChanged();
+      m_cOutput << "# restored\t" << str_file << "\tsaved_at\t" << unClock << std::endl;
+      LOG << "[INFO] Checkpoint restored from \"" << str_file << "\", saved at step " << unClock << std::endl;
+   }
+   catch(CARGoSException& ex) {
+      THROW_ARGOSEXCEPTION_NESTED("Error restoring checkpoint \"" << str_file << "\"", ex);
+   }
 }
 
 /****************************************/
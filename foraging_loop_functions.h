@@ -3,13 +3,27 @@
 
 #include <argos3/core/simulator/loop_functions.h>
 #include <argos3/core/simulator/entity/floor_entity.h>
-#include <argos3/core/utility/math/range.h>
-#include <argos3/core/utility/math/rng.h>
-#include <map>
+#include "foraging_core.h"
+#include "foraging_inputs.h"
+#include "nest_bulletin.h"
+#include "foraging_stats.h"
+#include "foraging_metrics.h"
+#include "trajectory_recorder.h"
+#include "visitation_heatmap.h"
+#include "homing_field.h"
+#include "pheromone_frames_exporter.h"
+#include "footbot_foraging.h"
+#include <chrono>
+#include <fstream>
+
+namespace argos {
+   class CFootBotEntity;
+}
 
 using namespace argos;
 
-class CForagingLoopFunctions : public CLoopFunctions {
+class CForagingLoopFunctions : public CLoopFunctions,
+                               public CForagingCore {
 
 public:
 
@@ -22,33 +36,167 @@ public:
    virtual CColor GetFloorColor(const CVector2& c_position_on_plane);
    virtual void PreStep();
    virtual void PostStep();
+   virtual bool IsExperimentFinished();
+
+   /*
+    * Writes the experiment state to a binary checkpoint: pheromone field,
+    * food positions, counters, random number generator seeds, and the pose
+    * and controller state of every foot-bot.
+    */
+   void SaveCheckpoint(const std::string& str_file);
+
+   /*
+    * Restores a checkpoint written by SaveCheckpoint().
+    */
+   void RestoreCheckpoint(const std::string& str_file);
+
+   /*
+    * The foot-bots that carried an item at the end of the last PreStep(),
+    * for the viewer to draw the items in one pass.
+    */
+   inline const std::vector<CFootBotEntity*>& GetCarryingRobots() const {
+      return m_vecCarrying;
+   }
+
+   /*
+    * The flow field to the nest, computed at Init() if the <homing> node
+    * is present, for the homing sensor.
+    */
+   inline const CHomingField& GetHomingField() const {
+      return m_cHomingField;
+   }
 
 private:
 
-    Real m_fFoodSquareRadius;
-    CRange<Real> m_cForagingArenaSideX, m_cForagingArenaSideY;
-    std::vector<CVector2> m_cFoodPos;
+   /*
+    * Optional stop criteria, parsed from the <termination> node.
+    * A criterion set to zero is disabled.
+    */
+   struct STerminationParams {
+      /* Ticks over which the collection rate is measured */
+      UInt32 SteadyWindow;
+      /* Maximum relative change of the collection rate between two
+         consecutive windows to consider it steady */
+      Real SteadyTolerance;
+      /* Stop when this many food items have been collected */
+      UInt32 FoodTarget;
+      /* Stop when the energy reaches this value, from above if negative */
+      SInt64 EnergyTarget;
+      /* Stop after this many seconds of wall-clock time */
+      Real WallClockBudget;
+
+      STerminationParams();
+      void Init(TConfigurationNode& t_node);
+   };
+
+   /* Why the experiment stopped */
+   enum ETerminationReason {
+      TERMINATION_NONE = 0,
+      TERMINATION_STEADY_STATE,
+      TERMINATION_FOOD_TARGET,
+      TERMINATION_ENERGY_TARGET,
+      TERMINATION_WALL_CLOCK
+   };
+
+   /* Writes the termination reason into the output file */
+   void LogTermination(const std::string& str_reason);
+
+   /* Writes the streaming statistics into the output file */
+   void WriteStats(const std::string& str_tag);
+
+   /* Publishes the live metrics */
+   void PublishMetrics(bool b_finished);
+
+   /* Adds a trip event of the given foot-bot to the event log */
+   void LogTripEvent(UInt8 un_type,
+                     const CFootBotForaging::SFoodData& s_food_data,
+                     UInt32 un_robot,
+                     const CVector2& c_pos,
+                     UInt32 un_item);
+
+   /* Tracks the trip of a foot-bot at the given position, picks or drops
+      its food and logs it; the same for every controller */
+   void StepFoodData(CFootBotForaging::SFoodData& s_food_data,
+                     UInt32 un_robot,
+                     bool b_resting,
+                     const CVector2& c_pos,
+                     UInt32& un_collected_now);
+
     CFloorEntity* m_pcFloor;
+    /* Draws the key of the food layout; the simulator reseeds it at every
+       reset, so every trial gets the layout of the seed */
     CRandom::CRNG* m_pcRNG;
 
     std::string m_strOutput;
     std::ofstream m_cOutput;
+    /* Write buffer of the output file, kept across trials */
+    std::vector<char> m_vecOutputBuffer;
+    /* Trial number, incremented at each Reset() */
+    UInt32 m_unTrial;
+
+   /* Pyramid level the floor is drawn from, matching its texel size */
+   UInt32 m_unFloorLevel;
 
-    UInt32 m_unCollectedFood;
-    SInt64 m_nEnergy;
-    UInt32 m_unEnergyPerFoodItem;
-    UInt32 m_unEnergyPerWalkingRobot;
-
-//    int **PheromoneTrail;
-    std::map<std::pair<int,int>, int> PheromoneMap;
-    int unHeight;
-    int unWidth;
-    int unResolution;
-    int unIntensity;
-    int unDissipation;
-    int unRadius;
+   /* Nest bulletin board for the controllers that use it */
+   CNestBulletin m_cBulletin;
+   /* The resting robots reading the board in this step, and where */
+   std::vector<std::pair<CFootBotForaging*, CVector2> > m_vecBulletinReaders;
+   /* The robots carrying an item in this step */
+   std::vector<CFootBotEntity*> m_vecCarrying;
     int unStrong;
 
+   /* Checkpoint to write, and the step at which to write it */
+   std::string m_strCheckpointSave;
+   UInt32 m_unCheckpointSaveAt;
+   /* Checkpoint to restore at Init() and Reset() */
+   std::string m_strCheckpointRestore;
+
+   STerminationParams m_sTerminationParams;
+   ETerminationReason m_eTerminationReason;
+   /* Collected food at each of the last 2*SteadyWindow+1 ticks */
+   std::vector<UInt32> m_vecCollectedHistory;
+   /* Number of ticks recorded in the history */
+   UInt32 m_unHistoryTicks;
+   /* Wall-clock time at which the experiment started */
+   std::chrono::steady_clock::time_point m_tStartTime;
+
+   /* Streaming statistics, enabled by the <stats> node */
+   bool m_bStats;
+   CForagingStats m_cStats;
+   /* Steps between two reports; zero for the summary only */
+   UInt32 m_unStatsInterval;
+   /* Write the per-step rows of the output file? */
+   bool m_bPerStepOutput;
+
+   /* Live metrics in shared memory, enabled by the <metrics> node */
+   CForagingMetricsPublisher m_cMetrics;
+   /* Robot counts of the last step */
+   UInt32 m_unWalking;
+   UInt32 m_unResting;
+   /* Simulation speed, measured over half a second at least */
+   std::chrono::steady_clock::time_point m_tRateStart;
+   UInt32 m_unRateStartTick;
+   Real m_fStepsPerSecond;
+
+   /* Trajectories of the foot-bots, enabled by the <trajectory> node */
+   CTrajectoryRecorder m_cTrajectory;
+
+   /* Where the robots spend their time, enabled by the <heatmap> node */
+   CVisitationHeatmap m_cHeatmap;
+
+   /* The way back to the nest around the boxes, enabled by the <homing>
+      node */
+   CHomingField m_cHomingField;
+
+   /* Pheromone field snapshots, enabled by the <pheromone_frames> node,
+      and the steps between two of them */
+   CPheromoneFramesExporter m_cPheromoneFrames;
+   UInt32 m_unPheromoneFramesInterval;
+
+   /* Inputs of the foraging logic, for replay, enabled by the <inputs>
+      node */
+   CForagingInputRecorder m_cInputs;
+
 };
 
 #endif
@@ -0,0 +1,68 @@
+#include "foraging_metrics.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/****************************************/
+/****************************************/
+
+CForagingMetricsPublisher::CForagingMetricsPublisher() :
+   m_psSegment(NULL) {}
+
+/****************************************/
+/****************************************/
+
+CForagingMetricsPublisher::~CForagingMetricsPublisher() {
+   Close();
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingMetricsPublisher::Open(const std::string& str_name) {
+   Close();
+   if(str_name.empty() || str_name[0] != '/') {
+      THROW_ARGOSEXCEPTION("The shared memory name \"" << str_name << "\" must start with '/'");
+   }
+   /* Start from a fresh segment, so that monitors of a crashed run notice */
+   ::shm_unlink(str_name.c_str());
+   int nFD = ::shm_open(str_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+   if(nFD < 0) {
+      THROW_ARGOSEXCEPTION("Cannot create shared memory \"" << str_name << "\": " << ::strerror(errno));
+   }
+   if(::ftruncate(nFD, sizeof(SForagingMetricsSegment)) != 0) {
+      int nError = errno;
+      ::close(nFD);
+      ::shm_unlink(str_name.c_str());
+      THROW_ARGOSEXCEPTION("Cannot size shared memory \"" << str_name << "\": " << ::strerror(nError));
+   }
+   void* pvMemory = ::mmap(NULL, sizeof(SForagingMetricsSegment),
+                           PROT_READ | PROT_WRITE, MAP_SHARED, nFD, 0);
+   ::close(nFD);
+   if(pvMemory == MAP_FAILED) {
+      ::shm_unlink(str_name.c_str());
+      THROW_ARGOSEXCEPTION("Cannot map shared memory \"" << str_name << "\": " << ::strerror(errno));
+   }
+   /* The memory is zeroed: an even sequence and empty fields. The magic
+      is written last, so a monitor never sees a half-built segment. */
+   m_psSegment = new(pvMemory) SForagingMetricsSegment;
+   m_psSegment->Sequence.store(0, std::memory_order_relaxed);
+   m_psSegment->Version.store(SForagingMetricsSegment::VERSION, std::memory_order_relaxed);
+   m_psSegment->Magic.store(SForagingMetricsSegment::MAGIC, std::memory_order_release);
+   m_strName = str_name;
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingMetricsPublisher::Close() {
+   if(m_psSegment == NULL) return;
+   ::munmap(m_psSegment, sizeof(SForagingMetricsSegment));
+   ::shm_unlink(m_strName.c_str());
+   m_psSegment = NULL;
+   m_strName.clear();
+}
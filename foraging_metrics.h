@@ -0,0 +1,137 @@
+/*
+ * Live metrics of a running experiment, published in POSIX shared memory.
+ *
+ * The loop functions write the current counters into a small segment at
+ * the end of every step; any number of monitor processes (see
+ * foraging_monitor.cpp) read it at their own pace. The segment is guarded
+ * by a sequence lock: the writer makes the sequence odd, writes the
+ * fields and makes it even again, and a reader retries when it saw an odd
+ * sequence or the sequence changed during its copy. The writer never
+ * waits, and a publication costs a few stores.
+ *
+ * All the fields are 64-bit atomics, so a torn read is detected, never
+ * undefined. Reals are stored as their bit patterns.
+ */
+
+#ifndef FORAGING_METRICS_H
+#define FORAGING_METRICS_H
+
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <atomic>
+#include <cstring>
+#include <string>
+
+using namespace argos;
+
+/*
+ * A snapshot of the metrics.
+ */
+struct SForagingMetrics {
+   UInt64 Tick;           // simulation step
+   UInt64 Trial;          // trial number
+   UInt64 Walking;        // robots out of the resting state
+   UInt64 Resting;        // robots resting
+   UInt64 CollectedFood;  // food collected in the trial
+   SInt64 Energy;         // energy of the swarm
+   Real PheromoneMass;    // total pheromone in the field
+   Real StepsPerSecond;   // wall-clock simulation speed
+   UInt64 Finished;       // non-zero once the experiment is over
+};
+
+static_assert(sizeof(SForagingMetrics) % sizeof(UInt64) == 0,
+              "SForagingMetrics must be made of 64-bit words");
+
+/*
+ * The shared memory segment.
+ */
+struct SForagingMetricsSegment {
+
+   static const UInt64 MAGIC   = 0x5352544d47524f46ULL; // "FORGMTRS"
+   static const UInt64 VERSION = 1;
+   static const UInt32 NUM_FIELDS = sizeof(SForagingMetrics) / sizeof(UInt64);
+
+   std::atomic<UInt64> Magic;
+   std::atomic<UInt64> Version;
+   std::atomic<UInt64> Sequence;
+   std::atomic<UInt64> Fields[NUM_FIELDS];
+
+   /*
+    * Publishes a snapshot. Only one process may write.
+    */
+   inline void Write(const SForagingMetrics& s_metrics) {
+      UInt64 punWords[NUM_FIELDS];
+      ::memcpy(punWords, &s_metrics, sizeof(punWords));
+      UInt64 unSeq = Sequence.load(std::memory_order_relaxed);
+      Sequence.store(unSeq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      for(UInt32 i = 0; i < NUM_FIELDS; ++i) {
+         Fields[i].store(punWords[i], std::memory_order_relaxed);
+      }
+      Sequence.store(unSeq + 2, std::memory_order_release);
+   }
+
+   /*
+    * Copies a consistent snapshot. Returns false if the writer was busy
+    * for un_attempts tries in a row.
+    */
+   inline bool Read(SForagingMetrics& s_metrics, UInt32 un_attempts = 1000) const {
+      UInt64 punWords[NUM_FIELDS];
+      for(UInt32 unTry = 0; unTry < un_attempts; ++unTry) {
+         UInt64 unBefore = Sequence.load(std::memory_order_acquire);
+         if(unBefore & 1) continue;
+         for(UInt32 i = 0; i < NUM_FIELDS; ++i) {
+            punWords[i] = Fields[i].load(std::memory_order_relaxed);
+         }
+         std::atomic_thread_fence(std::memory_order_acquire);
+         if(Sequence.load(std::memory_order_relaxed) == unBefore) {
+            ::memcpy(&s_metrics, punWords, sizeof(punWords));
+            return true;
+         }
+      }
+      return false;
+   }
+};
+
+/*
+ * The writing side, used by the loop functions.
+ */
+class CForagingMetricsPublisher {
+
+public:
+
+   CForagingMetricsPublisher();
+   ~CForagingMetricsPublisher();
+
+   /*
+    * Creates the segment with the given name (e.g. "/foraging"),
+    * replacing any segment left over by a crashed run.
+    */
+   void Open(const std::string& str_name);
+
+   /*
+    * Unmaps and removes the segment.
+    */
+   void Close();
+
+   /*
+    * Returns true if the segment is open.
+    */
+   inline bool IsEnabled() const {
+      return m_psSegment != NULL;
+   }
+
+   /*
+    * Publishes a snapshot, if the segment is open.
+    */
+   inline void Publish(const SForagingMetrics& s_metrics) {
+      if(m_psSegment != NULL) m_psSegment->Write(s_metrics);
+   }
+
+private:
+
+   std::string m_strName;
+   SForagingMetricsSegment* m_psSegment;
+
+};
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Monitor for a running foraging experiment.
+ *
+ * Attaches read-only to the shared memory segment published by the loop
+ * functions (see foraging_metrics.h) and prints the counters at a fixed
+ * rate. Reading never blocks the simulation: if a snapshot is being
+ * written, the monitor simply reads it again.
+ *
+ * Example:
+ *
+ *    foraging_monitor -n /foraging -i 0.5
+ *
+ * With -1, prints a single snapshot and exits. Otherwise, exits when the
+ * experiment is over.
+ */
+
+#include "foraging_metrics.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+/****************************************/
+/****************************************/
+
+static void PrintUsage(const char* pch_name) {
+   std::cerr << "Usage: " << pch_name << " [-n <shared memory name>] [-i <seconds>] [-1]" << std::endl;
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * Maps the segment, waiting for the simulation to create it.
+ */
+static const SForagingMetricsSegment* Attach(const std::string& str_name) {
+   bool bWarned = false;
+   while(true) {
+      int nFD = ::shm_open(str_name.c_str(), O_RDONLY, 0);
+      if(nFD >= 0) {
+         void* pvMemory = ::mmap(NULL, sizeof(SForagingMetricsSegment),
+                                 PROT_READ, MAP_SHARED, nFD, 0);
+         ::close(nFD);
+         if(pvMemory == MAP_FAILED) {
+            std::cerr << "Cannot map \"" << str_name << "\": " << ::strerror(errno) << std::endl;
+            return NULL;
+         }
+         const SForagingMetricsSegment* psSegment =
+            reinterpret_cast<const SForagingMetricsSegment*>(pvMemory);
+         /* The publisher writes the magic last */
+         for(UInt32 i = 0; i < 100 && psSegment->Magic.load(std::memory_order_acquire) == 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+         }
+         if(psSegment->Magic.load(std::memory_order_acquire) != SForagingMetricsSegment::MAGIC ||
+            psSegment->Version.load(std::memory_order_relaxed) != SForagingMetricsSegment::VERSION) {
+            std::cerr << "\"" << str_name << "\" is not a foraging metrics segment, or has an unsupported version" << std::endl;
+            ::munmap(pvMemory, sizeof(SForagingMetricsSegment));
+            return NULL;
+         }
+         return psSegment;
+      }
+      if(errno != ENOENT) {
+         std::cerr << "Cannot open \"" << str_name << "\": " << ::strerror(errno) << std::endl;
+         return NULL;
+      }
+      if(!bWarned) {
+         std::cerr << "Waiting for \"" << str_name << "\"..." << std::endl;
+         bWarned = true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+   }
+}
+
+/****************************************/
+/****************************************/
+
+int main(int argc, char** argv) {
+   std::string strName = "/foraging";
+   Real fInterval = 1.0;
+   bool bOnce = false;
+   int nOpt;
+   while((nOpt = getopt(argc, argv, "n:i:1h")) != -1) {
+      switch(nOpt) {
+         case 'n': strName = optarg; break;
+         case 'i': fInterval = std::atof(optarg); break;
+         case '1': bOnce = true; break;
+         default: PrintUsage(argv[0]); return 1;
+      }
+   }
+   if(fInterval <= 0.0) {
+      PrintUsage(argv[0]);
+      return 1;
+   }
+   const SForagingMetricsSegment* psSegment = Attach(strName);
+   if(psSegment == NULL) {
+      return 1;
+   }
+   std::cout << "# clock\ttrial\twalking\tresting\tcollected_food\tenergy\tpheromone_mass\tsteps_per_second" << std::endl;
+   SForagingMetrics sMetrics;
+   while(true) {
+      if(psSegment->Read(sMetrics)) {
+         std::cout << sMetrics.Tick << "\t"
+                   << sMetrics.Trial << "\t"
+                   << sMetrics.Walking << "\t"
+                   << sMetrics.Resting << "\t"
+                   << sMetrics.CollectedFood << "\t"
+                   << sMetrics.Energy << "\t"
+                   << sMetrics.PheromoneMass << "\t"
+                   << sMetrics.StepsPerSecond << std::endl;
+         if(bOnce || sMetrics.Finished) break;
+      }
+      std::this_thread::sleep_for(std::chrono::duration<Real>(fInterval));
+   }
+   ::munmap(const_cast<SForagingMetricsSegment*>(psSegment), sizeof(SForagingMetricsSegment));
+   return 0;
+}
@@ -1,29 +1,88 @@
 #include "foraging_qt_user_functions.h"
-#include <footbot_foraging.h>
-#include <argos3/core/simulator/entity/controllable_entity.h>
+#include "foraging_loop_functions.h"
+#include <argos3/core/simulator/simulator.h>
+#include <argos3/core/utility/configuration/argos_configuration.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
 
 using namespace argos;
 
 /****************************************/
 /****************************************/
 
-CForagingQTUserFunctions::CForagingQTUserFunctions() {
-   RegisterUserFunction<CForagingQTUserFunctions,CFootBotEntity>(&CForagingQTUserFunctions::Draw);
+/* The carried item: a blue disc over the robot */
+static const Real ITEM_RADIUS    = 0.1;
+static const Real ITEM_HEIGHT    = 0.05;
+static const Real ITEM_ELEVATION = 0.3;
+static const UInt32 ITEM_SIDES   = 12;
+
+/****************************************/
+/****************************************/
+
+CForagingQTUserFunctions::CForagingQTUserFunctions() :
+   m_eIdMode(IDS_ALL),
+   m_fIdSquareDistance(4.0),
+   m_bItems(true),
+   m_pcLoopFunctions(NULL) {}
+
+/****************************************/
+/****************************************/
+
+void CForagingQTUserFunctions::Init(TConfigurationNode& t_tree) {
+   try {
+      if(NodeExists(t_tree, "ids")) {
+         TConfigurationNode& tIds = GetNode(t_tree, "ids");
+         std::string strMode = "all";
+         GetNodeAttributeOrDefault(tIds, "mode", strMode, strMode);
+         if(strMode == "all") m_eIdMode = IDS_ALL;
+         else if(strMode == "none") m_eIdMode = IDS_NONE;
+         else if(strMode == "selected") m_eIdMode = IDS_SELECTED;
+         else if(strMode == "near") m_eIdMode = IDS_NEAR;
+         else {
+            THROW_ARGOSEXCEPTION("Unknown id mode \"" << strMode << "\", expected all, none, selected or near");
+         }
+         Real fDistance = 2.0;
+         GetNodeAttributeOrDefault(tIds, "distance", fDistance, fDistance);
+         if(fDistance <= 0.0) {
+            THROW_ARGOSEXCEPTION("The id distance must be positive");
+         }
+         m_fIdSquareDistance = fDistance * fDistance;
+         std::string strRobots;
+         GetNodeAttributeOrDefault(tIds, "robots", strRobots, strRobots);
+         std::istringstream cRobots(strRobots);
+         std::string strId;
+         while(std::getline(cRobots, strId, ',')) {
+            if(!strId.empty()) m_vecIdRobotIds.push_back(strId);
+         }
+      }
+      if(NodeExists(t_tree, "items")) {
+         GetNodeAttributeOrDefault(GetNode(t_tree, "items"), "enabled", m_bItems, m_bItems);
+      }
+   }
+   catch(CARGoSException& ex) {
+      THROW_ARGOSEXCEPTION_NESTED("Error initializing the foraging user functions", ex);
+   }
+   /* Only these modes need a call per robot */
+   if(m_eIdMode == IDS_ALL || m_eIdMode == IDS_NEAR) {
+      RegisterUserFunction<CForagingQTUserFunctions,CFootBotEntity>(&CForagingQTUserFunctions::Draw);
+   }
 }
 
 /****************************************/
 /****************************************/
 
 void CForagingQTUserFunctions::Draw(CFootBotEntity& c_entity) {
-   CFootBotForaging& cController = dynamic_cast<CFootBotForaging&>(c_entity.GetControllableEntity().GetController());
-   CFootBotForaging::SFoodData& sFoodData = cController.GetFoodData();
-   if(sFoodData.HasFoodItem) {
-      DrawCylinder(
-         CVector3(0.0f, 0.0f, 0.3f), 
-         CQuaternion(),
-         0.1f,
-         0.05f,
-         CColor::BLUE);
+   if(m_eIdMode == IDS_NEAR) {
+      const CVector3& cCamera = GetQTOpenGLWidget().GetCamera().GetActiveSettings().Position;
+      if((c_entity.GetEmbodiedEntity().GetOriginAnchor().Position - cCamera).SquareLength() > m_fIdSquareDistance) {
+         return;
+      }
    }
    /* The position of the text is expressed wrt the reference point of the footbot
        * For a foot-bot, the reference point is the center of its base.
@@ -37,4 +96,113 @@ void CForagingQTUserFunctions::Draw(CFootBotEntity& c_entity) {
 /****************************************/
 /****************************************/
 
+void CForagingQTUserFunctions::DrawInWorld() {
+   Resolve();
+   if(m_eIdMode == IDS_SELECTED) {
+      /* In world coordinates here */
+      for(size_t i = 0; i < m_vecIdRobots.size(); ++i) {
+         DrawText(m_vecIdRobots[i]->GetEmbodiedEntity().GetOriginAnchor().Position + CVector3(0.0, 0.0, 0.3),
+                  m_vecIdRobots[i]->GetId().c_str());
+      }
+      CFootBotEntity* pcSelected = dynamic_cast<CFootBotEntity*>(GetSelectedEntity());
+      if(pcSelected != NULL) {
+         DrawText(pcSelected->GetEmbodiedEntity().GetOriginAnchor().Position + CVector3(0.0, 0.0, 0.3),
+                  pcSelected->GetId().c_str());
+      }
+   }
+   if(m_bItems) {
+      DrawItems();
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingQTUserFunctions::Resolve() {
+   if(m_pcLoopFunctions != NULL) return;
+   m_pcLoopFunctions = dynamic_cast<CForagingLoopFunctions*>(&CSimulator::GetInstance().GetLoopFunctions());
+   if(m_pcLoopFunctions == NULL) {
+      THROW_ARGOSEXCEPTION("The foraging user functions need the foraging loop functions");
+   }
+   CSpace::TMapPerType& cFootBots = CSimulator::GetInstance().GetSpace().GetEntitiesByType("foot-bot");
+   for(size_t i = 0; i < m_vecIdRobotIds.size(); ++i) {
+      CSpace::TMapPerType::iterator it = cFootBots.find(m_vecIdRobotIds[i]);
+      if(it == cFootBots.end()) {
+         THROW_ARGOSEXCEPTION("Foot-bot \"" << m_vecIdRobotIds[i] << "\" of the id overlay is not in the experiment");
+      }
+      m_vecIdRobots.push_back(any_cast<CFootBotEntity*>(it->second));
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingQTUserFunctions::DrawItems() {
+   const std::vector<CFootBotEntity*>& vecCarrying = m_pcLoopFunctions->GetCarryingRobots();
+   if(vecCarrying.empty()) return;
+   /* The prism of an item around the origin: the sides and the top */
+   static std::vector<float> vecItemVertices, vecItemNormals;
+   if(vecItemVertices.empty()) {
+      for(UInt32 i = 0; i < ITEM_SIDES; ++i) {
+         Real fA0 = CRadians::TWO_PI.GetValue() * i / ITEM_SIDES;
+         Real fA1 = CRadians::TWO_PI.GetValue() * (i + 1) / ITEM_SIDES;
+         Real fAM = 0.5 * (fA0 + fA1);
+         float fX0 = ITEM_RADIUS * std::cos(fA0), fY0 = ITEM_RADIUS * std::sin(fA0);
+         float fX1 = ITEM_RADIUS * std::cos(fA1), fY1 = ITEM_RADIUS * std::sin(fA1);
+         float fZ0 = ITEM_ELEVATION - 0.5 * ITEM_HEIGHT;
+         float fZ1 = ITEM_ELEVATION + 0.5 * ITEM_HEIGHT;
+         const float pfSide[] = {
+            fX0, fY0, fZ0,  fX1, fY1, fZ0,  fX1, fY1, fZ1,
+            fX0, fY0, fZ0,  fX1, fY1, fZ1,  fX0, fY0, fZ1
+         };
+         const float pfTop[] = {
+            0.0f, 0.0f, fZ1,  fX0, fY0, fZ1,  fX1, fY1, fZ1
+         };
+         vecItemVertices.insert(vecItemVertices.end(), pfSide, pfSide + 18);
+         vecItemVertices.insert(vecItemVertices.end(), pfTop, pfTop + 9);
+         for(UInt32 v = 0; v < 6; ++v) {
+            vecItemNormals.push_back(std::cos(fAM));
+            vecItemNormals.push_back(std::sin(fAM));
+            vecItemNormals.push_back(0.0f);
+         }
+         for(UInt32 v = 0; v < 3; ++v) {
+            vecItemNormals.push_back(0.0f);
+            vecItemNormals.push_back(0.0f);
+            vecItemNormals.push_back(1.0f);
+         }
+      }
+   }
+   /* One copy per carrying robot, over its current position */
+   m_vecVertices.resize(vecCarrying.size() * vecItemVertices.size());
+   m_vecNormals.resize(vecCarrying.size() * vecItemNormals.size());
+   for(size_t r = 0; r < vecCarrying.size(); ++r) {
+      const CVector3& cPos = vecCarrying[r]->GetEmbodiedEntity().GetOriginAnchor().Position;
+      float* pfVertices = &m_vecVertices[r * vecItemVertices.size()];
+      for(size_t v = 0; v < vecItemVertices.size(); v += 3) {
+         pfVertices[v]     = vecItemVertices[v]     + cPos.GetX();
+         pfVertices[v + 1] = vecItemVertices[v + 1] + cPos.GetY();
+         pfVertices[v + 2] = vecItemVertices[v + 2] + cPos.GetZ();
+      }
+      std::copy(vecItemNormals.begin(), vecItemNormals.end(),
+                m_vecNormals.begin() + r * vecItemNormals.size());
+   }
+   /* A single draw call, with the color as material and as current color,
+      whether the lighting is on or not */
+   const GLfloat pfColor[] = { 0.0f, 0.0f, 1.0f, 1.0f };
+   glPushAttrib(GL_CURRENT_BIT | GL_LIGHTING_BIT);
+   glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+   glColor4fv(pfColor);
+   glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, pfColor);
+   glEnableClientState(GL_VERTEX_ARRAY);
+   glEnableClientState(GL_NORMAL_ARRAY);
+   glVertexPointer(3, GL_FLOAT, 0, &m_vecVertices[0]);
+   glNormalPointer(GL_FLOAT, 0, &m_vecNormals[0]);
+   glDrawArrays(GL_TRIANGLES, 0, m_vecVertices.size() / 3);
+   glPopClientAttrib();
+   glPopAttrib();
+}
+
+/****************************************/
+/****************************************/
+
 REGISTER_QTOPENGL_USER_FUNCTIONS(CForagingQTUserFunctions, "foraging_qt_user_functions")
@@ -1,21 +1,88 @@
+/*
+ * Drawing of the foraging experiment in the Qt viewer.
+ *
+ * The ids of the robots are drawn according to the optional <ids> node:
+ *
+ *    <user_functions label="foraging_qt_user_functions">
+ *      <ids mode="near" distance="2" />
+ *      <items enabled="true" />
+ *    </user_functions>
+ *
+ * mode="all" (the default) labels every robot and "none" labels none;
+ * "selected" labels the robots listed in robots="fb0,fb12" and the one
+ * selected in the viewer; "near" labels the robots within distance meters
+ * of the camera. A label is drawn through QPainter and costs far more
+ * than the robot itself, so with thousands of robots only "none",
+ * "selected" and a short "near" keep the viewer fluid.
+ *
+ * The items carried by the robots are drawn in a single draw call, from
+ * the carrying robots the loop functions list at each step. They use
+ * OpenGL 1.1 vertex arrays only, so they work with software renderers
+ * such as Mesa's llvmpipe.
+ */
+
 #ifndef FORAGING_QT_USER_FUNCTIONS_H
 #define FORAGING_QT_USER_FUNCTIONS_H
 
 #include <argos3/plugins/simulator/visualizations/qt-opengl/qtopengl_user_functions.h>
 #include <argos3/plugins/robots/foot-bot/simulator/footbot_entity.h>
+#include <string>
+#include <vector>
 
 using namespace argos;
 
+class CForagingLoopFunctions;
+
 class CForagingQTUserFunctions : public CQTOpenGLUserFunctions {
 
+public:
+
+   /* Which robots get their id drawn */
+   enum EIdMode {
+      IDS_ALL = 0,
+      IDS_NONE,
+      IDS_SELECTED,
+      IDS_NEAR
+   };
+
 public:
 
    CForagingQTUserFunctions();
 
    virtual ~CForagingQTUserFunctions() {}
 
+   virtual void Init(TConfigurationNode& t_tree);
+
+   virtual void DrawInWorld();
+
+   /*
+    * Draws the id of a robot, in the "all" and "near" modes only.
+    */
    void Draw(CFootBotEntity& c_entity);
-   
+
+private:
+
+   /* Looks up the loop functions and the listed robots */
+   void Resolve();
+
+   /* Draws the carried items of all the robots */
+   void DrawItems();
+
+private:
+
+   EIdMode m_eIdMode;
+   /* Square of the distance of the "near" mode */
+   Real m_fIdSquareDistance;
+   /* The robots of the "selected" mode, by id, then resolved */
+   std::vector<std::string> m_vecIdRobotIds;
+   std::vector<CFootBotEntity*> m_vecIdRobots;
+   /* Whether to draw the carried items */
+   bool m_bItems;
+   CForagingLoopFunctions* m_pcLoopFunctions;
+   /* The triangles of the items of a frame: x,y,z vertices and normals */
+   std::vector<float> m_vecVertices;
+   std::vector<float> m_vecNormals;
+
 };
 
 #endif
@@ -0,0 +1,238 @@
+/*
+ * Replay driver of the inputs recorded by CForagingInputRecorder (see
+ * foraging_inputs.h).
+ *
+ * Runs the foraging logic of CForagingCore on the recorded positions and
+ * states, without ARGoS physics nor controllers, and checks at every step
+ * that it produces the recorded counters. It stops at the first step that
+ * differs. The pheromone field options may differ from those of the
+ * recording, to compare them on the same workload, and -r repeats the
+ * replay for profiling; only the logic is timed.
+ *
+ * Example:
+ *
+ *    foraging_replay -f foraging_inputs.bin
+ *    foraging_replay -f foraging_inputs.bin -t 4 -y -r 10
+ *    foraging_replay -f foraging_inputs.bin -k 10 -r 10
+ */
+
+#include "foraging_inputs.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+/****************************************/
+/****************************************/
+
+static void PrintUsage(const char* pch_name) {
+   std::cerr << "Usage: " << pch_name << " -f <input recording> [-t <pheromone threads>] [-p] [-y]" << std::endl
+             << "          [-k <decay period>] [-r <repetitions>] [-q]" << std::endl;
+}
+
+/****************************************/
+/****************************************/
+
+class CForagingReplay : public CForagingCore {
+
+public:
+
+   CForagingReplay() :
+      m_unSteps(0) {}
+
+   /*
+    * Replays the file once; returns false at the first step whose counters
+    * differ from the recorded ones.
+    */
+   bool Replay(const std::string& str_file, bool b_pipelined, bool b_pyramid,
+               UInt32 un_threads, UInt32 un_decay_period, bool b_verbose);
+
+   inline UInt64 GetSteps() const {
+      return m_unSteps;
+   }
+
+   inline std::chrono::steady_clock::duration GetElapsed() const {
+      return m_cElapsed;
+   }
+
+private:
+
+   /* Compares the counters of the step; prints the differences */
+   bool Check(const CForagingInputReader& c_reader,
+              const SForagingInputCounters& s_counters) const;
+
+private:
+
+   UInt64 m_unSteps;
+   std::chrono::steady_clock::duration m_cElapsed;
+   /* Food data of the robots */
+   std::vector<bool> m_vecHasFoodItem;
+   std::vector<size_t> m_vecFoodItemIdx;
+
+};
+
+/****************************************/
+/****************************************/
+
+bool CForagingReplay::Replay(const std::string& str_file, bool b_pipelined, bool b_pyramid,
+                             UInt32 un_threads, UInt32 un_decay_period, bool b_verbose) {
+   CForagingInputReader cReader;
+   cReader.Open(str_file);
+   /* Sweep the field as in the recording, unless told otherwise */
+   if(un_decay_period == 0) {
+      un_decay_period = cReader.GetSetup().DecayPeriod;
+   }
+   Setup(cReader.GetSetup(), b_pipelined, b_pyramid, un_threads, un_decay_period);
+   m_unSteps = 0;
+   m_cElapsed = std::chrono::steady_clock::duration(0);
+   bool bTrialStart = false;
+   UInt8 unTag;
+   while((unTag = cReader.Next()) != 0) {
+      if(unTag == FORAGING_INPUTS_TRIAL) {
+         if(b_verbose && m_unSteps > 0) {
+            std::cout << "# collected_food\t" << m_unCollectedFood
+                      << "\tenergy\t" << m_nEnergy << std::endl;
+         }
+         StartTrial(cReader.GetFoodKey(), cReader.GetStartCollectedFood(),
+                    cReader.GetStartEnergy(), cReader.GetFoodPositions(),
+                    cReader.GetFoodRespawns(), cReader.GetPheromoneCells());
+         bTrialStart = true;
+         if(b_verbose) {
+            std::cout << "# trial\t" << cReader.GetTrial()
+                      << "\tstep\t" << cReader.GetTick() << std::endl;
+         }
+         continue;
+      }
+      const std::vector<SForagingInputRobot>& vecRobots = cReader.GetRobots();
+      /* The food data comes from the recording at the start of a trial,
+         and must then match it */
+      if(bTrialStart || m_vecHasFoodItem.size() != vecRobots.size()) {
+         m_vecHasFoodItem.resize(vecRobots.size());
+         m_vecFoodItemIdx.resize(vecRobots.size());
+         for(size_t i = 0; i < vecRobots.size(); ++i) {
+            m_vecHasFoodItem[i] = (vecRobots[i].Flags & SForagingInputRobot::FLAG_HAS_FOOD) != 0;
+            m_vecFoodItemIdx[i] = vecRobots[i].FoodItemIdx;
+         }
+         bTrialStart = false;
+      }
+      for(size_t i = 0; i < vecRobots.size(); ++i) {
+         bool bHasFoodItem = (vecRobots[i].Flags & SForagingInputRobot::FLAG_HAS_FOOD) != 0;
+         if(bHasFoodItem != m_vecHasFoodItem[i] ||
+            (bHasFoodItem && vecRobots[i].FoodItemIdx != m_vecFoodItemIdx[i])) {
+            std::cerr << "Step " << cReader.GetTick() << ": robot " << i
+                      << " carries " << (bHasFoodItem ? static_cast<SInt64>(vecRobots[i].FoodItemIdx) : -1)
+                      << " in the recording, "
+                      << (m_vecHasFoodItem[i] ? static_cast<SInt64>(m_vecFoodItemIdx[i]) : -1)
+                      << " in the replay" << std::endl;
+            return false;
+         }
+      }
+      /* What PreStep() does, without the logging */
+      std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+      UInt32 unWalking = 0;
+      for(size_t i = 0; i < vecRobots.size(); ++i) {
+         if(!(vecRobots[i].Flags & SForagingInputRobot::FLAG_RESTING)) ++unWalking;
+         bool bHasFoodItem = m_vecHasFoodItem[i];
+         StepRobot(CVector2(vecRobots[i].X, vecRobots[i].Y), bHasFoodItem, m_vecFoodItemIdx[i]);
+         m_vecHasFoodItem[i] = bHasFoodItem;
+      }
+      EndRobots(unWalking);
+      SForagingInputCounters sCounters;
+      sCounters.Walking = unWalking;
+      sCounters.Resting = vecRobots.size() - unWalking;
+      sCounters.CollectedFood = m_unCollectedFood;
+      sCounters.ActiveCells = m_cPheromoneField.GetActiveCellCount();
+      sCounters.Energy = m_nEnergy;
+      sCounters.PheromoneTotal = m_cPheromoneField.GetTotal();
+      /* What PostStep() does */
+      m_cPheromoneField.EndDecay();
+      m_cElapsed += std::chrono::steady_clock::now() - tStart;
+      ++m_unSteps;
+      if(!Check(cReader, sCounters)) {
+         return false;
+      }
+   }
+   if(b_verbose && m_unSteps > 0) {
+      std::cout << "# collected_food\t" << m_unCollectedFood
+                << "\tenergy\t" << m_nEnergy << std::endl;
+   }
+   return true;
+}
+
+/****************************************/
+/****************************************/
+
+bool CForagingReplay::Check(const CForagingInputReader& c_reader,
+                            const SForagingInputCounters& s_counters) const {
+   const SForagingInputCounters& sRecorded = c_reader.GetCounters();
+   /* The total is summed in a different order with several threads */
+   Real fTolerance = 1e-9 * std::max<Real>(1.0, std::abs(sRecorded.PheromoneTotal));
+   if(s_counters.Walking == sRecorded.Walking &&
+      s_counters.Resting == sRecorded.Resting &&
+      s_counters.CollectedFood == sRecorded.CollectedFood &&
+      s_counters.ActiveCells == sRecorded.ActiveCells &&
+      s_counters.Energy == sRecorded.Energy &&
+      std::abs(s_counters.PheromoneTotal - sRecorded.PheromoneTotal) <= fTolerance) {
+      return true;
+   }
+   std::cerr << "Step " << c_reader.GetTick() << " differs (recorded / replayed):" << std::endl
+             << "   walking        " << sRecorded.Walking << " / " << s_counters.Walking << std::endl
+             << "   resting        " << sRecorded.Resting << " / " << s_counters.Resting << std::endl
+             << "   collected_food " << sRecorded.CollectedFood << " / " << s_counters.CollectedFood << std::endl
+             << "   energy         " << sRecorded.Energy << " / " << s_counters.Energy << std::endl
+             << "   pheromone_mass " << sRecorded.PheromoneTotal << " / " << s_counters.PheromoneTotal << std::endl
+             << "   active_cells   " << sRecorded.ActiveCells << " / " << s_counters.ActiveCells << std::endl;
+   return false;
+}
+
+/****************************************/
+/****************************************/
+
+int main(int argc, char** argv) {
+   std::string strFile;
+   UInt32 unThreads = 1;
+   bool bPipelined = false;
+   bool bPyramid = false;
+   UInt32 unDecayPeriod = 0;
+   UInt32 unRepetitions = 1;
+   bool bVerbose = true;
+   int nOpt;
+   while((nOpt = getopt(argc, argv, "f:t:pyk:r:qh")) != -1) {
+      switch(nOpt) {
+         case 'f': strFile = optarg; break;
+         case 't': unThreads = std::strtoul(optarg, NULL, 10); break;
+         case 'p': bPipelined = true; break;
+         case 'y': bPyramid = true; break;
+         case 'k': unDecayPeriod = std::strtoul(optarg, NULL, 10); break;
+         case 'r': unRepetitions = std::strtoul(optarg, NULL, 10); break;
+         case 'q': bVerbose = false; break;
+         default: PrintUsage(argv[0]); return 1;
+      }
+   }
+   if(strFile.empty() || unRepetitions == 0) {
+      PrintUsage(argv[0]);
+      return 1;
+   }
+   try {
+      UInt64 unSteps = 0;
+      std::chrono::steady_clock::duration cElapsed(0);
+      for(UInt32 i = 0; i < unRepetitions; ++i) {
+         CForagingReplay cReplay;
+         if(!cReplay.Replay(strFile, bPipelined, bPyramid, unThreads, unDecayPeriod, bVerbose && i == 0)) {
+            return 1;
+         }
+         unSteps += cReplay.GetSteps();
+         cElapsed += cReplay.GetElapsed();
+      }
+      std::chrono::duration<Real, std::micro> tElapsed = cElapsed;
+      std::cout << "replayed\t" << unSteps << "\tsteps\t"
+                << (unSteps > 0 ? tElapsed.count() / unSteps : 0.0) << "\tus_per_step\tOK" << std::endl;
+   }
+   catch(CARGoSException& ex) {
+      std::cerr << ex.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,145 @@
+#include "foraging_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/****************************************/
+/****************************************/
+
+CForagingStats::CForagingStats() :
+   m_unWindow(1),
+   m_vecRing(2),
+   m_vecTripBuckets(NUM_BUCKETS, 0) {
+   Reset();
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingStats::Init(UInt32 un_window) {
+   m_unWindow = std::max<UInt32>(1, un_window);
+   m_vecRing.resize(m_unWindow + 1);
+   Reset();
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingStats::Reset() {
+   m_unSteps = 0;
+   m_unCollected = 0;
+   m_unTrips = 0;
+   m_fTripMean = 0.0;
+   m_unTripMin = std::numeric_limits<UInt32>::max();
+   m_unTripMax = 0;
+   std::fill(m_vecTripBuckets.begin(), m_vecTripBuckets.end(), 0);
+   std::fill(m_punStateSteps, m_punStateSteps + NUM_STATES, 0);
+   m_fMeanTick = 0.0;
+   m_fMeanEnergy = 0.0;
+   m_fTickTick = 0.0;
+   m_fTickEnergy = 0.0;
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingStats::AddStep(UInt32 un_tick,
+                             UInt32 un_collected,
+                             SInt64 n_energy,
+                             const UInt32* pun_state_counts) {
+   /* Sliding window */
+   m_unCollected += un_collected;
+   SStep& sStep = m_vecRing[m_unSteps % m_vecRing.size()];
+   sStep.Collected = m_unCollected;
+   sStep.Energy = n_energy;
+   ++m_unSteps;
+   /* Time per state */
+   for(UInt32 i = 0; i < NUM_STATES; ++i) {
+      m_punStateSteps[i] += pun_state_counts[i];
+   }
+   /* Energy regression */
+   Real fTick = un_tick;
+   Real fEnergy = n_energy;
+   Real fDeltaTick = fTick - m_fMeanTick;
+   m_fMeanTick += fDeltaTick / m_unSteps;
+   m_fMeanEnergy += (fEnergy - m_fMeanEnergy) / m_unSteps;
+   m_fTickTick += fDeltaTick * (fTick - m_fMeanTick);
+   m_fTickEnergy += fDeltaTick * (fEnergy - m_fMeanEnergy);
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingStats::AddTrip(UInt32 un_duration) {
+   ++m_unTrips;
+   m_fTripMean += (un_duration - m_fTripMean) / m_unTrips;
+   m_unTripMin = std::min(m_unTripMin, un_duration);
+   m_unTripMax = std::max(m_unTripMax, un_duration);
+   UInt32 unBucket = static_cast<UInt32>(BUCKETS_PER_OCTAVE * std::log2(un_duration + 1.0));
+   ++m_vecTripBuckets[std::min(unBucket, NUM_BUCKETS - 1)];
+}
+
+/****************************************/
+/****************************************/
+
+Real CForagingStats::GetRate() const {
+   if(m_unSteps == 0) return 0.0;
+   return static_cast<Real>(m_unCollected) / m_unSteps;
+}
+
+/****************************************/
+/****************************************/
+
+Real CForagingStats::GetWindowRate() const {
+   UInt64 unSpan = std::min<UInt64>(m_unSteps > 0 ? m_unSteps - 1 : 0, m_unWindow);
+   if(unSpan == 0) return GetRate();
+   const SStep& sNewest = m_vecRing[(m_unSteps - 1) % m_vecRing.size()];
+   const SStep& sOldest = m_vecRing[(m_unSteps - 1 - unSpan) % m_vecRing.size()];
+   return static_cast<Real>(sNewest.Collected - sOldest.Collected) / unSpan;
+}
+
+/****************************************/
+/****************************************/
+
+Real CForagingStats::GetTripMean() const {
+   return m_fTripMean;
+}
+
+/****************************************/
+/****************************************/
+
+Real CForagingStats::GetTripQuantile(Real f_quantile) const {
+   if(m_unTrips == 0) return 0.0;
+   /* The rank of the quantile, from 1 to the number of trips */
+   UInt64 unRank = static_cast<UInt64>(std::ceil(f_quantile * m_unTrips));
+   unRank = std::max<UInt64>(1, std::min<UInt64>(unRank, m_unTrips));
+   UInt64 unSeen = 0;
+   for(UInt32 i = 0; i < NUM_BUCKETS; ++i) {
+      unSeen += m_vecTripBuckets[i];
+      if(unSeen >= unRank) {
+         /* The geometric middle of the bucket, within the observed range */
+         Real fValue = std::exp2((i + 0.5) / BUCKETS_PER_OCTAVE) - 1.0;
+         return std::max<Real>(m_unTripMin, std::min<Real>(m_unTripMax, fValue));
+      }
+   }
+   return m_unTripMax;
+}
+
+/****************************************/
+/****************************************/
+
+Real CForagingStats::GetEnergySlope() const {
+   if(m_fTickTick <= 0.0) return 0.0;
+   return m_fTickEnergy / m_fTickTick;
+}
+
+/****************************************/
+/****************************************/
+
+Real CForagingStats::GetWindowEnergySlope() const {
+   UInt64 unSpan = std::min<UInt64>(m_unSteps > 0 ? m_unSteps - 1 : 0, m_unWindow);
+   if(unSpan == 0) return 0.0;
+   const SStep& sNewest = m_vecRing[(m_unSteps - 1) % m_vecRing.size()];
+   const SStep& sOldest = m_vecRing[(m_unSteps - 1 - unSpan) % m_vecRing.size()];
+   return static_cast<Real>(sNewest.Energy - sOldest.Energy) / unSpan;
+}
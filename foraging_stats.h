@@ -0,0 +1,142 @@
+/*
+ * Streaming statistics of a foraging trial.
+ *
+ * The loop functions feed the aggregates as the trial runs, so that the
+ * usual measures are available without writing and parsing the per-step
+ * output. Every update costs O(1):
+ *
+ *  - the collection rate and the energy change over a sliding window
+ *    come from a ring of the last window+1 steps;
+ *  - the energy slope over the whole trial is a least-squares fit kept
+ *    with running means (Welford), which stays accurate on long runs;
+ *  - trip times go into a histogram with logarithmic buckets, eight per
+ *    octave, so that a percentile is exact to within 9%;
+ *  - the time per state is the sum of the per-step state counts.
+ *
+ * Percentiles cost a scan of the histogram, so they are only computed
+ * when a report is written.
+ */
+
+#ifndef FORAGING_STATS_H
+#define FORAGING_STATS_H
+
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <vector>
+
+using namespace argos;
+
+class CForagingStats {
+
+public:
+
+   /* The number of controller states, see CFootBotForaging::SStateData */
+   static const UInt32 NUM_STATES = 4;
+
+   CForagingStats();
+
+   /*
+    * Sets the length of the sliding window, in steps, and resets the
+    * aggregates.
+    */
+   void Init(UInt32 un_window);
+
+   /*
+    * Resets the aggregates, keeping the memory.
+    */
+   void Reset();
+
+   /*
+    * Adds a step: the food collected in it, the energy at its end and the
+    * number of robots in each state.
+    */
+   void AddStep(UInt32 un_tick,
+                UInt32 un_collected,
+                SInt64 n_energy,
+                const UInt32* pun_state_counts);
+
+   /*
+    * Adds a completed trip of the given duration, in steps.
+    */
+   void AddTrip(UInt32 un_duration);
+
+   /*
+    * Returns the number of steps added since the last reset.
+    */
+   inline UInt64 GetSteps() const {
+      return m_unSteps;
+   }
+
+   /*
+    * Returns the food collected per step over the whole trial, and over
+    * the sliding window.
+    */
+   Real GetRate() const;
+   Real GetWindowRate() const;
+
+   /*
+    * Returns the number of completed trips, and their mean duration.
+    */
+   inline UInt64 GetTrips() const {
+      return m_unTrips;
+   }
+   Real GetTripMean() const;
+
+   /*
+    * Returns an estimate of the given quantile of the trip durations,
+    * f_quantile in [0,1].
+    */
+   Real GetTripQuantile(Real f_quantile) const;
+
+   /*
+    * Returns the robot-steps spent in the given state.
+    */
+   inline UInt64 GetStateSteps(UInt32 un_state) const {
+      return m_punStateSteps[un_state];
+   }
+
+   /*
+    * Returns the slope of the energy per step: least-squares over the
+    * whole trial, and the mean change over the sliding window.
+    */
+   Real GetEnergySlope() const;
+   Real GetWindowEnergySlope() const;
+
+private:
+
+   /* Trip time histogram: bucket i holds durations d with
+      floor(BUCKETS_PER_OCTAVE * log2(d + 1)) == i */
+   static const UInt32 BUCKETS_PER_OCTAVE = 8;
+   static const UInt32 NUM_BUCKETS = BUCKETS_PER_OCTAVE * 32;
+
+   /* A step in the sliding window */
+   struct SStep {
+      UInt64 Collected;
+      SInt64 Energy;
+   };
+
+   UInt32 m_unWindow;
+   /* The last m_unWindow+1 steps, with the collected food as a running
+      total */
+   std::vector<SStep> m_vecRing;
+   UInt64 m_unSteps;
+   UInt64 m_unCollected;
+
+   /* Trip durations */
+   UInt64 m_unTrips;
+   Real m_fTripMean;
+   UInt32 m_unTripMin, m_unTripMax;
+   std::vector<UInt64> m_vecTripBuckets;
+
+   /* Robot-steps per state */
+   UInt64 m_punStateSteps[NUM_STATES];
+
+   /* Energy regression: running means of tick and energy, and the sums of
+      the squared and crossed deviations */
+   Real m_fMeanTick;
+   Real m_fMeanEnergy;
+   Real m_fTickTick;
+   Real m_fTickEnergy;
+
+};
+
+#endif
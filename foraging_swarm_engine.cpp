@@ -0,0 +1,192 @@
+#include "foraging_swarm_engine.h"
+#include "footbot_foraging.h"
+#include "footbot_foraging_policies.h"
+#include <algorithm>
+
+/****************************************/
+/****************************************/
+
+CForagingSwarmEngine& CForagingSwarmEngine::GetInstance() {
+   static CForagingSwarmEngine cInstance;
+   return cInstance;
+}
+
+/****************************************/
+/****************************************/
+
+CForagingSwarmEngine::CForagingSwarmEngine() :
+   m_unRegistered(0) {}
+
+/****************************************/
+/****************************************/
+
+UInt32 CForagingSwarmEngine::Register(CFootBotForaging* pc_robot) {
+   UInt32 unSlot = m_vecRobots.size();
+   m_vecRobots.push_back(pc_robot);
+   m_vecDiffusion.push_back(CVector2::X);
+   m_vecCollision.push_back(0);
+   m_vecToLight.push_back(CVector2());
+   m_vecHeadingX.push_back(0.0);
+   m_vecHeadingY.push_back(0.0);
+   m_vecHasHeading.push_back(0);
+   m_vecTurningMechanism.push_back(pc_robot->m_sStateData.TurningMechanism);
+   m_vecLeftSpeed.push_back(0.0);
+   m_vecRightSpeed.push_back(0.0);
+   m_vecActive.reserve(m_vecRobots.size());
+   ++m_unRegistered;
+   return unSlot;
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingSwarmEngine::Unregister(UInt32 un_slot) {
+   m_vecRobots[un_slot] = NULL;
+   --m_unRegistered;
+   /* When the experiment is over, start from scratch for the next one */
+   if(m_unRegistered == 0) {
+      m_vecRobots.clear();
+      m_vecActive.clear();
+      m_vecProxCos.clear();
+      m_vecProxSin.clear();
+      m_vecLightCos.clear();
+      m_vecLightSin.clear();
+      m_vecDiffusion.clear();
+      m_vecCollision.clear();
+      m_vecToLight.clear();
+      m_vecHeadingX.clear();
+      m_vecHeadingY.clear();
+      m_vecHasHeading.clear();
+      m_vecTurningMechanism.clear();
+      m_vecLeftSpeed.clear();
+      m_vecRightSpeed.clear();
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingSwarmEngine::Step() {
+   /* Phase 1: sensor reductions for the robots that may move */
+   ReduceSensors();
+   /* Phase 2: state machines, recording the headings */
+   std::fill(m_vecHasHeading.begin(), m_vecHasHeading.end(), 0);
+   for(size_t i = 0; i < m_vecRobots.size(); ++i) {
+      if(m_vecRobots[i] != NULL) {
+         m_vecRobots[i]->ExecuteState();
+      }
+   }
+   /* Phase 3: wheel speeds */
+   ComputeWheelSpeeds();
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingSwarmEngine::ReduceSensors() {
+   /* Resting robots never use the reductions */
+   m_vecActive.clear();
+   for(size_t i = 0; i < m_vecRobots.size(); ++i) {
+      if(m_vecRobots[i] != NULL && !m_vecRobots[i]->IsResting()) {
+         m_vecActive.push_back(i);
+      }
+   }
+   if(m_vecActive.empty()) return;
+   /* The sensor angles are fixed on the body: take them once */
+   if(m_vecProxCos.empty()) {
+      const CCI_FootBotProximitySensor::TReadings& tProxReads = m_vecRobots[m_vecActive[0]]->m_pcProximity->GetReadings();
+      for(size_t j = 0; j < tProxReads.size(); ++j) {
+         m_vecProxCos.push_back(Cos(tProxReads[j].Angle));
+         m_vecProxSin.push_back(Sin(tProxReads[j].Angle));
+      }
+      const CCI_FootBotLightSensor::TReadings& tLightReads = m_vecRobots[m_vecActive[0]]->m_pcLight->GetReadings();
+      for(size_t j = 0; j < tLightReads.size(); ++j) {
+         m_vecLightCos.push_back(Cos(tLightReads[j].Angle));
+         m_vecLightSin.push_back(Sin(tLightReads[j].Angle));
+      }
+   }
+   size_t unProx = m_vecProxCos.size();
+   size_t unLight = m_vecLightCos.size();
+   size_t unActive = m_vecActive.size();
+   /* Gather the readings into contiguous rows */
+   m_vecProxValues.resize(unActive * unProx);
+   m_vecLightValues.resize(unActive * unLight);
+   for(size_t a = 0; a < unActive; ++a) {
+      CFootBotForaging& cRobot = *m_vecRobots[m_vecActive[a]];
+      const CCI_FootBotProximitySensor::TReadings& tProxReads = cRobot.m_pcProximity->GetReadings();
+      Real* pfProx = &m_vecProxValues[a * unProx];
+      for(size_t j = 0; j < unProx; ++j) {
+         pfProx[j] = tProxReads[j].Value;
+      }
+      const CCI_FootBotLightSensor::TReadings& tLightReads = cRobot.m_pcLight->GetReadings();
+      Real* pfLight = &m_vecLightValues[a * unLight];
+      for(size_t j = 0; j < unLight; ++j) {
+         pfLight[j] = tLightReads[j].Value;
+      }
+   }
+   /* Reduce the rows: these are plain dot products */
+   const Real* pfProxCos = &m_vecProxCos[0];
+   const Real* pfProxSin = &m_vecProxSin[0];
+   const Real* pfLightCos = &m_vecLightCos[0];
+   const Real* pfLightSin = &m_vecLightSin[0];
+   for(size_t a = 0; a < unActive; ++a) {
+      UInt32 unSlot = m_vecActive[a];
+      /* Diffusion vector */
+      const Real* pfProx = &m_vecProxValues[a * unProx];
+      Real fX = 0.0, fY = 0.0;
+      for(size_t j = 0; j < unProx; ++j) {
+         fX += pfProx[j] * pfProxCos[j];
+         fY += pfProx[j] * pfProxSin[j];
+      }
+      CVector2 cDiffusionVector(fX, fY);
+      const CFootBotForaging::SDiffusionParams& sParams = m_vecRobots[unSlot]->m_psParams->Diffusion;
+      if(sParams.GoStraightAngleRange.WithinMinBoundIncludedMaxBoundIncluded(cDiffusionVector.Angle()) &&
+         cDiffusionVector.Length() < sParams.Delta) {
+         m_vecCollision[unSlot] = 0;
+         m_vecDiffusion[unSlot] = CVector2::X;
+      }
+      else {
+         m_vecCollision[unSlot] = 1;
+         cDiffusionVector.Normalize();
+         m_vecDiffusion[unSlot] = -cDiffusionVector;
+      }
+      /* Vector to the light */
+      const Real* pfLight = &m_vecLightValues[a * unLight];
+      fX = 0.0;
+      fY = 0.0;
+      for(size_t j = 0; j < unLight; ++j) {
+         fX += pfLight[j] * pfLightCos[j];
+         fY += pfLight[j] * pfLightSin[j];
+      }
+      CVector2 cAccumulator(fX, fY);
+      if(cAccumulator.Length() > 0.0f) {
+         m_vecToLight[unSlot] = CVector2(1.0f, cAccumulator.Angle());
+      }
+      else {
+         m_vecToLight[unSlot] = CVector2();
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CForagingSwarmEngine::ComputeWheelSpeeds() {
+   for(size_t i = 0; i < m_vecRobots.size(); ++i) {
+      if(!m_vecHasHeading[i]) continue;
+      CFootBotForaging::SWheelTurningParams::ETurningMechanism eMechanism =
+         static_cast<CFootBotForaging::SWheelTurningParams::ETurningMechanism>(m_vecTurningMechanism[i]);
+      SThreeStateTurning::WheelSpeeds(m_vecRobots[i]->m_psParams->WheelTurning,
+                                      eMechanism,
+                                      CVector2(m_vecHeadingX[i], m_vecHeadingY[i]),
+                                      m_vecLeftSpeed[i],
+                                      m_vecRightSpeed[i]);
+      m_vecTurningMechanism[i] = eMechanism;
+   }
+   /* Scatter the speeds to the actuators */
+   for(size_t i = 0; i < m_vecRobots.size(); ++i) {
+      if(m_vecHasHeading[i]) {
+         m_vecRobots[i]->SetWheelSpeeds(m_vecLeftSpeed[i], m_vecRightSpeed[i]);
+      }
+   }
+}
@@ -0,0 +1,135 @@
+/*
+ * Swarm-level engine for the batched execution mode of CFootBotForaging.
+ *
+ * In batched mode the controllers do nothing in ControlStep(). Once every
+ * robot has sensed, the loop functions call Step(), which:
+ *
+ * 1. gathers the proximity and light readings of all the robots that are
+ *    not resting into structure-of-arrays buffers and reduces them to the
+ *    diffusion vector and the vector to the light in tight loops;
+ * 2. runs each robot's state machine, which reads the precomputed vectors
+ *    and stores the heading it wants instead of driving the wheels;
+ * 3. turns all the headings into wheel speeds in one pass, with the
+ *    turning mechanism of each robot kept here rather than in the robot.
+ *
+ * The actuators are applied by ARGoS at the next step in both modes, so a
+ * batched run is identical to a per-robot one.
+ */
+
+#ifndef FORAGING_SWARM_ENGINE_H
+#define FORAGING_SWARM_ENGINE_H
+
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <argos3/core/utility/math/vector2.h>
+#include <vector>
+
+using namespace argos;
+
+class CFootBotForaging;
+
+class CForagingSwarmEngine {
+
+public:
+
+   /*
+    * Returns the engine shared by all the batched controllers.
+    */
+   static CForagingSwarmEngine& GetInstance();
+
+   /*
+    * Adds a robot to the engine, returning its slot.
+    */
+   UInt32 Register(CFootBotForaging* pc_robot);
+
+   /*
+    * Removes a robot from the engine.
+    */
+   void Unregister(UInt32 un_slot);
+
+   /*
+    * Returns true if no robot is registered.
+    */
+   inline bool IsEmpty() const {
+      return m_unRegistered == 0;
+   }
+
+   /*
+    * Executes one control step for all the registered robots.
+    */
+   void Step();
+
+   /*
+    * Returns the diffusion vector of a robot, computed in Step().
+    */
+   inline const CVector2& GetDiffusionVector(UInt32 un_slot, bool& b_collision) const {
+      b_collision = (m_vecCollision[un_slot] != 0);
+      return m_vecDiffusion[un_slot];
+   }
+
+   /*
+    * Returns the vector to the light of a robot, computed in Step().
+    */
+   inline const CVector2& GetVectorToLight(UInt32 un_slot) const {
+      return m_vecToLight[un_slot];
+   }
+
+   /*
+    * Records the heading a robot wants to follow in this step.
+    */
+   inline void SetHeading(UInt32 un_slot, const CVector2& c_heading) {
+      m_vecHeadingX[un_slot] = c_heading.GetX();
+      m_vecHeadingY[un_slot] = c_heading.GetY();
+      m_vecHasHeading[un_slot] = 1;
+   }
+
+   /*
+    * Accessors to the turning mechanism of a robot.
+    */
+   inline UInt8 GetTurningMechanism(UInt32 un_slot) const {
+      return m_vecTurningMechanism[un_slot];
+   }
+
+   inline void SetTurningMechanism(UInt32 un_slot, UInt8 un_mechanism) {
+      m_vecTurningMechanism[un_slot] = un_mechanism;
+   }
+
+private:
+
+   CForagingSwarmEngine();
+
+   /* Phase 1: sensor reductions */
+   void ReduceSensors();
+
+   /* Phase 3: wheel speeds from the headings */
+   void ComputeWheelSpeeds();
+
+private:
+
+   /* The robots, indexed by slot; NULL for free slots */
+   std::vector<CFootBotForaging*> m_vecRobots;
+   UInt32 m_unRegistered;
+
+   /* Slots of the robots that need the sensor reductions in this step */
+   std::vector<UInt32> m_vecActive;
+
+   /* Cosine and sine of the sensor angles, which are fixed on the body */
+   std::vector<Real> m_vecProxCos, m_vecProxSin;
+   std::vector<Real> m_vecLightCos, m_vecLightSin;
+   /* Gathered readings, one row of sensors per active robot */
+   std::vector<Real> m_vecProxValues;
+   std::vector<Real> m_vecLightValues;
+
+   /* Per-robot results of the reductions */
+   std::vector<CVector2> m_vecDiffusion;
+   std::vector<UInt8> m_vecCollision;
+   std::vector<CVector2> m_vecToLight;
+
+   /* Per-robot wheel control */
+   std::vector<Real> m_vecHeadingX, m_vecHeadingY;
+   std::vector<UInt8> m_vecHasHeading;
+   std::vector<UInt8> m_vecTurningMechanism;
+   std::vector<Real> m_vecLeftSpeed, m_vecRightSpeed;
+
+};
+
+#endif
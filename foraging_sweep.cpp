@@ -0,0 +1,552 @@
+/*
+ * Headless parameter-sweep runner for the foraging experiment.
+ *
+ * Takes a template .argos file, a grid of attribute values and a list of
+ * seeds, and runs one 'argos3 -c' process per (point, seed) with the
+ * visualization disabled, keeping all cores busy. The longest runs are
+ * scheduled first and every finished run is appended to a journal, so a
+ * crashed sweep resumes where it stopped when restarted with the same
+ * arguments. When all the runs are done, the journal is aggregated into
+ * one table with the mean and 95% confidence interval of the collected
+ * food and the final energy for each parameter point.
+ *
+ * Example:
+ *
+ *    foraging_sweep -c foraging.argos -l 2000 -s 1-10 \
+ *                   -p pheromones.intensity=60,90,120 \
+ *                   -p pheromones.dissipation=1,2 \
+ *                   -o sweep_results.tsv
+ *
+ * Parameters are given as 'node.attribute=v1,v2,...', where 'node' is the
+ * tag of the first element with that name in the configuration (e.g.
+ * 'pheromones', 'state', 'diffusion', 'foraging' or 'entity').
+ */
+
+#include <argos3/core/utility/configuration/argos_configuration.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace argos;
+
+/****************************************/
+/****************************************/
+
+/*
+ * A swept attribute: which node/attribute it addresses and its values.
+ */
+struct SSweepParam {
+   std::string Node;
+   std::string Attribute;
+   std::vector<std::string> Values;
+};
+
+/*
+ * One simulation to run.
+ */
+struct SSweepRun {
+   size_t Point;           // index of the parameter point
+   UInt32 Seed;            // random seed of the run
+   Real EstimatedCost;     // used to schedule longest-first
+   std::string ConfigFile; // the generated .argos file
+   std::string OutputFile; // the loop functions' output file
+   std::string LogFile;    // stdout/stderr of argos3
+};
+
+/*
+ * The outcome of one finished simulation.
+ */
+struct SSweepResult {
+   Real CollectedFood;
+   Real Energy;
+   Real WallSeconds;
+};
+
+/****************************************/
+/****************************************/
+
+static void PrintUsage(const char* pch_name) {
+   std::cerr << "Usage: " << pch_name << " -c <template.argos> -p <node.attr=v1,v2,...> [-p ...]" << std::endl
+             << "          [-s <seeds, e.g. 1,2,5-9>] [-l <seconds>] [-j <jobs>]" << std::endl
+             << "          [-w <work dir>] [-o <results.tsv>] [-a <argos3 binary>]" << std::endl;
+}
+
+/****************************************/
+/****************************************/
+
+static std::vector<std::string> Split(const std::string& str_in, char ch_sep) {
+   std::vector<std::string> vecTokens;
+   std::istringstream cIn(str_in);
+   std::string strToken;
+   while(std::getline(cIn, strToken, ch_sep)) {
+      if(!strToken.empty()) vecTokens.push_back(strToken);
+   }
+   return vecTokens;
+}
+
+/****************************************/
+/****************************************/
+
+static SSweepParam ParseParam(const std::string& str_arg) {
+   size_t unEq = str_arg.find('=');
+   size_t unDot = str_arg.find('.');
+   if(unEq == std::string::npos || unDot == std::string::npos || unDot > unEq) {
+      THROW_ARGOSEXCEPTION("Malformed parameter \"" << str_arg << "\", expected node.attribute=v1,v2,...");
+   }
+   SSweepParam sParam;
+   sParam.Node = str_arg.substr(0, unDot);
+   sParam.Attribute = str_arg.substr(unDot + 1, unEq - unDot - 1);
+   sParam.Values = Split(str_arg.substr(unEq + 1), ',');
+   if(sParam.Values.empty()) {
+      THROW_ARGOSEXCEPTION("No values given for parameter \"" << str_arg << "\"");
+   }
+   return sParam;
+}
+
+/****************************************/
+/****************************************/
+
+static std::vector<UInt32> ParseSeeds(const std::string& str_arg) {
+   std::vector<UInt32> vecSeeds;
+   std::vector<std::string> vecTokens = Split(str_arg, ',');
+   for(size_t i = 0; i < vecTokens.size(); ++i) {
+      size_t unDash = vecTokens[i].find('-');
+      if(unDash == std::string::npos) {
+         vecSeeds.push_back(std::strtoul(vecTokens[i].c_str(), NULL, 10));
+      }
+      else {
+         UInt32 unFrom = std::strtoul(vecTokens[i].substr(0, unDash).c_str(), NULL, 10);
+         UInt32 unTo   = std::strtoul(vecTokens[i].substr(unDash + 1).c_str(), NULL, 10);
+         for(UInt32 s = unFrom; s <= unTo; ++s) vecSeeds.push_back(s);
+      }
+   }
+   return vecSeeds;
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * Depth-first search for the first element with the given tag.
+ */
+static TConfigurationNode* FindNode(TConfigurationNode& t_node, const std::string& str_tag) {
+   if(t_node.Value() == str_tag) return &t_node;
+   TConfigurationNodeIterator itChildren;
+   for(itChildren = itChildren.begin(&t_node);
+       itChildren != itChildren.end();
+       ++itChildren) {
+      TConfigurationNode* ptFound = FindNode(*itChildren, str_tag);
+      if(ptFound != NULL) return ptFound;
+   }
+   return NULL;
+}
+
+/****************************************/
+/****************************************/
+
+static TConfigurationNode& GetSweepNode(TConfigurationNode& t_root, const std::string& str_tag) {
+   TConfigurationNode* ptNode = FindNode(t_root, str_tag);
+   if(ptNode == NULL) {
+      THROW_ARGOSEXCEPTION("No <" << str_tag << "> node in the template configuration");
+   }
+   return *ptNode;
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * Canonical, human-readable key of a parameter point, used in the journal.
+ */
+static std::string PointKey(const std::vector<SSweepParam>& vec_params,
+                            const std::vector<size_t>& vec_point) {
+   std::ostringstream cKey;
+   for(size_t i = 0; i < vec_params.size(); ++i) {
+      if(i > 0) cKey << ';';
+      cKey << vec_params[i].Node << '.' << vec_params[i].Attribute << '='
+           << vec_params[i].Values[vec_point[i]];
+   }
+   return cKey.str();
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * Returns true if the loop functions have a <termination> node with at
+ * least one criterion enabled, i.e. nonzero.
+ */
+static bool HasStopCriterion(TConfigurationNode& t_loop_functions) {
+   if(!NodeExists(t_loop_functions, "termination")) return false;
+   TConfigurationNode& tTermination = GetNode(t_loop_functions, "termination");
+   static const char* CRITERIA[] = {
+      "steady_window", "food_target", "energy_target", "wall_clock_budget"
+   };
+   for(size_t i = 0; i < sizeof(CRITERIA) / sizeof(CRITERIA[0]); ++i) {
+      Real fValue = 0.0;
+      GetNodeAttributeOrDefault(tTermination, CRITERIA[i], fValue, fValue);
+      if(fValue != 0.0) return true;
+   }
+   return false;
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * Reads the final counters of a loop functions output file: from the last
+ * data line (clock, walking, resting, collected_food, energy), or, if the
+ * per-step rows are disabled, from the last "# summary" line.
+ */
+static bool ReadFinalCounters(const std::string& str_file, SSweepResult& s_result) {
+   std::ifstream cIn(str_file.c_str());
+   std::string strLine, strLast, strSummary;
+   while(std::getline(cIn, strLine)) {
+      if(strLine.empty()) continue;
+      if(strLine[0] != '#') strLast = strLine;
+      else if(strLine.compare(0, 10, "# summary\t") == 0) strSummary = strLine;
+   }
+   if(!strLast.empty()) {
+      std::istringstream cLine(strLast);
+      Real fClock, fWalking, fResting;
+      cLine >> fClock >> fWalking >> fResting >> s_result.CollectedFood >> s_result.Energy;
+      return !cLine.fail();
+   }
+   if(strSummary.empty()) return false;
+   /* Tab-separated key/value pairs after the tag */
+   std::istringstream cLine(strSummary.substr(10));
+   std::string strKey, strValue;
+   bool bFood = false, bEnergy = false;
+   while(std::getline(cLine, strKey, '\t') && std::getline(cLine, strValue, '\t')) {
+      if(strKey == "collected_food") {
+         s_result.CollectedFood = std::atof(strValue.c_str());
+         bFood = true;
+      }
+      else if(strKey == "energy") {
+         s_result.Energy = std::atof(strValue.c_str());
+         bEnergy = true;
+      }
+   }
+   return bFood && bEnergy;
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * Two-sided 95% Student t critical value for the given degrees of freedom.
+ */
+static Real StudentT95(size_t un_dof) {
+   static const Real TABLE[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+   };
+   if(un_dof == 0) return 0.0;
+   if(un_dof <= 30) return TABLE[un_dof - 1];
+   return 1.960;
+}
+
+static void MeanCI95(const std::vector<Real>& vec_samples, Real& f_mean, Real& f_ci) {
+   f_mean = 0.0;
+   f_ci = 0.0;
+   if(vec_samples.empty()) return;
+   for(size_t i = 0; i < vec_samples.size(); ++i) f_mean += vec_samples[i];
+   f_mean /= vec_samples.size();
+   if(vec_samples.size() < 2) return;
+   Real fVar = 0.0;
+   for(size_t i = 0; i < vec_samples.size(); ++i) fVar += Square(vec_samples[i] - f_mean);
+   fVar /= (vec_samples.size() - 1);
+   f_ci = StudentT95(vec_samples.size() - 1) * std::sqrt(fVar / vec_samples.size());
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * Starts argos3 on the given run, returning the child pid.
+ */
+static pid_t LaunchRun(const std::string& str_argos, const SSweepRun& s_run) {
+   pid_t tPid = fork();
+   if(tPid < 0) {
+      THROW_ARGOSEXCEPTION("fork() failed: " << std::strerror(errno));
+   }
+   if(tPid == 0) {
+      /* Child: send all the output to the log file and exec argos3 */
+      int nLog = open(s_run.LogFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if(nLog >= 0) {
+         dup2(nLog, STDOUT_FILENO);
+         dup2(nLog, STDERR_FILENO);
+         close(nLog);
+      }
+      execlp(str_argos.c_str(), str_argos.c_str(), "-c", s_run.ConfigFile.c_str(), (char*)NULL);
+      std::cerr << "Cannot execute " << str_argos << ": " << std::strerror(errno) << std::endl;
+      _exit(127);
+   }
+   return tPid;
+}
+
+/****************************************/
+/****************************************/
+
+int main(int argc, char** argv) {
+   std::string strTemplate;
+   std::string strWorkDir = "sweep";
+   std::string strResults = "sweep_results.tsv";
+   std::string strArgos = "argos3";
+   std::vector<SSweepParam> vecParams;
+   std::vector<UInt32> vecSeeds(1, 1);
+   UInt32 unLength = 0;
+   UInt32 unJobs = std::thread::hardware_concurrency();
+   if(unJobs == 0) unJobs = 1;
+   try {
+      /*
+       * Parse the command line
+       */
+      int nOpt;
+      while((nOpt = getopt(argc, argv, "c:p:s:l:j:w:o:a:h")) != -1) {
+         switch(nOpt) {
+            case 'c': strTemplate = optarg; break;
+            case 'p': vecParams.push_back(ParseParam(optarg)); break;
+            case 's': vecSeeds = ParseSeeds(optarg); break;
+            case 'l': unLength = std::strtoul(optarg, NULL, 10); break;
+            case 'j': unJobs = Max<UInt32>(1, std::strtoul(optarg, NULL, 10)); break;
+            case 'w': strWorkDir = optarg; break;
+            case 'o': strResults = optarg; break;
+            case 'a': strArgos = optarg; break;
+            default: PrintUsage(argv[0]); return 1;
+         }
+      }
+      if(strTemplate.empty() || vecSeeds.empty()) {
+         PrintUsage(argv[0]);
+         return 1;
+      }
+      if(mkdir(strWorkDir.c_str(), 0755) != 0 && errno != EEXIST) {
+         THROW_ARGOSEXCEPTION("Cannot create work directory \"" << strWorkDir << "\": " << std::strerror(errno));
+      }
+      /*
+       * Load the template and check that every swept node exists
+       */
+      ticpp::Document tTemplate(strTemplate);
+      tTemplate.LoadFile();
+      TConfigurationNode& tRoot = *tTemplate.FirstChildElement("argos-configuration");
+      for(size_t i = 0; i < vecParams.size(); ++i) {
+         GetSweepNode(tRoot, vecParams[i].Node);
+      }
+      /* The configured length (in seconds) is used unless overridden */
+      if(unLength == 0) {
+         GetNodeAttribute(GetSweepNode(tRoot, "experiment"), "length", unLength);
+      }
+      if(unLength == 0 && !HasStopCriterion(GetSweepNode(tRoot, "loop_functions"))) {
+         THROW_ARGOSEXCEPTION("The experiment runs forever: give a length with -l or a nonzero criterion in the <termination> node");
+      }
+      /*
+       * Enumerate the grid
+       */
+      std::vector<std::vector<size_t> > vecPoints(1);
+      for(size_t i = 0; i < vecParams.size(); ++i) {
+         std::vector<std::vector<size_t> > vecNext;
+         for(size_t p = 0; p < vecPoints.size(); ++p) {
+            for(size_t v = 0; v < vecParams[i].Values.size(); ++v) {
+               vecNext.push_back(vecPoints[p]);
+               vecNext.back().push_back(v);
+            }
+         }
+         vecPoints.swap(vecNext);
+      }
+      std::vector<std::string> vecKeys;
+      for(size_t p = 0; p < vecPoints.size(); ++p) {
+         vecKeys.push_back(PointKey(vecParams, vecPoints[p]));
+      }
+      /*
+       * Read the journal of a previous, possibly crashed, sweep
+       */
+      std::string strJournal = strWorkDir + "/journal.tsv";
+      std::map<std::pair<std::string, UInt32>, SSweepResult> mapDone;
+      {
+         std::ifstream cJournal(strJournal.c_str());
+         std::string strLine;
+         while(std::getline(cJournal, strLine)) {
+            std::vector<std::string> vecFields = Split(strLine, '\t');
+            if(vecFields.size() != 5) continue;
+            SSweepResult sResult;
+            sResult.CollectedFood = std::strtod(vecFields[2].c_str(), NULL);
+            sResult.Energy        = std::strtod(vecFields[3].c_str(), NULL);
+            sResult.WallSeconds   = std::strtod(vecFields[4].c_str(), NULL);
+            mapDone[std::make_pair(vecFields[0], std::strtoul(vecFields[1].c_str(), NULL, 10))] = sResult;
+         }
+      }
+      /*
+       * Estimate the cost of each point as length times robots; once some
+       * points have been timed, use the measured times and convert the
+       * estimates of the others to seconds with the measured rate
+       */
+      UInt32 unRobots = 1;
+      GetNodeAttributeOrDefault(GetSweepNode(tRoot, "entity"), "quantity", unRobots, unRobots);
+      std::vector<Real> vecCost(vecPoints.size());
+      std::vector<Real> vecTimed(vecPoints.size(), 0.0);
+      std::vector<size_t> vecTimedRuns(vecPoints.size(), 0);
+      Real fTimedCost = 0.0, fTimedSeconds = 0.0;
+      for(size_t p = 0; p < vecPoints.size(); ++p) {
+         /* Without a length, the stop criteria decide: assume a nominal one */
+         Real fLength = (unLength > 0) ? unLength : 1.0, fRobots = unRobots;
+         for(size_t i = 0; i < vecParams.size(); ++i) {
+            const std::string& strValue = vecParams[i].Values[vecPoints[p][i]];
+            if(vecParams[i].Node == "entity" && vecParams[i].Attribute == "quantity") {
+               fRobots = std::strtod(strValue.c_str(), NULL);
+            }
+         }
+         vecCost[p] = fLength * fRobots;
+         for(size_t s = 0; s < vecSeeds.size(); ++s) {
+            std::map<std::pair<std::string, UInt32>, SSweepResult>::const_iterator it =
+               mapDone.find(std::make_pair(vecKeys[p], vecSeeds[s]));
+            if(it != mapDone.end()) {
+               vecTimed[p] += it->second.WallSeconds;
+               ++vecTimedRuns[p];
+               fTimedCost += vecCost[p];
+               fTimedSeconds += it->second.WallSeconds;
+            }
+         }
+      }
+      for(size_t p = 0; p < vecPoints.size(); ++p) {
+         if(vecTimedRuns[p] > 0) {
+            vecCost[p] = vecTimed[p] / vecTimedRuns[p];
+         }
+         else if(fTimedCost > 0.0) {
+            vecCost[p] *= fTimedSeconds / fTimedCost;
+         }
+      }
+      /*
+       * Create the runs still to do
+       */
+      std::vector<SSweepRun> vecRuns;
+      for(size_t p = 0; p < vecPoints.size(); ++p) {
+         for(size_t s = 0; s < vecSeeds.size(); ++s) {
+            if(mapDone.count(std::make_pair(vecKeys[p], vecSeeds[s])) > 0) continue;
+            SSweepRun sRun;
+            sRun.Point = p;
+            sRun.Seed = vecSeeds[s];
+            sRun.EstimatedCost = vecCost[p];
+            std::ostringstream cBase;
+            cBase << strWorkDir << "/run_" << p << "_" << vecSeeds[s];
+            sRun.ConfigFile = cBase.str() + ".argos";
+            sRun.OutputFile = cBase.str() + ".txt";
+            sRun.LogFile    = cBase.str() + ".log";
+            /* Write the configuration of this run */
+            for(size_t i = 0; i < vecParams.size(); ++i) {
+               GetSweepNode(tRoot, vecParams[i].Node).SetAttribute(vecParams[i].Attribute,
+                                                                    vecParams[i].Values[vecPoints[p][i]]);
+            }
+            TConfigurationNode& tExperiment = GetSweepNode(tRoot, "experiment");
+            tExperiment.SetAttribute("random_seed", sRun.Seed);
+            tExperiment.SetAttribute("length", unLength);
+            GetSweepNode(tRoot, "foraging").SetAttribute("output", sRun.OutputFile);
+            /* No visualization: an empty node makes ARGoS run headless */
+            TConfigurationNode* ptVisualization = FindNode(tRoot, "visualization");
+            if(ptVisualization != NULL) ptVisualization->Clear();
+            tTemplate.SaveFile(sRun.ConfigFile);
+            vecRuns.push_back(sRun);
+         }
+      }
+      /* Longest first, so the tail of the sweep is made of short runs */
+      std::stable_sort(vecRuns.begin(), vecRuns.end(),
+                       [](const SSweepRun& a, const SSweepRun& b) {
+                          return a.EstimatedCost > b.EstimatedCost;
+                       });
+      std::cerr << "[INFO] " << vecPoints.size() << " points x " << vecSeeds.size() << " seeds, "
+                << mapDone.size() << " already done, " << vecRuns.size() << " to run on "
+                << unJobs << " jobs" << std::endl;
+      /*
+       * Run everything, unJobs at a time
+       */
+      std::ofstream cJournal(strJournal.c_str(), std::ios_base::app | std::ios_base::out);
+      std::map<pid_t, std::pair<size_t, struct timespec> > mapRunning;
+      size_t unNext = 0, unFailed = 0;
+      while(unNext < vecRuns.size() || !mapRunning.empty()) {
+         while(unNext < vecRuns.size() && mapRunning.size() < unJobs) {
+            struct timespec tStart;
+            clock_gettime(CLOCK_MONOTONIC, &tStart);
+            mapRunning[LaunchRun(strArgos, vecRuns[unNext])] = std::make_pair(unNext, tStart);
+            ++unNext;
+         }
+         int nStatus;
+         pid_t tPid = waitpid(-1, &nStatus, 0);
+         if(tPid < 0) {
+            if(errno == EINTR) continue;
+            THROW_ARGOSEXCEPTION("waitpid() failed: " << std::strerror(errno));
+         }
+         std::map<pid_t, std::pair<size_t, struct timespec> >::iterator it = mapRunning.find(tPid);
+         if(it == mapRunning.end()) continue;
+         const SSweepRun& sRun = vecRuns[it->second.first];
+         struct timespec tEnd;
+         clock_gettime(CLOCK_MONOTONIC, &tEnd);
+         SSweepResult sResult;
+         sResult.WallSeconds = (tEnd.tv_sec - it->second.second.tv_sec) +
+                               1e-9 * (tEnd.tv_nsec - it->second.second.tv_nsec);
+         mapRunning.erase(it);
+         if(!WIFEXITED(nStatus) || WEXITSTATUS(nStatus) != 0 ||
+            !ReadFinalCounters(sRun.OutputFile, sResult)) {
+            std::cerr << "[WARNING] Run failed, see " << sRun.LogFile << std::endl;
+            ++unFailed;
+            continue;
+         }
+         /* One line per run, flushed right away: this is what makes resuming possible */
+         cJournal << vecKeys[sRun.Point] << '\t' << sRun.Seed << '\t'
+                  << sResult.CollectedFood << '\t' << sResult.Energy << '\t'
+                  << sResult.WallSeconds << std::endl;
+         mapDone[std::make_pair(vecKeys[sRun.Point], sRun.Seed)] = sResult;
+         std::cerr << "[INFO] Done " << vecKeys[sRun.Point] << " seed " << sRun.Seed
+                   << " in " << sResult.WallSeconds << " s" << std::endl;
+      }
+      /*
+       * Aggregate the results per parameter point
+       */
+      std::ofstream cResults(strResults.c_str(), std::ios_base::trunc | std::ios_base::out);
+      cResults << "#";
+      for(size_t i = 0; i < vecParams.size(); ++i) {
+         cResults << " " << vecParams[i].Node << "." << vecParams[i].Attribute << "\t";
+      }
+      cResults << "runs\tcollected_food_mean\tcollected_food_ci95\tenergy_mean\tenergy_ci95" << std::endl;
+      for(size_t p = 0; p < vecPoints.size(); ++p) {
+         std::vector<Real> vecFood, vecEnergy;
+         for(size_t s = 0; s < vecSeeds.size(); ++s) {
+            std::map<std::pair<std::string, UInt32>, SSweepResult>::const_iterator it =
+               mapDone.find(std::make_pair(vecKeys[p], vecSeeds[s]));
+            if(it == mapDone.end()) continue;
+            vecFood.push_back(it->second.CollectedFood);
+            vecEnergy.push_back(it->second.Energy);
+         }
+         Real fFoodMean, fFoodCI, fEnergyMean, fEnergyCI;
+         MeanCI95(vecFood, fFoodMean, fFoodCI);
+         MeanCI95(vecEnergy, fEnergyMean, fEnergyCI);
+         for(size_t i = 0; i < vecParams.size(); ++i) {
+            cResults << vecParams[i].Values[vecPoints[p][i]] << "\t";
+         }
+         cResults << vecFood.size() << "\t"
+                  << fFoodMean << "\t" << fFoodCI << "\t"
+                  << fEnergyMean << "\t" << fEnergyCI << std::endl;
+      }
+      if(unFailed > 0) {
+         std::cerr << "[WARNING] " << unFailed << " runs failed; run the sweep again to retry them" << std::endl;
+         return 1;
+      }
+   }
+   catch(std::exception& ex) {
+      std::cerr << "[FATAL] " << ex.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,78 @@
+#include "homing_default_sensor.h"
+#include "foraging_loop_functions.h"
+#include <argos3/core/simulator/simulator.h>
+
+/****************************************/
+/****************************************/
+
+CHomingDefaultSensor::CHomingDefaultSensor() :
+   m_pcEmbodiedEntity(NULL),
+   m_pcField(NULL) {}
+
+/****************************************/
+/****************************************/
+
+void CHomingDefaultSensor::SetRobot(CComposableEntity& c_entity) {
+   m_pcEmbodiedEntity = &(c_entity.GetComponent<CEmbodiedEntity>("body"));
+}
+
+/****************************************/
+/****************************************/
+
+void CHomingDefaultSensor::Update() {
+   if(m_pcField == NULL) {
+      CForagingLoopFunctions* pcLoopFunctions =
+         dynamic_cast<CForagingLoopFunctions*>(&CSimulator::GetInstance().GetLoopFunctions());
+      if(pcLoopFunctions == NULL) {
+         THROW_ARGOSEXCEPTION("The homing sensor needs the foraging loop functions");
+      }
+      m_pcField = &pcLoopFunctions->GetHomingField();
+   }
+   m_sReading = SReading();
+   const SAnchor& sAnchor = m_pcEmbodiedEntity->GetOriginAnchor();
+   CVector2 cDirection;
+   Real fDistance;
+   if(m_pcField->Get(CVector2(sAnchor.Position.GetX(), sAnchor.Position.GetY()),
+                     cDirection, fDistance)) {
+      CRadians cYaw, cPitch, cRoll;
+      sAnchor.Orientation.ToEulerAngles(cYaw, cPitch, cRoll);
+      m_sReading.Vector = cDirection.Rotate(-cYaw);
+      m_sReading.Distance = fDistance;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CHomingDefaultSensor::Reset() {
+   m_sReading = SReading();
+}
+
+/****************************************/
+/****************************************/
+
+REGISTER_SENSOR(CHomingDefaultSensor,
+                "homing", "default",
+                "Vision-Robot-Behaviors",
+                "1.0",
+                "A virtual sensor reading the homing flow field of the foraging loop functions.",
+                "Reads the flow field computed by the foraging loop functions from the\n"
+                "boxes of the arena, under the robot: the direction to follow to reach\n"
+                "the nest around the obstacles, in the frame of the robot, and the\n"
+                "distance left. The loop functions need the <homing> node.\n\n"
+                "REQUIRED XML CONFIGURATION\n\n"
+                "  <controllers>\n"
+                "    ...\n"
+                "    <my_controller ...>\n"
+                "      ...\n"
+                "      <sensors>\n"
+                "        ...\n"
+                "        <homing implementation=\"default\" />\n"
+                "        ...\n"
+                "      </sensors>\n"
+                "      ...\n"
+                "    </my_controller>\n"
+                "    ...\n"
+                "  </controllers>\n",
+                "Usable"
+   );
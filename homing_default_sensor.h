@@ -0,0 +1,43 @@
+/*
+ * Simulated homing sensor: looks up the flow field of the foraging loop
+ * functions at the position of the robot, and turns the direction into
+ * the frame of the robot. See ci_homing_sensor.h.
+ */
+
+#ifndef HOMING_DEFAULT_SENSOR_H
+#define HOMING_DEFAULT_SENSOR_H
+
+#include "ci_homing_sensor.h"
+#include <argos3/core/simulator/sensor.h>
+#include <argos3/core/simulator/entity/composable_entity.h>
+#include <argos3/core/simulator/entity/embodied_entity.h>
+
+using namespace argos;
+
+class CHomingField;
+
+class CHomingDefaultSensor : public CSimulatedSensor,
+                             public CCI_HomingSensor {
+
+public:
+
+   CHomingDefaultSensor();
+
+   virtual ~CHomingDefaultSensor() {}
+
+   virtual void SetRobot(CComposableEntity& c_entity);
+
+   virtual void Update();
+
+   virtual void Reset();
+
+private:
+
+   CEmbodiedEntity* m_pcEmbodiedEntity;
+   /* The field of the loop functions, which are initialized after the
+      robots */
+   const CHomingField* m_pcField;
+
+};
+
+#endif
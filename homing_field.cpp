@@ -0,0 +1,146 @@
+#include "homing_field.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+
+/****************************************/
+/****************************************/
+
+const Real CHomingField::CLEARANCE_COST = 5.0;
+
+/****************************************/
+/****************************************/
+
+CHomingField::CHomingField() :
+   m_fCellSize(0.05),
+   m_fInvCellSize(20.0),
+   m_unWidth(0),
+   m_unHeight(0) {}
+
+/****************************************/
+/****************************************/
+
+void CHomingField::Init(const CVector2& c_min, const CVector2& c_max, Real f_cell_size) {
+   if(f_cell_size <= 0.0) {
+      THROW_ARGOSEXCEPTION("The homing field cell size must be positive");
+   }
+   if(c_max.GetX() <= c_min.GetX() || c_max.GetY() <= c_min.GetY()) {
+      THROW_ARGOSEXCEPTION("The homing field covers an empty area");
+   }
+   m_cMin = c_min;
+   m_fCellSize = f_cell_size;
+   m_fInvCellSize = 1.0 / f_cell_size;
+   m_unWidth  = static_cast<UInt32>(std::ceil((c_max.GetX() - c_min.GetX()) * m_fInvCellSize));
+   m_unHeight = static_cast<UInt32>(std::ceil((c_max.GetY() - c_min.GetY()) * m_fInvCellSize));
+   m_vecCosts.assign(m_unWidth * m_unHeight, 1.0);
+   m_vecDistances.clear();
+   m_vecDirections.clear();
+}
+
+/****************************************/
+/****************************************/
+
+void CHomingField::AddBox(const CVector2& c_center, const CVector2& c_size,
+                          const CRadians& c_yaw, Real f_clearance) {
+   Real fCos = Cos(c_yaw), fSin = Sin(c_yaw);
+   Real fHalfX = 0.5 * c_size.GetX(), fHalfY = 0.5 * c_size.GetY();
+   /* A cell is blocked if it overlaps the box, i.e. its center is within
+      half a cell of it */
+   Real fHalfCell = 0.5 * m_fCellSize;
+   Real fSquareClearance = f_clearance * f_clearance;
+   /* The cells within the bounding circle of the box and its clearance */
+   Real fReach = std::sqrt(fHalfX * fHalfX + fHalfY * fHalfY) + std::max(f_clearance, fHalfCell);
+   SInt32 nMinX = std::max<SInt32>(0, static_cast<SInt32>(std::floor((c_center.GetX() - fReach - m_cMin.GetX()) * m_fInvCellSize)));
+   SInt32 nMinY = std::max<SInt32>(0, static_cast<SInt32>(std::floor((c_center.GetY() - fReach - m_cMin.GetY()) * m_fInvCellSize)));
+   SInt32 nMaxX = std::min<SInt32>(m_unWidth - 1, static_cast<SInt32>(std::floor((c_center.GetX() + fReach - m_cMin.GetX()) * m_fInvCellSize)));
+   SInt32 nMaxY = std::min<SInt32>(m_unHeight - 1, static_cast<SInt32>(std::floor((c_center.GetY() + fReach - m_cMin.GetY()) * m_fInvCellSize)));
+   for(SInt32 nY = nMinY; nY <= nMaxY; ++nY) {
+      for(SInt32 nX = nMinX; nX <= nMaxX; ++nX) {
+         UInt32 unCell = nY * m_unWidth + nX;
+         CVector2 cOffset = Center(unCell) - c_center;
+         /* Distance to the box along its own axes */
+         Real fLocalX =  cOffset.GetX() * fCos + cOffset.GetY() * fSin;
+         Real fLocalY = -cOffset.GetX() * fSin + cOffset.GetY() * fCos;
+         Real fOutX = std::max<Real>(std::abs(fLocalX) - fHalfX, 0.0);
+         Real fOutY = std::max<Real>(std::abs(fLocalY) - fHalfY, 0.0);
+         if(fOutX <= fHalfCell && fOutY <= fHalfCell) {
+            m_vecCosts[unCell] = 0.0;
+         }
+         else if(m_vecCosts[unCell] > 0.0 &&
+                 fOutX * fOutX + fOutY * fOutY < fSquareClearance) {
+            m_vecCosts[unCell] = std::max(m_vecCosts[unCell], CLEARANCE_COST);
+         }
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CHomingField::Compute(Real f_nest_x) {
+   const UInt32 unCells = m_unWidth * m_unHeight;
+   if(unCells == 0) {
+      THROW_ARGOSEXCEPTION("The homing field must be initialized before it is computed");
+   }
+   /* Dijkstra from the nest cells, remembering where each cell was
+      reached from */
+   typedef std::pair<Real, UInt32> TEntry;
+   std::priority_queue<TEntry, std::vector<TEntry>, std::greater<TEntry> > cQueue;
+   std::vector<UInt32> vecParents(unCells);
+   m_vecDistances.assign(unCells, -1.0);
+   for(UInt32 i = 0; i < unCells; ++i) {
+      vecParents[i] = i;
+      if(m_vecCosts[i] > 0.0 && Center(i).GetX() < f_nest_x) {
+         m_vecDistances[i] = 0.0;
+         cQueue.push(TEntry(0.0, i));
+      }
+   }
+   static const SInt32 pnDX[8] = { 1, -1, 0,  0, 1,  1, -1, -1 };
+   static const SInt32 pnDY[8] = { 0,  0, 1, -1, 1, -1,  1, -1 };
+   const Real pfStep[8] = {
+      m_fCellSize, m_fCellSize, m_fCellSize, m_fCellSize,
+      m_fCellSize * std::sqrt(2.0), m_fCellSize * std::sqrt(2.0),
+      m_fCellSize * std::sqrt(2.0), m_fCellSize * std::sqrt(2.0)
+   };
+   while(!cQueue.empty()) {
+      TEntry tEntry = cQueue.top();
+      cQueue.pop();
+      UInt32 unCell = tEntry.second;
+      if(tEntry.first > m_vecDistances[unCell]) continue;
+      SInt32 nX = unCell % m_unWidth, nY = unCell / m_unWidth;
+      for(UInt32 d = 0; d < 8; ++d) {
+         SInt32 nNX = nX + pnDX[d], nNY = nY + pnDY[d];
+         if(nNX < 0 || nNY < 0 ||
+            nNX >= static_cast<SInt32>(m_unWidth) || nNY >= static_cast<SInt32>(m_unHeight)) {
+            continue;
+         }
+         UInt32 unNext = nNY * m_unWidth + nNX;
+         if(m_vecCosts[unNext] == 0.0) continue;
+         /* No diagonal step across the corner of a box */
+         if(d >= 4 &&
+            (m_vecCosts[nY * m_unWidth + nNX] == 0.0 || m_vecCosts[nNY * m_unWidth + nX] == 0.0)) {
+            continue;
+         }
+         Real fDistance = tEntry.first + pfStep[d] * 0.5 * (m_vecCosts[unCell] + m_vecCosts[unNext]);
+         if(m_vecDistances[unNext] < 0.0 || fDistance < m_vecDistances[unNext]) {
+            m_vecDistances[unNext] = fDistance;
+            vecParents[unNext] = unCell;
+            cQueue.push(TEntry(fDistance, unNext));
+         }
+      }
+   }
+   /* The direction to the cell a few steps ahead on the path; zero in
+      the nest, where the path ends */
+   m_vecDirections.assign(unCells, CVector2());
+   for(UInt32 i = 0; i < unCells; ++i) {
+      if(m_vecDistances[i] <= 0.0) continue;
+      UInt32 unAhead = i;
+      for(UInt32 s = 0; s < LOOKAHEAD && vecParents[unAhead] != unAhead; ++s) {
+         unAhead = vecParents[unAhead];
+      }
+      m_vecDirections[i] = Center(unAhead) - Center(i);
+      m_vecDirections[i].Normalize();
+   }
+}
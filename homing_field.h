@@ -0,0 +1,109 @@
+/*
+ * Flow field leading the foot-bots back to the nest around the obstacles.
+ *
+ * The arena is rasterized into square cells. The cells under a box are
+ * blocked; the cells within the clearance of a box are passable but cost
+ * more to cross, so that the paths keep away from the walls without
+ * stranding the robots that brush against them. A Dijkstra search from
+ * the nest cells over the 8-connected grid gives every cell its distance
+ * to the nest along the obstacles, and the direction to follow, which
+ * points a few cells ahead along the shortest path to smooth out the
+ * eight directions of the grid.
+ *
+ * The field is computed once, when the arena is known, and reading it is
+ * a lookup: see CCI_HomingSensor for the controller side.
+ */
+
+#ifndef HOMING_FIELD_H
+#define HOMING_FIELD_H
+
+#include <argos3/core/utility/math/vector2.h>
+#include <vector>
+
+using namespace argos;
+
+class CHomingField {
+
+public:
+
+   CHomingField();
+
+   /*
+    * Allocates a grid of free cells covering the rectangle from c_min to
+    * c_max, with cells of f_cell_size meters.
+    */
+   void Init(const CVector2& c_min, const CVector2& c_max, Real f_cell_size);
+
+   /*
+    * Blocks the cells under a box with the given center, size and
+    * rotation, and raises the cost of those within f_clearance meters of
+    * it.
+    */
+   void AddBox(const CVector2& c_center, const CVector2& c_size,
+               const CRadians& c_yaw, Real f_clearance);
+
+   /*
+    * Computes the distances and directions, from the cells whose center
+    * is below f_nest_x.
+    */
+   void Compute(Real f_nest_x);
+
+   /*
+    * Returns true if the field is computed.
+    */
+   inline bool IsEnabled() const {
+      return !m_vecDistances.empty();
+   }
+
+   /*
+    * Returns the direction to follow from a position, a unit vector in
+    * the global frame, and the distance to the nest along the obstacles.
+    * Returns false, and leaves them untouched, if the position is outside
+    * of the grid, under a box or cut off from the nest. In the nest, the
+    * direction is zero.
+    */
+   inline bool Get(const CVector2& c_pos, CVector2& c_direction, Real& f_distance) const {
+      SInt32 nX = static_cast<SInt32>((c_pos.GetX() - m_cMin.GetX()) * m_fInvCellSize);
+      SInt32 nY = static_cast<SInt32>((c_pos.GetY() - m_cMin.GetY()) * m_fInvCellSize);
+      if(nX < 0 || nY < 0 ||
+         nX >= static_cast<SInt32>(m_unWidth) || nY >= static_cast<SInt32>(m_unHeight)) {
+         return false;
+      }
+      UInt32 unCell = nY * m_unWidth + nX;
+      if(m_vecDistances[unCell] < 0.0) return false;
+      c_direction = m_vecDirections[unCell];
+      f_distance = m_vecDistances[unCell];
+      return true;
+   }
+
+private:
+
+   /* Center of a cell */
+   inline CVector2 Center(UInt32 un_cell) const {
+      return CVector2(m_cMin.GetX() + (un_cell % m_unWidth + 0.5) * m_fCellSize,
+                      m_cMin.GetY() + (un_cell / m_unWidth + 0.5) * m_fCellSize);
+   }
+
+private:
+
+   /* Cost of crossing a cell within the clearance of a box, relative to a
+      free cell */
+   static const Real CLEARANCE_COST;
+   /* How many cells ahead along the path the direction points */
+   static const UInt32 LOOKAHEAD = 4;
+
+   CVector2 m_cMin;
+   Real m_fCellSize;
+   Real m_fInvCellSize;
+   UInt32 m_unWidth;
+   UInt32 m_unHeight;
+   /* Per cell: crossing cost, zero if blocked */
+   std::vector<Real> m_vecCosts;
+   /* Per cell: distance to the nest in meters, negative if unreachable */
+   std::vector<Real> m_vecDistances;
+   /* Per cell: unit direction to follow */
+   std::vector<CVector2> m_vecDirections;
+
+};
+
+#endif
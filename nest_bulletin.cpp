@@ -0,0 +1,69 @@
+#include "nest_bulletin.h"
+
+/****************************************/
+/****************************************/
+
+CNestBulletin::CNestBulletin() :
+   m_fRange(1.0),
+   m_nSizeX(1),
+   m_nSizeY(1),
+   m_vecSuccessful(1, 0),
+   m_vecUnsuccessful(1, 0) {}
+
+/****************************************/
+/****************************************/
+
+void CNestBulletin::Init(const CVector2& c_min, const CVector2& c_max, Real f_range) {
+   m_cMin = c_min;
+   m_fRange = f_range;
+   m_nSizeX = std::max<SInt32>(1, static_cast<SInt32>(std::ceil((c_max.GetX() - c_min.GetX()) / f_range)));
+   m_nSizeY = std::max<SInt32>(1, static_cast<SInt32>(std::ceil((c_max.GetY() - c_min.GetY()) / f_range)));
+   m_vecSuccessful.assign(m_nSizeX * m_nSizeY, 0);
+   m_vecUnsuccessful.assign(m_nSizeX * m_nSizeY, 0);
+   m_vecUsed.clear();
+   m_vecUsed.reserve(m_vecSuccessful.size());
+}
+
+/****************************************/
+/****************************************/
+
+void CNestBulletin::Clear() {
+   for(size_t i = 0; i < m_vecUsed.size(); ++i) {
+      m_vecSuccessful[m_vecUsed[i]] = 0;
+      m_vecUnsuccessful[m_vecUsed[i]] = 0;
+   }
+   m_vecUsed.clear();
+}
+
+/****************************************/
+/****************************************/
+
+void CNestBulletin::Post(const CVector2& c_pos, bool b_successful) {
+   UInt32 unIdx = ToCellY(c_pos.GetY()) * m_nSizeX + ToCellX(c_pos.GetX());
+   if(m_vecSuccessful[unIdx] == 0 && m_vecUnsuccessful[unIdx] == 0) {
+      m_vecUsed.push_back(unIdx);
+   }
+   if(b_successful) {
+      ++m_vecSuccessful[unIdx];
+   }
+   else {
+      ++m_vecUnsuccessful[unIdx];
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CNestBulletin::Read(const CVector2& c_pos, UInt32& un_successful, UInt32& un_unsuccessful) const {
+   un_successful = 0;
+   un_unsuccessful = 0;
+   if(m_vecUsed.empty()) return;
+   SInt32 nCX = ToCellX(c_pos.GetX());
+   SInt32 nCY = ToCellY(c_pos.GetY());
+   for(SInt32 nY = std::max<SInt32>(0, nCY - 1); nY <= std::min<SInt32>(m_nSizeY - 1, nCY + 1); ++nY) {
+      for(SInt32 nX = std::max<SInt32>(0, nCX - 1); nX <= std::min<SInt32>(m_nSizeX - 1, nCX + 1); ++nX) {
+         un_successful   += m_vecSuccessful[nY * m_nSizeX + nX];
+         un_unsuccessful += m_vecUnsuccessful[nY * m_nSizeX + nX];
+      }
+   }
+}
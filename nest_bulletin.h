@@ -0,0 +1,79 @@
+/*
+ * The nest bulletin board: an aggregated alternative to the range and
+ * bearing channel for the social rule.
+ *
+ * The arena is divided into square cells as large as the communication
+ * range. At every step, the robots that tell a result post it into the
+ * counters of their cell; a robot then hears the results posted in its
+ * cell and in the eight around it. Posting and reading cost O(1) per
+ * robot, instead of every robot scanning the packets of all the others.
+ */
+
+#ifndef NEST_BULLETIN_H
+#define NEST_BULLETIN_H
+
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <argos3/core/utility/math/vector2.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace argos;
+
+class CNestBulletin {
+
+public:
+
+   CNestBulletin();
+
+   /*
+    * Allocates the board for the rectangle [c_min,c_max], with cells of
+    * side f_range.
+    */
+   void Init(const CVector2& c_min, const CVector2& c_max, Real f_range);
+
+   /*
+    * Removes all the posted results, keeping the memory.
+    */
+   void Clear();
+
+   /*
+    * Posts a result at the given position.
+    */
+   void Post(const CVector2& c_pos, bool b_successful);
+
+   /*
+    * Counts the results posted in the cell of the given position and its
+    * eight neighbours, cells being f_range meters wide (see Init()).
+    */
+   void Read(const CVector2& c_pos, UInt32& un_successful, UInt32& un_unsuccessful) const;
+
+private:
+
+   inline SInt32 ToCellX(Real f_x) const {
+      SInt32 nX = static_cast<SInt32>(std::floor((f_x - m_cMin.GetX()) / m_fRange));
+      return nX < 0 ? 0 : (nX >= m_nSizeX ? m_nSizeX - 1 : nX);
+   }
+
+   inline SInt32 ToCellY(Real f_y) const {
+      SInt32 nY = static_cast<SInt32>(std::floor((f_y - m_cMin.GetY()) / m_fRange));
+      return nY < 0 ? 0 : (nY >= m_nSizeY ? m_nSizeY - 1 : nY);
+   }
+
+private:
+
+   /* Lower-left corner of the board */
+   CVector2 m_cMin;
+   /* Side of a cell */
+   Real m_fRange;
+   /* Number of cells along each axis */
+   SInt32 m_nSizeX, m_nSizeY;
+   /* Results posted per cell, row-major */
+   std::vector<UInt32> m_vecSuccessful;
+   std::vector<UInt32> m_vecUnsuccessful;
+   /* Cells with at least a result, to clear them quickly */
+   std::vector<UInt32> m_vecUsed;
+
+};
+
+#endif
@@ -0,0 +1,632 @@
+#include "pheromone_field.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <algorithm>
+
+/****************************************/
+/****************************************/
+
+/* With exponential decay, the field is swept before its scale gets this
+   small, whatever the decay period, so that its inverse stays finite */
+static const Real EXPONENTIAL_MIN_SCALE = 1e-100;
+
+/****************************************/
+/****************************************/
+
+CPheromoneField::CPheromoneField() :
+   m_nResolution(1),
+   m_nMinX(0),
+   m_nMinY(0),
+   m_nSizeX(0),
+   m_nSizeY(0),
+   m_nRegionColumns(1),
+   m_bPendingStamps(false),
+   m_fTotal(0.0),
+   m_unDecayPeriod(1),
+   m_unStepsSinceSweep(0),
+   m_bLazy(false),
+   m_bStamped(false),
+   m_eDecay(DECAY_LINEAR),
+   m_fScale(1.0),
+   m_fInvScale(1.0),
+   m_fThreshold(0.0),
+   m_fDecayed(0.0),
+   m_bLiveStale(false),
+   m_fLiveTotal(0.0),
+   m_unLiveCells(0),
+   m_bPipelined(false),
+   m_fPendingDecay(0.0),
+   m_fBackTotal(0.0),
+   m_bDecayRequested(false),
+   m_bDecayDone(false),
+   m_bStopWorker(false),
+   m_ePhase(PHASE_DEPOSIT),
+   m_unGeneration(0),
+   m_unRunning(0) {}
+
+/****************************************/
+/****************************************/
+
+CPheromoneField::~CPheromoneField() {
+   StopWorker();
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::Init(Real f_width, Real f_height, SInt32 n_resolution, SInt32 n_margin,
+                           bool b_pipelined, bool b_pyramid, UInt32 un_threads,
+                           UInt32 un_decay_period,
+                           EDecay e_decay, Real f_threshold) {
+   StopWorker();
+   if(un_threads == 0) {
+      THROW_ARGOSEXCEPTION("The pheromone field needs at least one thread");
+   }
+   if(b_pipelined && un_threads > 1) {
+      THROW_ARGOSEXCEPTION("Pipelined pheromone decay cannot be combined with several pheromone threads");
+   }
+   if(un_decay_period == 0) {
+      THROW_ARGOSEXCEPTION("The pheromone decay period must be positive");
+   }
+   if(un_decay_period > 1 && b_pipelined) {
+      THROW_ARGOSEXCEPTION("A pheromone decay period cannot be combined with pipelined pheromone decay");
+   }
+   if(un_decay_period > 1 && b_pyramid) {
+      THROW_ARGOSEXCEPTION("A pheromone decay period cannot be combined with the pheromone pyramid");
+   }
+   if(e_decay == DECAY_EXPONENTIAL) {
+      if(f_threshold <= 0.0) {
+         THROW_ARGOSEXCEPTION("Exponential pheromone decay needs a positive threshold, or the cells never run out");
+      }
+      if(b_pipelined) {
+         THROW_ARGOSEXCEPTION("Exponential pheromone decay cannot be combined with pipelined pheromone decay");
+      }
+      if(b_pyramid) {
+         THROW_ARGOSEXCEPTION("Exponential pheromone decay cannot be combined with the pheromone pyramid");
+      }
+   }
+   m_nResolution = n_resolution;
+   SInt32 nHalfX = static_cast<SInt32>(std::ceil(f_width  * 0.5 * n_resolution)) + n_margin;
+   SInt32 nHalfY = static_cast<SInt32>(std::ceil(f_height * 0.5 * n_resolution)) + n_margin;
+   m_nMinX = -nHalfX;
+   m_nMinY = -nHalfY;
+   m_nSizeX = 2 * nHalfX + 1;
+   m_nSizeY = 2 * nHalfY + 1;
+   m_vecCells.assign(m_nSizeX * m_nSizeY, 0.0);
+   m_fTotal = 0.0;
+   /* Strips of whole columns, at least one column wide */
+   UInt32 unRegions = std::min<UInt32>(un_threads, m_nSizeX);
+   m_nRegionColumns = (m_nSizeX + unRegions - 1) / unRegions;
+   unRegions = (m_nSizeX + m_nRegionColumns - 1) / m_nRegionColumns;
+   m_vecRegions.assign(unRegions, SRegion());
+   for(size_t i = 0; i < m_vecRegions.size(); ++i) {
+      SRegion& sRegion = m_vecRegions[i];
+      sRegion.Begin = i * m_nRegionColumns;
+      sRegion.End = std::min<SInt32>(sRegion.Begin + m_nRegionColumns, m_nSizeX);
+      /* A trail rarely covers more than a few percent of the arena */
+      sRegion.Active.reserve((sRegion.End - sRegion.Begin) * m_nSizeY / 16);
+      sRegion.Total = 0.0;
+   }
+   m_bPendingStamps = false;
+   /* Lazy decay */
+   m_unDecayPeriod = un_decay_period;
+   m_unStepsSinceSweep = 0;
+   m_eDecay = e_decay;
+   m_fThreshold = f_threshold;
+   m_fScale = 1.0;
+   m_fInvScale = 1.0;
+   m_bStamped = (m_eDecay == DECAY_LINEAR && m_unDecayPeriod > 1);
+   m_bLazy = m_bStamped || m_eDecay == DECAY_EXPONENTIAL;
+   m_fDecayed = 0.0;
+   if(m_bStamped) {
+      m_vecDecayStamps.assign(m_vecCells.size(), 0.0);
+   }
+   else {
+      m_vecDecayStamps.clear();
+   }
+   m_bLiveStale = false;
+   m_fLiveTotal = 0.0;
+   m_unLiveCells = 0;
+   /* The pyramid reads the front buffer, which stays in m_vecCells */
+   if(b_pyramid) {
+      m_cPyramid.Init(&m_vecCells, m_nSizeX, m_nSizeY);
+   }
+   else {
+      m_cPyramid.Release();
+   }
+   /* Double buffering */
+   m_bPipelined = b_pipelined;
+   m_vecStale.clear();
+   m_bStopWorker = false;
+   if(m_bPipelined) {
+      size_t unCapacity = m_vecRegions[0].Active.capacity();
+      m_vecBack.assign(m_vecCells.size(), 0.0);
+      m_vecBackActive.reserve(unCapacity);
+      m_vecStale.reserve(unCapacity);
+      m_vecBackStale.reserve(unCapacity);
+      m_bDecayRequested = false;
+      m_bDecayDone = false;
+      m_vecWorkers.push_back(std::thread(&CPheromoneField::DecayWorker, this));
+   }
+   else {
+      m_vecBack.clear();
+   }
+   /* The calling thread works on the first strip */
+   m_unGeneration = 0;
+   m_unRunning = 0;
+   for(size_t i = 1; i < m_vecRegions.size(); ++i) {
+      m_vecWorkers.push_back(std::thread(&CPheromoneField::RegionWorker, this, i));
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::Clear() {
+   for(size_t r = 0; r < m_vecRegions.size(); ++r) {
+      std::vector<UInt32>& vecActive = m_vecRegions[r].Active;
+      for(size_t i = 0; i < vecActive.size(); ++i) {
+         m_vecCells[vecActive[i]] = 0.0;
+      }
+   }
+   if(m_bPipelined) {
+      /* The back buffer holds non-zero values at the cells that were
+         active before the last swap: the survivors are active now, the
+         others are stale */
+      std::vector<UInt32>& vecActive = m_vecRegions[0].Active;
+      for(size_t i = 0; i < vecActive.size(); ++i) {
+         m_vecBack[vecActive[i]] = 0.0;
+      }
+      for(size_t i = 0; i < m_vecStale.size(); ++i) {
+         m_vecBack[m_vecStale[i]] = 0.0;
+      }
+      m_vecStale.clear();
+   }
+   for(size_t r = 0; r < m_vecRegions.size(); ++r) {
+      m_vecRegions[r].Active.clear();
+      m_vecRegions[r].Stamps.clear();
+   }
+   m_bPendingStamps = false;
+   m_fTotal = 0.0;
+   /* The stamps of the cells are set again when they are deposited on */
+   m_unStepsSinceSweep = 0;
+   m_fDecayed = 0.0;
+   m_fScale = 1.0;
+   m_fInvScale = 1.0;
+   m_bLiveStale = true;
+   m_cPyramid.Clear();
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::DepositStamp(SInt32 n_x, SInt32 n_y, SInt32 n_radius, Real f_amount) {
+   if(m_vecRegions.size() == 1) {
+      for(SInt32 nY = n_y - n_radius; nY <= n_y + n_radius; ++nY) {
+         for(SInt32 nX = n_x - n_radius; nX <= n_x + n_radius; ++nX) {
+            Deposit(nX, nY, f_amount);
+         }
+      }
+      return;
+   }
+   /* Queue the stamp in every strip it reaches */
+   SInt32 nX0 = std::max<SInt32>(n_x - n_radius - m_nMinX, 0);
+   SInt32 nX1 = std::min<SInt32>(n_x + n_radius - m_nMinX, m_nSizeX - 1);
+   if(nX0 > nX1 ||
+      n_y + n_radius < m_nMinY ||
+      n_y - n_radius >= m_nMinY + m_nSizeY) return;
+   SStamp sStamp;
+   sStamp.X = n_x - m_nMinX;
+   sStamp.Y = n_y - m_nMinY;
+   sStamp.Radius = n_radius;
+   sStamp.Amount = f_amount;
+   for(SInt32 r = nX0 / m_nRegionColumns; r <= nX1 / m_nRegionColumns; ++r) {
+      m_vecRegions[r].Stamps.push_back(sStamp);
+   }
+   m_bPendingStamps = true;
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::FlushDeposits() {
+   if(!m_bPendingStamps) return;
+   RunRegions(PHASE_DEPOSIT);
+   for(size_t r = 0; r < m_vecRegions.size(); ++r) {
+      m_fTotal += m_vecRegions[r].Total;
+   }
+   m_bPendingStamps = false;
+   m_bLiveStale = true;
+   RebuildPyramid();
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::ApplyStamps(SRegion& s_region) {
+   s_region.Total = 0.0;
+   for(size_t i = 0; i < s_region.Stamps.size(); ++i) {
+      const SStamp& sStamp = s_region.Stamps[i];
+      /* The part of the stamp in the strip, and in the field */
+      SInt32 nX0 = std::max<SInt32>(sStamp.X - sStamp.Radius, s_region.Begin);
+      SInt32 nX1 = std::min<SInt32>(sStamp.X + sStamp.Radius, s_region.End - 1);
+      SInt32 nY0 = std::max<SInt32>(sStamp.Y - sStamp.Radius, 0);
+      SInt32 nY1 = std::min<SInt32>(sStamp.Y + sStamp.Radius, m_nSizeY - 1);
+      for(SInt32 nY = nY0; nY <= nY1; ++nY) {
+         for(SInt32 nX = nX0; nX <= nX1; ++nX) {
+            UInt32 unIdx = nY * m_nSizeX + nX;
+            if(m_vecCells[unIdx] <= 0.0) {
+               s_region.Active.push_back(unIdx);
+               if(m_bStamped) m_vecDecayStamps[unIdx] = m_fDecayed;
+            }
+            else if(m_bLazy) {
+               BringUpToDate(unIdx);
+            }
+            m_vecCells[unIdx] += sStamp.Amount * m_fInvScale;
+            s_region.Total += sStamp.Amount;
+         }
+      }
+   }
+   s_region.Stamps.clear();
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::Decay(Real f_amount) {
+   FlushDeposits();
+   if(m_eDecay == DECAY_EXPONENTIAL) {
+      /* Only scale the field, until the sweep */
+      m_fScale *= 1.0 - f_amount;
+      m_fInvScale = 1.0 / m_fScale;
+      m_bLiveStale = true;
+      if(++m_unStepsSinceSweep < m_unDecayPeriod &&
+         m_fScale > EXPONENTIAL_MIN_SCALE) return;
+   }
+   else if(m_bStamped) {
+      /* Only count the decay, until the sweep */
+      m_fDecayed += f_amount;
+      m_bLiveStale = true;
+      if(++m_unStepsSinceSweep < m_unDecayPeriod) return;
+   }
+   Sweep(f_amount);
+   RebuildPyramid();
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::Settle() {
+   if(!m_bLazy) return;
+   FlushDeposits();
+   Sweep(0.0);
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::Sweep(Real f_amount) {
+   m_unStepsSinceSweep = 0;
+   if(m_vecRegions.size() == 1) {
+      DecayRegion(m_vecRegions[0], f_amount);
+   }
+   else {
+      m_fPendingDecay = f_amount;
+      RunRegions(PHASE_DECAY);
+   }
+   m_fTotal = 0.0;
+   for(size_t r = 0; r < m_vecRegions.size(); ++r) {
+      m_fTotal += m_vecRegions[r].Total;
+   }
+   /* The scale is folded into the cells */
+   m_fScale = 1.0;
+   m_fInvScale = 1.0;
+   if(m_bLazy) {
+      /* Every listed cell is up to date and holds pheromone */
+      m_fLiveTotal = m_fTotal;
+      m_unLiveCells = 0;
+      for(size_t r = 0; r < m_vecRegions.size(); ++r) {
+         m_unLiveCells += m_vecRegions[r].Active.size();
+      }
+      m_bLiveStale = false;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::RefreshLive() const {
+   if(!m_bLiveStale) return;
+   m_fLiveTotal = 0.0;
+   m_unLiveCells = 0;
+   for(size_t r = 0; r < m_vecRegions.size(); ++r) {
+      const std::vector<UInt32>& vecActive = m_vecRegions[r].Active;
+      for(size_t i = 0; i < vecActive.size(); ++i) {
+         Real fValue = Value(vecActive[i]);
+         if(fValue > 0.0) {
+            m_fLiveTotal += fValue;
+            ++m_unLiveCells;
+         }
+      }
+   }
+   m_bLiveStale = false;
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::DecayRegion(SRegion& s_region, Real f_amount) {
+   /* Decay the active cells, compacting the list of those that survive */
+   std::vector<UInt32>& vecActive = s_region.Active;
+   size_t unKept = 0;
+   s_region.Total = 0.0;
+   for(size_t i = 0; i < vecActive.size(); ++i) {
+      Real& fCell = m_vecCells[vecActive[i]];
+      if(m_eDecay == DECAY_EXPONENTIAL) {
+         /* Fold the scale into the cell */
+         fCell *= m_fScale;
+         if(fCell < m_fThreshold) fCell = 0.0;
+      }
+      else if(m_bStamped) {
+         /* All the decay since the cell was last up to date */
+         fCell -= m_fDecayed - m_vecDecayStamps[vecActive[i]];
+         m_vecDecayStamps[vecActive[i]] = m_fDecayed;
+      }
+      else {
+         fCell -= f_amount;
+      }
+      if(fCell <= 0.0) {
+         fCell = 0.0;
+      }
+      else {
+         vecActive[unKept++] = vecActive[i];
+         s_region.Total += fCell;
+      }
+   }
+   vecActive.resize(unKept);
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::RunRegions(EPhase e_phase) {
+   {
+      std::lock_guard<std::mutex> cLock(m_cMutex);
+      m_ePhase = e_phase;
+      m_unRunning = m_vecRegions.size() - 1;
+      ++m_unGeneration;
+      m_cCondition.notify_all();
+   }
+   if(e_phase == PHASE_DEPOSIT) {
+      ApplyStamps(m_vecRegions[0]);
+   }
+   else {
+      DecayRegion(m_vecRegions[0], m_fPendingDecay);
+   }
+   std::unique_lock<std::mutex> cLock(m_cMutex);
+   m_cCondition.wait(cLock, [this] { return m_unRunning == 0; });
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::RegionWorker(size_t un_region) {
+   UInt64 unDone = 0;
+   std::unique_lock<std::mutex> cLock(m_cMutex);
+   while(true) {
+      m_cCondition.wait(cLock, [this, unDone] { return m_unGeneration != unDone || m_bStopWorker; });
+      if(m_bStopWorker) return;
+      unDone = m_unGeneration;
+      EPhase ePhase = m_ePhase;
+      /* The strip is ours until we report: drop the lock */
+      cLock.unlock();
+      if(ePhase == PHASE_DEPOSIT) {
+         ApplyStamps(m_vecRegions[un_region]);
+      }
+      else {
+         DecayRegion(m_vecRegions[un_region], m_fPendingDecay);
+      }
+      cLock.lock();
+      if(--m_unRunning == 0) {
+         m_cCondition.notify_all();
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::RebuildPyramid() {
+   if(!m_cPyramid.IsEnabled()) return;
+   m_cPyramid.Clear();
+   for(size_t r = 0; r < m_vecRegions.size(); ++r) {
+      m_cPyramid.AddCells(m_vecRegions[r].Active);
+   }
+   m_cPyramid.Propagate();
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::BeginDecay(Real f_amount) {
+   FlushDeposits();
+   m_fPendingDecay = f_amount;
+   if(m_bPipelined) {
+      std::lock_guard<std::mutex> cLock(m_cMutex);
+      m_bDecayRequested = true;
+      m_bDecayDone = false;
+      m_cCondition.notify_all();
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::EndDecay() {
+   if(m_bPipelined) {
+      /* Wait for the worker */
+      {
+         std::unique_lock<std::mutex> cLock(m_cMutex);
+         m_cCondition.wait(cLock, [this] { return m_bDecayDone; });
+         m_bDecayDone = false;
+      }
+      /* Swap the buffers */
+      m_vecCells.swap(m_vecBack);
+      m_vecRegions[0].Active.swap(m_vecBackActive);
+      m_vecStale.swap(m_vecBackStale);
+      m_fTotal = m_fBackTotal;
+      RebuildPyramid();
+   }
+   else {
+      Decay(m_fPendingDecay);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::DecayIntoBack(Real f_amount) {
+   /* Zero what the back buffer still holds of the cells that died in the
+      previous decay; live cells are overwritten below */
+   for(size_t i = 0; i < m_vecStale.size(); ++i) {
+      m_vecBack[m_vecStale[i]] = 0.0;
+   }
+   m_vecBackActive.clear();
+   m_vecBackStale.clear();
+   m_fBackTotal = 0.0;
+   const std::vector<UInt32>& vecActive = m_vecRegions[0].Active;
+   for(size_t i = 0; i < vecActive.size(); ++i) {
+      UInt32 unIdx = vecActive[i];
+      Real fValue = m_vecCells[unIdx] - f_amount;
+      if(fValue <= 0.0) {
+         m_vecBack[unIdx] = 0.0;
+         m_vecBackStale.push_back(unIdx);
+      }
+      else {
+         m_vecBack[unIdx] = fValue;
+         m_vecBackActive.push_back(unIdx);
+         m_fBackTotal += fValue;
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::DecayWorker() {
+   std::unique_lock<std::mutex> cLock(m_cMutex);
+   while(true) {
+      m_cCondition.wait(cLock, [this] { return m_bDecayRequested || m_bStopWorker; });
+      if(m_bStopWorker) return;
+      m_bDecayRequested = false;
+      /* The front buffer is only read while we work: drop the lock */
+      cLock.unlock();
+      DecayIntoBack(m_fPendingDecay);
+      cLock.lock();
+      m_bDecayDone = true;
+      m_cCondition.notify_all();
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::StopWorker() {
+   if(!m_vecWorkers.empty()) {
+      {
+         std::lock_guard<std::mutex> cLock(m_cMutex);
+         m_bStopWorker = true;
+         m_cCondition.notify_all();
+      }
+      for(size_t i = 0; i < m_vecWorkers.size(); ++i) {
+         m_vecWorkers[i].join();
+      }
+      m_vecWorkers.clear();
+   }
+}
+
+/****************************************/
+/****************************************/
+
+size_t CPheromoneField::GetActiveCellCount() const {
+   if(m_bLazy) {
+      RefreshLive();
+      return m_unLiveCells;
+   }
+   size_t unCount = 0;
+   for(size_t r = 0; r < m_vecRegions.size(); ++r) {
+      unCount += m_vecRegions[r].Active.size();
+   }
+   return unCount;
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::GetActiveCell(size_t un_i, SInt32& n_x, SInt32& n_y, Real& f_value) const {
+   /* The cells are numbered strip after strip */
+   size_t r = 0;
+   while(un_i >= m_vecRegions[r].Active.size()) {
+      un_i -= m_vecRegions[r].Active.size();
+      ++r;
+   }
+   UInt32 unIdx = m_vecRegions[r].Active[un_i];
+   n_x = m_nMinX + static_cast<SInt32>(unIdx % m_nSizeX);
+   n_y = m_nMinY + static_cast<SInt32>(unIdx / m_nSizeX);
+   f_value = Value(unIdx);
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::GetCells(std::vector<SCell>& vec_cells) const {
+   vec_cells.clear();
+   for(size_t r = 0; r < m_vecRegions.size(); ++r) {
+      const std::vector<UInt32>& vecActive = m_vecRegions[r].Active;
+      for(size_t i = 0; i < vecActive.size(); ++i) {
+         SCell sCell;
+         sCell.Value = Value(vecActive[i]);
+         if(sCell.Value <= 0.0) continue;
+         sCell.X = m_nMinX + static_cast<SInt32>(vecActive[i] % m_nSizeX);
+         sCell.Y = m_nMinY + static_cast<SInt32>(vecActive[i] / m_nSizeX);
+         vec_cells.push_back(sCell);
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneField::CopyTo(float* pf_out) const {
+   for(size_t i = 0; i < m_vecCells.size(); ++i) {
+      pf_out[i] = Value(i);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+Real CPheromoneField::GetMaxAround(Real f_x, Real f_y, Real f_radius) const {
+   SInt32 nX = ToCell(f_x) - m_nMinX;
+   SInt32 nY = ToCell(f_y) - m_nMinY;
+   SInt32 nRadius = static_cast<SInt32>(std::ceil(f_radius * m_nResolution));
+   return m_cPyramid.GetMax(nX - nRadius, nY - nRadius, nX + nRadius, nY + nRadius);
+}
+
+/****************************************/
+/****************************************/
+
+Real CPheromoneField::GetSumAround(Real f_x, Real f_y, Real f_radius) const {
+   SInt32 nX = ToCell(f_x) - m_nMinX;
+   SInt32 nY = ToCell(f_y) - m_nMinY;
+   SInt32 nRadius = static_cast<SInt32>(std::ceil(f_radius * m_nResolution));
+   return m_cPyramid.GetSum(nX - nRadius, nY - nRadius, nX + nRadius, nY + nRadius);
+}
+
+/****************************************/
+/****************************************/
+
+bool CPheromoneField::AnyWithin(Real f_x, Real f_y, Real f_radius) const {
+   return m_cPyramid.AnyWithin(ToCell(f_x) - m_nMinX,
+                               ToCell(f_y) - m_nMinY,
+                               f_radius * m_nResolution);
+}
@@ -0,0 +1,473 @@
+/*
+ * The pheromone field laid by the foot-bots carrying food.
+ *
+ * The field is a dense grid of cells covering the interior of the arena,
+ * addressed with the same discretized coordinates the loop functions
+ * have always used: round(position * resolution). Alongside the grid, the
+ * field keeps the list of cells holding pheromone, so that decay and
+ * clearing cost is proportional to the trail, not to the arena.
+ * All the memory is allocated in Init(): Clear() just zeroes the active
+ * cells, so back-to-back trials do not touch the allocator.
+ *
+ * Decay is split in BeginDecay() and EndDecay(). In pipelined mode the
+ * field is double-buffered: readers and deposits use the front buffer,
+ * while a worker thread writes the decayed field into the back buffer
+ * between the two calls; EndDecay() waits for it and swaps the buffers.
+ * Otherwise, EndDecay() decays the field in place.
+ *
+ * Optionally, the field maintains a mip pyramid of itself (see
+ * pheromone_pyramid.h), for range queries and for rendering the floor at
+ * a lower density than the field.
+ *
+ * With several threads, the field is split into vertical strips of
+ * columns, each owned by a thread with its own list of active cells.
+ * The stamps laid with DepositStamp() are queued in the strips they
+ * reach (a stamp across a boundary is queued in both, and each strip
+ * clips it to its own columns), and BeginDecay() has every thread apply
+ * the stamps of its strip; EndDecay() has every thread decay its strip.
+ * No cell, list or total is written by two threads, so the threads only
+ * synchronize twice per step. The strips are vertical because the trails
+ * run from the nest to the food along x, so every strip gets its share.
+ * Pipelined decay needs a single thread.
+ *
+ * With a decay period of k steps, the decay is only applied to the cells
+ * every k steps. Each cell keeps the cumulative decay at which its value
+ * was last brought up to date, and a cell is brought up to date whenever
+ * it is read or written: its value is then the stored one minus the decay
+ * since, clamped at zero. Between two deposits a cell only loses the same
+ * amount at each step, so this is exactly the value the per-step decay
+ * gives, including for the cells that run out in between. The sweep every
+ * k steps brings all the active cells up to date and drops those that ran
+ * out. A decay period cannot be combined with pipelined decay nor with the
+ * pyramid, which hold decayed values.
+ *
+ * With exponential decay, each step multiplies the pheromone by one minus
+ * the evaporation rate, and the cells falling below a threshold are
+ * emptied. The cells store their values divided by a global scale, and a
+ * step only multiplies the scale: a cell is worth its stored value times
+ * the scale, or nothing below the threshold. A deposit on a cell below the
+ * threshold starts from zero, so the values do not depend on when the
+ * sweep runs. The sweep, every decay period steps, multiplies the stored
+ * values by the scale, which then goes back to one, and drops the cells
+ * below the threshold. Exponential decay cannot be combined with pipelined
+ * decay nor with the pyramid either.
+ */
+
+#ifndef PHEROMONE_FIELD_H
+#define PHEROMONE_FIELD_H
+
+#include "pheromone_pyramid.h"
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace argos;
+
+class CPheromoneField {
+
+public:
+
+   /* How the pheromone decays at each step */
+   enum EDecay {
+      /* The same amount is subtracted from every cell */
+      DECAY_LINEAR = 0,
+      /* Every cell loses the same fraction */
+      DECAY_EXPONENTIAL
+   };
+
+   /* A cell holding pheromone, with its value */
+   struct SCell {
+      SInt32 X;
+      SInt32 Y;
+      Real Value;
+   };
+
+public:
+
+   CPheromoneField();
+   ~CPheromoneField();
+
+   /*
+    * Allocates a field covering [-f_width/2,f_width/2] x [-f_height/2,f_height/2]
+    * meters, with n_resolution cells per meter and n_margin extra cells on
+    * each side for the deposits of robots touching the walls.
+    * If b_pipelined is true, the back buffer and the decay worker are
+    * created too; if b_pyramid is true, the pyramid is. With un_threads
+    * greater than one, the field is split into as many strips. With
+    * un_decay_period greater than one, the cells are decayed lazily and
+    * swept every un_decay_period steps. With exponential decay, the cells
+    * below f_threshold are emptied.
+    */
+   void Init(Real f_width, Real f_height, SInt32 n_resolution, SInt32 n_margin,
+             bool b_pipelined = false, bool b_pyramid = false, UInt32 un_threads = 1,
+             UInt32 un_decay_period = 1,
+             EDecay e_decay = DECAY_LINEAR, Real f_threshold = 0.0);
+
+   /*
+    * Removes all the pheromone, keeping the memory.
+    */
+   void Clear();
+
+   /*
+    * Returns the pheromone at the given cell, zero outside the field.
+    */
+   inline Real Get(SInt32 n_x, SInt32 n_y) const {
+      if(!Contains(n_x, n_y)) return 0.0;
+      return Value(Index(n_x, n_y));
+   }
+
+   /*
+    * Adds pheromone to the given cell. Deposits outside the field are
+    * dropped.
+    */
+   inline void Deposit(SInt32 n_x, SInt32 n_y, Real f_amount) {
+      if(!Contains(n_x, n_y)) return;
+      UInt32 unIdx = Index(n_x, n_y);
+      if(m_vecCells[unIdx] <= 0.0) {
+         m_vecRegions[(n_x - m_nMinX) / m_nRegionColumns].Active.push_back(unIdx);
+         if(m_bStamped) m_vecDecayStamps[unIdx] = m_fDecayed;
+      }
+      else if(m_bLazy) {
+         BringUpToDate(unIdx);
+      }
+      m_vecCells[unIdx] += f_amount * m_fInvScale;
+      m_fTotal += f_amount;
+      m_bLiveStale = true;
+      if(m_cPyramid.IsEnabled()) {
+         m_cPyramid.Deposit(n_x - m_nMinX, n_y - m_nMinY, m_vecCells[unIdx], f_amount);
+      }
+   }
+
+   /*
+    * Adds f_amount to the square of cells within n_radius of the given
+    * cell. With a single thread, the cells are written right away; with
+    * several, the stamp is queued until FlushDeposits().
+    */
+   void DepositStamp(SInt32 n_x, SInt32 n_y, SInt32 n_radius, Real f_amount);
+
+   /*
+    * Applies the queued stamps, each thread in its strip.
+    */
+   void FlushDeposits();
+
+   /*
+    * Subtracts f_amount from every cell, or with exponential decay,
+    * multiplies every cell by 1 - f_amount; cells reaching zero, or the
+    * threshold, are removed.
+    */
+   void Decay(Real f_amount);
+
+   /*
+    * Starts decaying the field by f_amount, or with exponential decay, by
+    * the fraction f_amount of the pheromone. Must be called once the
+    * deposits of the tick are done, and applies the queued stamps; until
+    * EndDecay(), the field can be read but not modified.
+    */
+   void BeginDecay(Real f_amount);
+
+   /*
+    * Completes the decay started by BeginDecay(). Afterwards, the field
+    * holds the same values Decay() would have produced.
+    */
+   void EndDecay();
+
+   /*
+    * With a decay period or exponential decay, brings every cell up to date
+    * and drops those that ran out, as the sweep does. Must not be called between
+    * BeginDecay() and EndDecay().
+    */
+   void Settle();
+
+   /*
+    * Returns the number of cells holding pheromone.
+    */
+   size_t GetActiveCellCount() const;
+
+   /*
+    * Returns the coordinates and value of the i-th cell holding pheromone.
+    * With a decay period or exponential decay, Settle() must be called
+    * first, so that the cells that ran out since the last sweep are not
+    * listed.
+    */
+   void GetActiveCell(size_t un_i, SInt32& n_x, SInt32& n_y, Real& f_value) const;
+
+   /*
+    * Lists the cells holding pheromone, without the need for Settle():
+    * the cells that ran out since the last sweep are skipped.
+    */
+   void GetCells(std::vector<SCell>& vec_cells) const;
+
+   /*
+    * Returns the total pheromone in the field. It is summed again at every
+    * decay, so rounding errors do not pile up. With a decay period or
+    * exponential decay, it is summed from the up-to-date cells when it is
+    * asked for.
+    */
+   inline Real GetTotal() const {
+      if(m_bLazy) {
+         RefreshLive();
+         return m_fLiveTotal;
+      }
+      return m_fTotal;
+   }
+
+   /*
+    * Returns the number of steps between two sweeps of the decay.
+    */
+   inline UInt32 GetDecayPeriod() const {
+      return m_unDecayPeriod;
+   }
+
+   /*
+    * Returns how the pheromone decays.
+    */
+   inline EDecay GetDecay() const {
+      return m_eDecay;
+   }
+
+   /*
+    * Returns the number of cells per meter.
+    */
+   inline SInt32 GetResolution() const {
+      return m_nResolution;
+   }
+
+   /*
+    * Returns the cell coordinates of the lower-left corner of the grid, and
+    * its size in cells.
+    */
+   inline void GetExtent(SInt32& n_min_x, SInt32& n_min_y,
+                         SInt32& n_size_x, SInt32& n_size_y) const {
+      n_min_x = m_nMinX;
+      n_min_y = m_nMinY;
+      n_size_x = m_nSizeX;
+      n_size_y = m_nSizeY;
+   }
+
+   /*
+    * Copies the whole grid, row-major, into a preallocated buffer of
+    * size_x * size_y values.
+    */
+   void CopyTo(float* pf_out) const;
+
+   /*
+    * Returns true if the field maintains its pyramid.
+    */
+   inline bool HasPyramid() const {
+      return m_cPyramid.IsEnabled();
+   }
+
+   /*
+    * Returns the number of pyramid levels, the field included.
+    */
+   inline UInt32 GetPyramidLevels() const {
+      return m_cPyramid.GetLevels();
+   }
+
+   /*
+    * Returns the largest value in the pyramid block of the given level
+    * containing the given cell. Level 0 is the cell itself.
+    */
+   inline Real GetBlockMax(SInt32 n_x, SInt32 n_y, UInt32 un_level) const {
+      return m_cPyramid.GetBlockMax(n_x - m_nMinX, n_y - m_nMinY, un_level);
+   }
+
+   /*
+    * Returns the largest value, or the total pheromone, around the given
+    * point in meters, in O(log n) from the pyramid: the cells read cover
+    * the square of side 2*f_radius centered on the point, and at most
+    * twice as much along each axis. GetSumAround() is thus the sum over
+    * the covering blocks, not over the exact disc. These queries need the
+    * pyramid.
+    */
+   Real GetMaxAround(Real f_x, Real f_y, Real f_radius) const;
+   Real GetSumAround(Real f_x, Real f_y, Real f_radius) const;
+
+   /*
+    * Returns true if any cell within f_radius meters of the given point
+    * holds pheromone.
+    */
+   bool AnyWithin(Real f_x, Real f_y, Real f_radius) const;
+
+   /*
+    * Converts a coordinate in meters into a cell coordinate.
+    */
+   inline SInt32 ToCell(Real f_coord) const {
+      return static_cast<SInt32>(std::round(f_coord * m_nResolution));
+   }
+
+   /*
+    * Returns the number of strips the field is split into.
+    */
+   inline size_t GetRegionCount() const {
+      return m_vecRegions.size();
+   }
+
+private:
+
+   /* A square stamp, in cells from the lower-left corner */
+   struct SStamp {
+      SInt32 X;
+      SInt32 Y;
+      SInt32 Radius;
+      Real Amount;
+   };
+
+   /* A strip of columns and what its thread owns */
+   struct SRegion {
+      /* Columns [Begin,End), from the lower-left corner */
+      SInt32 Begin;
+      SInt32 End;
+      /* Indices of the cells of the strip holding pheromone */
+      std::vector<UInt32> Active;
+      /* Stamps waiting for FlushDeposits() */
+      std::vector<SStamp> Stamps;
+      /* Pheromone deposited by the last flush, or left by the last decay */
+      Real Total;
+   };
+
+   /* Work the strip threads are asked to do */
+   enum EPhase {
+      PHASE_DEPOSIT = 0,
+      PHASE_DECAY
+   };
+
+   inline bool Contains(SInt32 n_x, SInt32 n_y) const {
+      return n_x >= m_nMinX && n_x < m_nMinX + m_nSizeX &&
+             n_y >= m_nMinY && n_y < m_nMinY + m_nSizeY;
+   }
+
+   inline UInt32 Index(SInt32 n_x, SInt32 n_y) const {
+      return (n_y - m_nMinY) * m_nSizeX + (n_x - m_nMinX);
+   }
+
+   /* The up-to-date value of a cell */
+   inline Real Value(UInt32 un_idx) const {
+      Real fValue = m_vecCells[un_idx];
+      if(!m_bLazy || fValue <= 0.0) return fValue;
+      if(m_eDecay == DECAY_EXPONENTIAL) {
+         fValue *= m_fScale;
+         return fValue < m_fThreshold ? 0.0 : fValue;
+      }
+      fValue -= m_fDecayed - m_vecDecayStamps[un_idx];
+      return fValue > 0.0 ? fValue : 0.0;
+   }
+
+   /* Before a deposit on an active cell: stores its up-to-date value, or
+      with exponential decay, empties it if it is below the threshold */
+   inline void BringUpToDate(UInt32 un_idx) {
+      Real& fCell = m_vecCells[un_idx];
+      if(m_eDecay == DECAY_EXPONENTIAL) {
+         if(fCell * m_fScale < m_fThreshold) fCell = 0.0;
+         return;
+      }
+      fCell -= m_fDecayed - m_vecDecayStamps[un_idx];
+      if(fCell < 0.0) fCell = 0.0;
+      m_vecDecayStamps[un_idx] = m_fDecayed;
+   }
+
+   /* With lazy decay, sums the up-to-date cells and counts those
+      holding pheromone, if a deposit or a decay happened since */
+   void RefreshLive() const;
+
+   /* Decays the strips and sums their totals */
+   void Sweep(Real f_amount);
+
+   /* Writes the decayed front buffer into the back buffer */
+   void DecayIntoBack(Real f_amount);
+
+   /* Body of the decay worker thread */
+   void DecayWorker();
+
+   /* Applies the queued stamps of a strip */
+   void ApplyStamps(SRegion& s_region);
+
+   /* Decays the cells of a strip, compacting its list */
+   void DecayRegion(SRegion& s_region, Real f_amount);
+
+   /* Runs a phase on every strip, the first one on the calling thread,
+      and waits for them */
+   void RunRegions(EPhase e_phase);
+
+   /* Body of the thread of the given strip */
+   void RegionWorker(size_t un_region);
+
+   /* Rebuilds the pyramid from the active cells of every strip */
+   void RebuildPyramid();
+
+   /* Stops the worker threads, if any */
+   void StopWorker();
+
+private:
+
+   /* Cells per meter */
+   SInt32 m_nResolution;
+   /* Cell coordinates of the lower-left corner */
+   SInt32 m_nMinX, m_nMinY;
+   /* Number of cells along each axis */
+   SInt32 m_nSizeX, m_nSizeY;
+   /* Pheromone per cell, row-major */
+   std::vector<Real> m_vecCells;
+   /* The strips, a single one without threads, and their width */
+   std::vector<SRegion> m_vecRegions;
+   SInt32 m_nRegionColumns;
+   /* True if stamps are queued */
+   bool m_bPendingStamps;
+   /* Total pheromone in the field */
+   Real m_fTotal;
+   /* Mip pyramid, if enabled */
+   CPheromonePyramid m_cPyramid;
+
+   /* Lazy decay: steps between two sweeps, and steps since the last one */
+   UInt32 m_unDecayPeriod;
+   UInt32 m_unStepsSinceSweep;
+   /* True if the cells are read through Value() rather than as stored,
+      and if they keep decay stamps, with linear decay and a period */
+   bool m_bLazy;
+   bool m_bStamped;
+   /* Exponential decay: the scale of the stored values, its inverse, and
+      the value below which a cell is empty */
+   EDecay m_eDecay;
+   Real m_fScale;
+   Real m_fInvScale;
+   Real m_fThreshold;
+   /* Decay applied since the field was cleared */
+   Real m_fDecayed;
+   /* For each cell, the value of m_fDecayed its value is up to date with */
+   std::vector<Real> m_vecDecayStamps;
+   /* The total and the number of cells holding pheromone, up to date */
+   mutable bool m_bLiveStale;
+   mutable Real m_fLiveTotal;
+   mutable size_t m_unLiveCells;
+
+   /* Pipelined decay */
+   bool m_bPipelined;
+   /* Amount of the decay between BeginDecay() and EndDecay() */
+   Real m_fPendingDecay;
+   /* The back buffer, and the active cells it will hold after the swap */
+   std::vector<Real> m_vecBack;
+   std::vector<UInt32> m_vecBackActive;
+   Real m_fBackTotal;
+   /* Cells that died in the last decay: the back buffer still holds their
+      old value, which must be zeroed before it is written again */
+   std::vector<UInt32> m_vecStale;
+   std::vector<UInt32> m_vecBackStale;
+   /* Worker threads: the decay worker, or the threads of the strips but
+      the first, and their handshake */
+   std::vector<std::thread> m_vecWorkers;
+   std::mutex m_cMutex;
+   std::condition_variable m_cCondition;
+   bool m_bDecayRequested;
+   bool m_bDecayDone;
+   bool m_bStopWorker;
+   /* Strip phase: bumped to start one, with the threads still running */
+   EPhase m_ePhase;
+   UInt64 m_unGeneration;
+   size_t m_unRunning;
+
+};
+
+#endif
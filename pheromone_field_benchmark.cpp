@@ -0,0 +1,177 @@
+/*
+ * Strong-scaling benchmark of the pheromone field split into strips.
+ *
+ * Lays the trail of a swarm of carrying robots walking at random on a
+ * fixed field, and times the deposits and the decay of each step for an
+ * increasing number of threads. The walks are the same for every thread
+ * count, and so is the resulting field: the total pheromone is printed as
+ * a check. The time of a step is also split between the deposits (the
+ * stamps and their flush) and the decay. With -k, the decay is swept every
+ * k steps instead (see pheromone_field.h), and the total is the same; the
+ * decay time shows the work saved. With -e, the pheromone
+ * evaporates by that fraction at each step instead, and cells below 1
+ * are emptied.
+ *
+ * The defaults are a 20x20 m field at 50 cells per meter, with 2000
+ * robots laying stamps of radius 2, intensity 90 and dissipation 1.
+ *
+ * Example:
+ *
+ *    pheromone_field_benchmark -t 8 -s 1000
+ *    pheromone_field_benchmark -t 1 -k 1
+ *    pheromone_field_benchmark -t 1 -k 10
+ *    pheromone_field_benchmark -t 1 -e 0.01 -k 10
+ */
+
+#include "pheromone_field.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unistd.h>
+
+/****************************************/
+/****************************************/
+
+static void PrintUsage(const char* pch_name) {
+   std::cerr << "Usage: " << pch_name << " [-t <max threads>] [-s <steps>] [-w <warm-up steps>]" << std::endl
+             << "          [-r <robots>] [-a <arena side>] [-c <cells per meter>] [-k <decay period>]" << std::endl
+             << "          [-e <evaporation>]" << std::endl;
+}
+
+/****************************************/
+/****************************************/
+
+/*
+ * Runs the benchmark with the given number of threads; returns the
+ * average time of a step in milliseconds, and the part of it spent
+ * decaying the field.
+ */
+static Real Run(UInt32 un_threads, UInt32 un_robots, Real f_side, SInt32 n_resolution,
+                UInt32 un_decay_period, Real f_evaporation,
+                UInt32 un_warmup, UInt32 un_steps, Real& f_decay, Real& f_total) {
+   const SInt32 nRadius = 2;
+   const Real fIntensity = 90.0;
+   const Real fDissipation = 1.0;
+   /* A foot-bot at full speed moves about 1 cm per step */
+   const Real fStep = 0.01;
+   CPheromoneField cField;
+   if(f_evaporation > 0.0) {
+      cField.Init(f_side, f_side, n_resolution, nRadius, false, false, un_threads, un_decay_period,
+                  CPheromoneField::DECAY_EXPONENTIAL, 1.0);
+   }
+   else {
+      cField.Init(f_side, f_side, n_resolution, nRadius, false, false, un_threads, un_decay_period);
+   }
+   std::mt19937 cRNG(42);
+   std::uniform_real_distribution<Real> cPosition(-0.5 * f_side, 0.5 * f_side);
+   std::uniform_real_distribution<Real> cTurn(-0.3, 0.3);
+   std::vector<Real> vecX(un_robots), vecY(un_robots), vecHeading(un_robots);
+   for(UInt32 i = 0; i < un_robots; ++i) {
+      vecX[i] = cPosition(cRNG);
+      vecY[i] = cPosition(cRNG);
+      vecHeading[i] = cTurn(cRNG) * 20.0;
+   }
+   std::chrono::steady_clock::duration cElapsed(0), cDecay(0);
+   for(UInt32 t = 0; t < un_warmup + un_steps; ++t) {
+      /* Move the robots, bouncing on the walls; not timed */
+      for(UInt32 i = 0; i < un_robots; ++i) {
+         vecHeading[i] += cTurn(cRNG);
+         Real fX = vecX[i] + fStep * std::cos(vecHeading[i]);
+         Real fY = vecY[i] + fStep * std::sin(vecHeading[i]);
+         if(std::abs(fX) > 0.5 * f_side || std::abs(fY) > 0.5 * f_side) {
+            vecHeading[i] += 3.14159265358979;
+         }
+         else {
+            vecX[i] = fX;
+            vecY[i] = fY;
+         }
+      }
+      /* What the loop functions do in a step */
+      std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+      for(UInt32 i = 0; i < un_robots; ++i) {
+         cField.DepositStamp(cField.ToCell(vecX[i]), cField.ToCell(vecY[i]), nRadius, fIntensity);
+      }
+      /* BeginDecay() flushes the stamps: it counts as deposits */
+      cField.BeginDecay(f_evaporation > 0.0 ? f_evaporation : fDissipation);
+      std::chrono::steady_clock::time_point tDecay = std::chrono::steady_clock::now();
+      cField.EndDecay();
+      if(t >= un_warmup) {
+         std::chrono::steady_clock::time_point tEnd = std::chrono::steady_clock::now();
+         cElapsed += tEnd - tStart;
+         cDecay += tEnd - tDecay;
+      }
+   }
+   f_total = cField.GetTotal();
+   f_decay = std::chrono::duration<Real, std::milli>(cDecay).count() / un_steps;
+   return std::chrono::duration<Real, std::milli>(cElapsed).count() / un_steps;
+}
+
+/****************************************/
+/****************************************/
+
+int main(int argc, char** argv) {
+   UInt32 unMaxThreads = std::max(1u, std::thread::hardware_concurrency());
+   UInt32 unSteps = 500;
+   UInt32 unWarmup = 200;
+   UInt32 unRobots = 2000;
+   Real fSide = 20.0;
+   SInt32 nResolution = 50;
+   UInt32 unDecayPeriod = 1;
+   Real fEvaporation = 0.0;
+   int nOpt;
+   while((nOpt = getopt(argc, argv, "t:s:w:r:a:c:k:e:h")) != -1) {
+      switch(nOpt) {
+         case 't': unMaxThreads = std::strtoul(optarg, NULL, 10); break;
+         case 's': unSteps = std::strtoul(optarg, NULL, 10); break;
+         case 'w': unWarmup = std::strtoul(optarg, NULL, 10); break;
+         case 'r': unRobots = std::strtoul(optarg, NULL, 10); break;
+         case 'a': fSide = std::atof(optarg); break;
+         case 'c': nResolution = std::strtol(optarg, NULL, 10); break;
+         case 'k': unDecayPeriod = std::strtoul(optarg, NULL, 10); break;
+         case 'e': fEvaporation = std::atof(optarg); break;
+         default: PrintUsage(argv[0]); return 1;
+      }
+   }
+   if(unMaxThreads == 0 || unSteps == 0 || fSide <= 0.0 || nResolution <= 0 || unDecayPeriod == 0 ||
+      fEvaporation < 0.0 || fEvaporation >= 1.0) {
+      PrintUsage(argv[0]);
+      return 1;
+   }
+   try {
+      std::cout << "# " << fSide << "x" << fSide << " m, " << nResolution << " cells/m, "
+                << unRobots << " robots, decay every " << unDecayPeriod << " steps, "
+                << unSteps << " steps after " << unWarmup << " warm-up steps" << std::endl
+                << "# threads\tms_per_step\tdeposit_ms\tdecay_ms\tspeedup\tefficiency\ttotal" << std::endl;
+      /* 1, 2, 4, ... and the maximum */
+      std::vector<UInt32> vecThreads;
+      for(UInt32 unThreads = 1; unThreads < unMaxThreads; unThreads *= 2) {
+         vecThreads.push_back(unThreads);
+      }
+      vecThreads.push_back(unMaxThreads);
+      Real fBaseline = 0.0;
+      for(size_t i = 0; i < vecThreads.size(); ++i) {
+         UInt32 unThreads = vecThreads[i];
+         Real fDecay, fTotal;
+         Real fTime = Run(unThreads, unRobots, fSide, nResolution, unDecayPeriod, fEvaporation,
+                           unWarmup, unSteps, fDecay, fTotal);
+         if(unThreads == 1) fBaseline = fTime;
+         std::cout << unThreads << "\t"
+                   << std::fixed << std::setprecision(3) << fTime << "\t"
+                   << fTime - fDecay << "\t"
+                   << fDecay << "\t"
+                   << fBaseline / fTime << "\t"
+                   << fBaseline / fTime / unThreads << "\t"
+                   << std::setprecision(1) << fTotal << std::endl;
+      }
+   }
+   catch(CARGoSException& ex) {
+      std::cerr << ex.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * Decoder of the pheromone field time series (see
+ * pheromone_frames_exporter.h).
+ *
+ * Without -t or -a, lists the frames of the file. With -t, rebuilds the
+ * frame of the given step and writes it as a PGM image; with -a, writes
+ * every frame, as <prefix>_<trial>_<step>.pgm.
+ *
+ * Example:
+ *
+ *    pheromone_frames -f pheromones.bin -r 0 -t 5000 -o frame.pgm
+ *    pheromone_frames -f pheromones.bin -a -o frames/pheromones -m 90
+ */
+
+#include "pheromone_frames_reader.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace argos;
+
+/****************************************/
+/****************************************/
+
+static void PrintUsage(const char* pch_name) {
+   std::cerr << "Usage: " << pch_name << " -f <frames file> [-r <trial> -t <step> | -a]" << std::endl
+             << "          [-o <output .pgm or prefix>] [-m <white level>]" << std::endl;
+}
+
+/****************************************/
+/****************************************/
+
+int main(int argc, char** argv) {
+   std::string strFile;
+   std::string strOutput = "pheromones";
+   UInt32 unTrial = 0;
+   SInt64 nTick = -1;
+   bool bAll = false;
+   Real fMax = 0.0;
+   int nOpt;
+   while((nOpt = getopt(argc, argv, "f:r:t:ao:m:h")) != -1) {
+      switch(nOpt) {
+         case 'f': strFile = optarg; break;
+         case 'r': unTrial = std::strtoul(optarg, NULL, 10); break;
+         case 't': nTick = std::strtoul(optarg, NULL, 10); break;
+         case 'a': bAll = true; break;
+         case 'o': strOutput = optarg; break;
+         case 'm': fMax = std::atof(optarg); break;
+         default: PrintUsage(argv[0]); return 1;
+      }
+   }
+   if(strFile.empty()) {
+      PrintUsage(argv[0]);
+      return 1;
+   }
+   try {
+      CPheromoneFramesReader cReader;
+      cReader.Open(strFile);
+      const std::vector<SPheromoneFrameIndexEntry>& vecIndex = cReader.GetIndex();
+      if(bAll) {
+         /* Every frame, decoding each once */
+         for(size_t i = 0; i < vecIndex.size(); ++i) {
+            std::ostringstream cName;
+            cName << strOutput << "_" << vecIndex[i].Trial << "_" << vecIndex[i].Tick << ".pgm";
+            cReader.WritePGM(cName.str(), cReader.Read(i), fMax);
+         }
+         std::cout << vecIndex.size() << " frames written" << std::endl;
+      }
+      else if(nTick >= 0) {
+         /* One frame */
+         SInt64 nFrame = cReader.Find(unTrial, nTick);
+         if(nFrame < 0) {
+            std::cerr << "No frame at step " << nTick << " of trial " << unTrial << std::endl;
+            return 1;
+         }
+         if(strOutput.size() < 4 || strOutput.compare(strOutput.size() - 4, 4, ".pgm") != 0) {
+            strOutput += ".pgm";
+         }
+         cReader.WritePGM(strOutput, cReader.Read(nFrame), fMax);
+      }
+      else {
+         /* List the frames */
+         SInt32 nMinX, nMinY, nSizeX, nSizeY, nResolution;
+         cReader.GetExtent(nMinX, nMinY, nSizeX, nSizeY, nResolution);
+         std::cout << "# " << nSizeX << "x" << nSizeY << " cells from ("
+                   << nMinX << "," << nMinY << "), " << nResolution << " cells/m, "
+                   << vecIndex.size() << " frames" << std::endl
+                   << "# trial\tstep\tkeyframe\toffset" << std::endl;
+         for(size_t i = 0; i < vecIndex.size(); ++i) {
+            std::cout << vecIndex[i].Trial << "\t"
+                      << vecIndex[i].Tick << "\t"
+                      << ((vecIndex[i].Flags & PHEROMONE_FRAME_KEYFRAME) ? 1 : 0) << "\t"
+                      << vecIndex[i].Offset << std::endl;
+         }
+      }
+   }
+   catch(CARGoSException& ex) {
+      std::cerr << ex.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,222 @@
+#include "pheromone_frames_exporter.h"
+#include "foraging_checkpoint.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <cstring>
+#include <zlib.h>
+
+/* Number of frame buffers: how far the worker may fall behind */
+static const size_t PHEROMONE_FRAMES_POOL = 4;
+
+/****************************************/
+/****************************************/
+
+CPheromoneFramesExporter::CPheromoneFramesExporter() :
+   m_unKeyframeInterval(50),
+   m_unCells(0),
+   m_bStop(false),
+   m_unPreviousTrial(0),
+   m_unSinceKeyframe(0) {}
+
+/****************************************/
+/****************************************/
+
+CPheromoneFramesExporter::~CPheromoneFramesExporter() {
+   if(IsEnabled()) {
+      /* Never throw from here: errors were reported by Submit() */
+      try {
+         Close();
+      }
+      catch(CARGoSException&) {}
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneFramesExporter::Open(const std::string& str_file,
+                                    const CPheromoneField& c_field,
+                                    UInt32 un_keyframe_interval) {
+   Close();
+   if(un_keyframe_interval == 0) {
+      THROW_ARGOSEXCEPTION("The pheromone keyframe interval must be positive");
+   }
+   m_cFile.open(str_file.c_str(), std::ios_base::binary | std::ios_base::trunc | std::ios_base::out);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Cannot open pheromone frames file \"" << str_file << "\" for writing");
+   }
+   SInt32 nMinX, nMinY, nSizeX, nSizeY;
+   c_field.GetExtent(nMinX, nMinY, nSizeX, nSizeY);
+   CheckpointWrite(m_cFile, PHEROMONE_FRAMES_MAGIC);
+   CheckpointWrite(m_cFile, PHEROMONE_FRAMES_VERSION);
+   CheckpointWrite(m_cFile, nMinX);
+   CheckpointWrite(m_cFile, nMinY);
+   CheckpointWrite(m_cFile, nSizeX);
+   CheckpointWrite(m_cFile, nSizeY);
+   CheckpointWrite(m_cFile, c_field.GetResolution());
+   CheckpointWrite(m_cFile, un_keyframe_interval);
+   m_unKeyframeInterval = un_keyframe_interval;
+   m_unCells = nSizeX * nSizeY;
+   /* Allocate everything now */
+   m_vecPool.resize(PHEROMONE_FRAMES_POOL);
+   m_vecFree.clear();
+   m_deqPending.clear();
+   for(size_t i = 0; i < m_vecPool.size(); ++i) {
+      m_vecPool[i].Cells.resize(m_unCells);
+      m_vecFree.push_back(&m_vecPool[i]);
+   }
+   m_vecPrevious.assign(m_unCells, 0);
+   m_vecRuns.reserve(m_unCells * sizeof(UInt32));
+   m_vecCompressed.reserve(compressBound(m_unCells * sizeof(UInt32)));
+   m_vecIndex.clear();
+   m_unSinceKeyframe = 0;
+   m_strError.clear();
+   m_bStop = false;
+   m_cWorker = std::thread(&CPheromoneFramesExporter::Worker, this);
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneFramesExporter::Close() {
+   if(!IsEnabled()) return;
+   /* Let the worker drain the queue */
+   {
+      std::lock_guard<std::mutex> cLock(m_cMutex);
+      m_bStop = true;
+      m_cCondition.notify_all();
+   }
+   m_cWorker.join();
+   /* Index and trailer */
+   UInt64 unIndexOffset = m_cFile.tellp();
+   for(size_t i = 0; i < m_vecIndex.size(); ++i) {
+      CheckpointWrite(m_cFile, m_vecIndex[i]);
+   }
+   CheckpointWrite(m_cFile, unIndexOffset);
+   CheckpointWrite<UInt32>(m_cFile, m_vecIndex.size());
+   CheckpointWrite(m_cFile, PHEROMONE_FRAMES_INDEX_MAGIC);
+   m_cFile.close();
+   if(!m_strError.empty()) {
+      THROW_ARGOSEXCEPTION(m_strError);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneFramesExporter::Submit(UInt32 un_trial, UInt32 un_tick, const CPheromoneField& c_field) {
+   SFrame* psFrame;
+   {
+      std::unique_lock<std::mutex> cLock(m_cMutex);
+      if(!m_strError.empty()) {
+         THROW_ARGOSEXCEPTION(m_strError);
+      }
+      m_cCondition.wait(cLock, [this] { return !m_vecFree.empty(); });
+      psFrame = m_vecFree.back();
+      m_vecFree.pop_back();
+   }
+   /* The copy is the only work done on the simulation thread */
+   psFrame->Trial = un_trial;
+   psFrame->Tick = un_tick;
+   c_field.CopyTo(&psFrame->Cells[0]);
+   {
+      std::lock_guard<std::mutex> cLock(m_cMutex);
+      m_deqPending.push_back(psFrame);
+      m_cCondition.notify_all();
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneFramesExporter::Worker() {
+   std::unique_lock<std::mutex> cLock(m_cMutex);
+   while(true) {
+      m_cCondition.wait(cLock, [this] { return !m_deqPending.empty() || m_bStop; });
+      if(m_deqPending.empty()) return;
+      SFrame* psFrame = m_deqPending.front();
+      m_deqPending.pop_front();
+      /* After an error, the frames are just recycled */
+      bool bFailed = !m_strError.empty();
+      cLock.unlock();
+      std::string strError;
+      if(!bFailed) {
+         strError = Encode(*psFrame);
+      }
+      cLock.lock();
+      if(!strError.empty()) {
+         m_strError = strError;
+      }
+      m_vecFree.push_back(psFrame);
+      m_cCondition.notify_all();
+   }
+}
+
+/****************************************/
+/****************************************/
+
+std::string CPheromoneFramesExporter::Encode(const SFrame& s_frame) {
+   /* A keyframe at the start of each trial and at the interval */
+   bool bKeyframe = m_vecIndex.empty() ||
+                    s_frame.Trial != m_unPreviousTrial ||
+                    m_unSinceKeyframe >= m_unKeyframeInterval;
+   if(bKeyframe) {
+      std::fill(m_vecPrevious.begin(), m_vecPrevious.end(), 0);
+      m_unSinceKeyframe = 0;
+   }
+   ++m_unSinceKeyframe;
+   m_unPreviousTrial = s_frame.Trial;
+   /* XOR with the previous frame and code the runs */
+   m_vecRuns.clear();
+   size_t i = 0;
+   while(i < m_unCells) {
+      UInt32 unZeros = 0;
+      UInt32 unWord;
+      for(; i < m_unCells; ++i) {
+         ::memcpy(&unWord, &s_frame.Cells[i], sizeof(UInt32));
+         if(unWord != m_vecPrevious[i]) break;
+         ++unZeros;
+      }
+      size_t unLiteralStart = i;
+      for(; i < m_unCells; ++i) {
+         ::memcpy(&unWord, &s_frame.Cells[i], sizeof(UInt32));
+         if(unWord == m_vecPrevious[i]) break;
+      }
+      PheromoneFramesPutVarint(m_vecRuns, unZeros);
+      PheromoneFramesPutVarint(m_vecRuns, i - unLiteralStart);
+      for(size_t j = unLiteralStart; j < i; ++j) {
+         ::memcpy(&unWord, &s_frame.Cells[j], sizeof(UInt32));
+         UInt32 unDelta = unWord ^ m_vecPrevious[j];
+         const UInt8* punBytes = reinterpret_cast<const UInt8*>(&unDelta);
+         m_vecRuns.insert(m_vecRuns.end(), punBytes, punBytes + sizeof(UInt32));
+         m_vecPrevious[j] = unWord;
+      }
+   }
+   /* Deflate the runs */
+   uLongf unCompressed = compressBound(m_vecRuns.size());
+   m_vecCompressed.resize(unCompressed);
+   if(compress2(&m_vecCompressed[0], &unCompressed,
+                &m_vecRuns[0], m_vecRuns.size(),
+                Z_DEFAULT_COMPRESSION) != Z_OK) {
+      return "Cannot compress a pheromone frame";
+   }
+   /* Write the frame and remember where it is */
+   SPheromoneFrameHeader sHeader;
+   sHeader.Trial = s_frame.Trial;
+   sHeader.Tick = s_frame.Tick;
+   sHeader.Flags = bKeyframe ? PHEROMONE_FRAME_KEYFRAME : 0;
+   sHeader.RawSize = m_vecRuns.size();
+   sHeader.CompressedSize = unCompressed;
+   SPheromoneFrameIndexEntry sEntry;
+   sEntry.Trial = sHeader.Trial;
+   sEntry.Tick = sHeader.Tick;
+   sEntry.Flags = sHeader.Flags;
+   sEntry.Padding = 0;
+   sEntry.Offset = m_cFile.tellp();
+   CheckpointWrite(m_cFile, sHeader);
+   m_cFile.write(reinterpret_cast<const char*>(&m_vecCompressed[0]), unCompressed);
+   if(!m_cFile) {
+      return "Error writing the pheromone frames file";
+   }
+   m_vecIndex.push_back(sEntry);
+   return "";
+}
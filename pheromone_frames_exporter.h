@@ -0,0 +1,99 @@
+/*
+ * Exporter of the pheromone field time series.
+ *
+ * The simulation thread only copies the grid into a free frame buffer
+ * (Submit()); a worker thread XORs it with the previous frame, run-length
+ * codes it, deflates it and writes it, so encoding overlaps the following
+ * steps. The buffers are allocated once: when the worker falls behind by
+ * more than the pool, Submit() waits for it rather than dropping frames,
+ * since every frame is coded against the previous one.
+ * See pheromone_frames_format.h for the file layout.
+ */
+
+#ifndef PHEROMONE_FRAMES_EXPORTER_H
+#define PHEROMONE_FRAMES_EXPORTER_H
+
+#include "pheromone_frames_format.h"
+#include "pheromone_field.h"
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class CPheromoneFramesExporter {
+
+public:
+
+   CPheromoneFramesExporter();
+   ~CPheromoneFramesExporter();
+
+   /*
+    * Opens the file, writes the header and starts the worker.
+    */
+   void Open(const std::string& str_file,
+             const CPheromoneField& c_field,
+             UInt32 un_keyframe_interval);
+
+   /*
+    * Waits for the pending frames, writes the index and closes the file.
+    */
+   void Close();
+
+   /*
+    * Returns true if the exporter is open.
+    */
+   inline bool IsEnabled() const {
+      return m_cWorker.joinable();
+   }
+
+   /*
+    * Queues a snapshot of the field for the given step.
+    */
+   void Submit(UInt32 un_trial, UInt32 un_tick, const CPheromoneField& c_field);
+
+private:
+
+   /* A snapshot waiting to be encoded */
+   struct SFrame {
+      UInt32 Trial;
+      UInt32 Tick;
+      std::vector<float> Cells;
+   };
+
+   /* Body of the worker thread */
+   void Worker();
+
+   /* Encodes and writes a frame; returns an error message, or an empty
+      string */
+   std::string Encode(const SFrame& s_frame);
+
+private:
+
+   std::ofstream m_cFile;
+   UInt32 m_unKeyframeInterval;
+   size_t m_unCells;
+
+   /* Frame buffers: free ones, and those waiting for the worker */
+   std::vector<SFrame*> m_vecFree;
+   std::deque<SFrame*> m_deqPending;
+   std::vector<SFrame> m_vecPool;
+   std::thread m_cWorker;
+   std::mutex m_cMutex;
+   std::condition_variable m_cCondition;
+   bool m_bStop;
+
+   /* Encoder state, only touched by the worker */
+   std::vector<UInt32> m_vecPrevious;
+   UInt32 m_unPreviousTrial;
+   UInt32 m_unSinceKeyframe;
+   std::vector<UInt8> m_vecRuns;
+   std::vector<UInt8> m_vecCompressed;
+   std::vector<SPheromoneFrameIndexEntry> m_vecIndex;
+   /* Error raised by the worker, reported on the simulation thread */
+   std::string m_strError;
+
+};
+
+#endif
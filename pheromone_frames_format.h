@@ -0,0 +1,85 @@
+/*
+ * File format of the pheromone field time series, shared by the exporter
+ * (see pheromone_frames_exporter.h) and the reader (see
+ * pheromone_frames_reader.h).
+ *
+ * A frame is the whole grid of the field as 32-bit floats, row-major. It
+ * is XORed with the previous frame, so that the cells that did not change
+ * (most of the arena) become zero words; the result is run-length coded
+ * as alternating runs of zero words and literal words, and the runs are
+ * deflated, whose Huffman stage entropy-codes what is left. Every
+ * keyframe_interval frames, and at the start of every trial, a keyframe
+ * is XORed with an empty field instead, so that decoding any frame takes
+ * at most keyframe_interval frames.
+ *
+ * File layout, in host byte order:
+ *
+ *    header:  UInt32 magic "FGPF", UInt32 version, SInt32 min x, SInt32
+ *             min y, SInt32 size x, SInt32 size y (in cells), SInt32
+ *             cells per meter, UInt32 keyframe interval
+ *    frames:  SPheromoneFrameHeader, then the deflated runs
+ *    index:   for each frame, SPheromoneFrameIndexEntry
+ *    trailer: UInt64 offset of the index, UInt32 number of frames,
+ *             UInt32 magic "FGPI"
+ *
+ * Once inflated, the runs of a frame are, until the grid is covered: a
+ * varint count of zero words, a varint count of literal words, then the
+ * literal words.
+ */
+
+#ifndef PHEROMONE_FRAMES_FORMAT_H
+#define PHEROMONE_FRAMES_FORMAT_H
+
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <vector>
+
+using namespace argos;
+
+static const UInt32 PHEROMONE_FRAMES_MAGIC       = 0x46504746; // "FGPF"
+static const UInt32 PHEROMONE_FRAMES_INDEX_MAGIC = 0x49504746; // "FGPI"
+static const UInt32 PHEROMONE_FRAMES_VERSION     = 1;
+static const UInt32 PHEROMONE_FRAME_KEYFRAME     = 0x01;
+
+struct SPheromoneFrameHeader {
+   UInt32 Trial;            // trial number
+   UInt32 Tick;             // step of the frame
+   UInt32 Flags;            // PHEROMONE_FRAME_KEYFRAME
+   UInt32 RawSize;          // size of the runs once inflated
+   UInt32 CompressedSize;   // size of the deflated runs that follow
+};
+
+struct SPheromoneFrameIndexEntry {
+   UInt32 Trial;
+   UInt32 Tick;
+   UInt32 Flags;
+   UInt32 Padding;
+   UInt64 Offset;           // offset of the frame header in the file
+};
+
+/*
+ * Appends an unsigned varint.
+ */
+inline void PheromoneFramesPutVarint(std::vector<UInt8>& vec_out, UInt32 un_value) {
+   while(un_value >= 0x80) {
+      vec_out.push_back(static_cast<UInt8>(un_value | 0x80));
+      un_value >>= 7;
+   }
+   vec_out.push_back(static_cast<UInt8>(un_value));
+}
+
+/*
+ * Reads an unsigned varint at un_pos, advancing it. Returns false if the
+ * buffer ends first.
+ */
+inline bool PheromoneFramesGetVarint(const UInt8* pun_data, size_t un_size, size_t& un_pos, UInt32& un_value) {
+   un_value = 0;
+   for(UInt32 unShift = 0; unShift < 35; unShift += 7) {
+      if(un_pos >= un_size) return false;
+      UInt8 unByte = pun_data[un_pos++];
+      un_value |= static_cast<UInt32>(unByte & 0x7F) << unShift;
+      if((unByte & 0x80) == 0) return true;
+   }
+   return false;
+}
+
+#endif
@@ -0,0 +1,233 @@
+#include "pheromone_frames_reader.h"
+#include "foraging_checkpoint.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+/****************************************/
+/****************************************/
+
+CPheromoneFramesReader::CPheromoneFramesReader() :
+   m_nMinX(0),
+   m_nMinY(0),
+   m_nSizeX(0),
+   m_nSizeY(0),
+   m_nResolution(1),
+   m_nLoaded(-1) {}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneFramesReader::Open(const std::string& str_file) {
+   m_cFile.close();
+   m_cFile.clear();
+   m_cFile.open(str_file.c_str(), std::ios_base::binary | std::ios_base::in);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Cannot open pheromone frames file \"" << str_file << "\"");
+   }
+   try {
+      /* Header */
+      UInt32 unMagic, unVersion, unKeyframeInterval;
+      CheckpointRead(m_cFile, unMagic);
+      CheckpointRead(m_cFile, unVersion);
+      if(unMagic != PHEROMONE_FRAMES_MAGIC || unVersion != PHEROMONE_FRAMES_VERSION) {
+         THROW_ARGOSEXCEPTION("Not a pheromone frames file, or unsupported version");
+      }
+      CheckpointRead(m_cFile, m_nMinX);
+      CheckpointRead(m_cFile, m_nMinY);
+      CheckpointRead(m_cFile, m_nSizeX);
+      CheckpointRead(m_cFile, m_nSizeY);
+      CheckpointRead(m_cFile, m_nResolution);
+      CheckpointRead(m_cFile, unKeyframeInterval);
+      m_vecWords.assign(m_nSizeX * m_nSizeY, 0);
+      m_vecCells.assign(m_nSizeX * m_nSizeY, 0.0f);
+      m_nLoaded = -1;
+      UInt64 unFirstFrame = m_cFile.tellg();
+      /* Index, from the trailer if there is one */
+      m_cFile.seekg(0, std::ios_base::end);
+      UInt64 unEnd = m_cFile.tellg();
+      m_vecIndex.clear();
+      const UInt64 unTrailer = sizeof(UInt64) + 2 * sizeof(UInt32);
+      bool bIndexed = false;
+      if(unEnd >= unFirstFrame + unTrailer) {
+         UInt64 unIndexOffset;
+         UInt32 unFrames, unIndexMagic;
+         m_cFile.seekg(unEnd - unTrailer);
+         CheckpointRead(m_cFile, unIndexOffset);
+         CheckpointRead(m_cFile, unFrames);
+         CheckpointRead(m_cFile, unIndexMagic);
+         if(unIndexMagic == PHEROMONE_FRAMES_INDEX_MAGIC &&
+            unIndexOffset + unFrames * sizeof(SPheromoneFrameIndexEntry) + unTrailer == unEnd) {
+            m_cFile.seekg(unIndexOffset);
+            m_vecIndex.resize(unFrames);
+            for(UInt32 i = 0; i < unFrames; ++i) {
+               CheckpointRead(m_cFile, m_vecIndex[i]);
+            }
+            bIndexed = true;
+         }
+      }
+      if(!bIndexed) {
+         m_cFile.clear();
+         ScanFrames(unFirstFrame, unEnd);
+      }
+   }
+   catch(CARGoSException& ex) {
+      THROW_ARGOSEXCEPTION_NESTED("Error reading pheromone frames file \"" << str_file << "\"", ex);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneFramesReader::ScanFrames(UInt64 un_first_frame, UInt64 un_end) {
+   UInt64 unOffset = un_first_frame;
+   while(unOffset + sizeof(SPheromoneFrameHeader) <= un_end) {
+      SPheromoneFrameHeader sHeader;
+      m_cFile.seekg(unOffset);
+      CheckpointRead(m_cFile, sHeader);
+      UInt64 unNext = unOffset + sizeof(sHeader) + sHeader.CompressedSize;
+      /* Stop at a frame cut by a crash, or at what is not a frame (e.g. a
+         partly written index) */
+      if(unNext > un_end ||
+         (sHeader.Flags & ~PHEROMONE_FRAME_KEYFRAME) != 0 ||
+         (m_vecIndex.empty() && !(sHeader.Flags & PHEROMONE_FRAME_KEYFRAME))) {
+         break;
+      }
+      SPheromoneFrameIndexEntry sEntry;
+      sEntry.Trial = sHeader.Trial;
+      sEntry.Tick = sHeader.Tick;
+      sEntry.Flags = sHeader.Flags;
+      sEntry.Padding = 0;
+      sEntry.Offset = unOffset;
+      m_vecIndex.push_back(sEntry);
+      unOffset = unNext;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+SInt64 CPheromoneFramesReader::Find(UInt32 un_trial, UInt32 un_tick) const {
+   /* The frames are in the order of the trials and the steps */
+   size_t unLow = 0, unHigh = m_vecIndex.size();
+   while(unLow < unHigh) {
+      size_t unMid = (unLow + unHigh) / 2;
+      const SPheromoneFrameIndexEntry& sEntry = m_vecIndex[unMid];
+      if(sEntry.Trial < un_trial ||
+         (sEntry.Trial == un_trial && sEntry.Tick < un_tick)) {
+         unLow = unMid + 1;
+      }
+      else {
+         unHigh = unMid;
+      }
+   }
+   if(unLow < m_vecIndex.size() &&
+      m_vecIndex[unLow].Trial == un_trial &&
+      m_vecIndex[unLow].Tick == un_tick) {
+      return unLow;
+   }
+   return -1;
+}
+
+/****************************************/
+/****************************************/
+
+const std::vector<float>& CPheromoneFramesReader::Read(size_t un_frame) {
+   if(un_frame >= m_vecIndex.size()) {
+      THROW_ARGOSEXCEPTION("Pheromone frame " << un_frame << " does not exist");
+   }
+   if(static_cast<SInt64>(un_frame) != m_nLoaded) {
+      /* Start from the last keyframe, or from the loaded frame if it is in
+         between */
+      size_t unStart = un_frame;
+      while(!(m_vecIndex[unStart].Flags & PHEROMONE_FRAME_KEYFRAME)) {
+         --unStart;
+      }
+      if(m_nLoaded >= static_cast<SInt64>(unStart) &&
+         m_nLoaded < static_cast<SInt64>(un_frame)) {
+         unStart = m_nLoaded + 1;
+      }
+      m_nLoaded = -1;
+      for(size_t i = unStart; i <= un_frame; ++i) {
+         Apply(i);
+      }
+      for(size_t i = 0; i < m_vecWords.size(); ++i) {
+         ::memcpy(&m_vecCells[i], &m_vecWords[i], sizeof(float));
+      }
+      m_nLoaded = un_frame;
+   }
+   return m_vecCells;
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneFramesReader::Apply(size_t un_frame) {
+   /* Read and inflate the runs */
+   SPheromoneFrameHeader sHeader;
+   m_cFile.clear();
+   m_cFile.seekg(m_vecIndex[un_frame].Offset);
+   CheckpointRead(m_cFile, sHeader);
+   m_vecCompressed.resize(sHeader.CompressedSize);
+   m_cFile.read(reinterpret_cast<char*>(&m_vecCompressed[0]), sHeader.CompressedSize);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Pheromone frames file is truncated");
+   }
+   m_vecRuns.resize(sHeader.RawSize);
+   uLongf unInflated = sHeader.RawSize;
+   if(uncompress(&m_vecRuns[0], &unInflated, &m_vecCompressed[0], sHeader.CompressedSize) != Z_OK ||
+      unInflated != sHeader.RawSize) {
+      THROW_ARGOSEXCEPTION("Corrupted pheromone frame at offset " << m_vecIndex[un_frame].Offset);
+   }
+   /* A keyframe is coded against an empty field */
+   if(sHeader.Flags & PHEROMONE_FRAME_KEYFRAME) {
+      std::fill(m_vecWords.begin(), m_vecWords.end(), 0);
+   }
+   /* Undo the runs and the XOR */
+   size_t unPos = 0;
+   size_t unCell = 0;
+   while(unCell < m_vecWords.size()) {
+      UInt32 unZeros, unLiterals;
+      if(!PheromoneFramesGetVarint(&m_vecRuns[0], m_vecRuns.size(), unPos, unZeros) ||
+         !PheromoneFramesGetVarint(&m_vecRuns[0], m_vecRuns.size(), unPos, unLiterals) ||
+         unCell + unZeros + unLiterals > m_vecWords.size() ||
+         unPos + unLiterals * sizeof(UInt32) > m_vecRuns.size()) {
+         THROW_ARGOSEXCEPTION("Corrupted pheromone frame at offset " << m_vecIndex[un_frame].Offset);
+      }
+      unCell += unZeros;
+      for(UInt32 i = 0; i < unLiterals; ++i, ++unCell, unPos += sizeof(UInt32)) {
+         UInt32 unDelta;
+         ::memcpy(&unDelta, &m_vecRuns[unPos], sizeof(UInt32));
+         m_vecWords[unCell] ^= unDelta;
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneFramesReader::WritePGM(const std::string& str_file,
+                                      const std::vector<float>& vec_cells,
+                                      Real f_max) const {
+   if(f_max <= 0.0) {
+      f_max = vec_cells.empty() ? 0.0 : *std::max_element(vec_cells.begin(), vec_cells.end());
+   }
+   std::ofstream cOut(str_file.c_str(), std::ios_base::binary | std::ios_base::trunc | std::ios_base::out);
+   if(!cOut) {
+      THROW_ARGOSEXCEPTION("Cannot open \"" << str_file << "\" for writing");
+   }
+   cOut << "P5\n" << m_nSizeX << " " << m_nSizeY << "\n255\n";
+   std::vector<UInt8> vecRow(m_nSizeX);
+   /* PGM rows go from top to bottom */
+   for(SInt32 nY = m_nSizeY - 1; nY >= 0; --nY) {
+      for(SInt32 nX = 0; nX < m_nSizeX; ++nX) {
+         Real fValue = f_max > 0.0 ? vec_cells[nY * m_nSizeX + nX] / f_max : 0.0;
+         vecRow[nX] = static_cast<UInt8>(255.0 * std::min<Real>(1.0, std::max<Real>(0.0, fValue)) + 0.5);
+      }
+      cOut.write(reinterpret_cast<const char*>(&vecRow[0]), vecRow.size());
+   }
+   if(!cOut) {
+      THROW_ARGOSEXCEPTION("Error writing \"" << str_file << "\"");
+   }
+}
@@ -0,0 +1,93 @@
+/*
+ * Reader of the pheromone field time series written by
+ * CPheromoneFramesExporter.
+ *
+ * A frame is rebuilt from the last keyframe before it. The last rebuilt
+ * frame is kept, so reading the frames in order decodes each one once.
+ */
+
+#ifndef PHEROMONE_FRAMES_READER_H
+#define PHEROMONE_FRAMES_READER_H
+
+#include "pheromone_frames_format.h"
+#include <fstream>
+#include <string>
+
+class CPheromoneFramesReader {
+
+public:
+
+   CPheromoneFramesReader();
+
+   /*
+    * Opens a file and loads its index, rebuilding it if the file was not
+    * closed properly.
+    */
+   void Open(const std::string& str_file);
+
+   /*
+    * Returns the frames of the file.
+    */
+   inline const std::vector<SPheromoneFrameIndexEntry>& GetIndex() const {
+      return m_vecIndex;
+   }
+
+   /*
+    * Returns the cell coordinates of the lower-left corner of the grid,
+    * its size in cells and the number of cells per meter.
+    */
+   inline void GetExtent(SInt32& n_min_x, SInt32& n_min_y,
+                         SInt32& n_size_x, SInt32& n_size_y,
+                         SInt32& n_resolution) const {
+      n_min_x = m_nMinX;
+      n_min_y = m_nMinY;
+      n_size_x = m_nSizeX;
+      n_size_y = m_nSizeY;
+      n_resolution = m_nResolution;
+   }
+
+   /*
+    * Returns the position in the index of the frame of the given step of
+    * the given trial, or -1 if there is none.
+    */
+   SInt64 Find(UInt32 un_trial, UInt32 un_tick) const;
+
+   /*
+    * Rebuilds the given frame: the grid, row-major, from the lower-left
+    * corner.
+    */
+   const std::vector<float>& Read(size_t un_frame);
+
+   /*
+    * Writes a grid as a binary PGM image, north up. Values are scaled so
+    * that f_max is white; with f_max <= 0, the maximum of the grid is.
+    */
+   void WritePGM(const std::string& str_file,
+                 const std::vector<float>& vec_cells,
+                 Real f_max) const;
+
+private:
+
+   /* Applies the given frame to m_vecWords */
+   void Apply(size_t un_frame);
+
+   /* Walks the frame headers to rebuild the index */
+   void ScanFrames(UInt64 un_first_frame, UInt64 un_end);
+
+private:
+
+   std::ifstream m_cFile;
+   SInt32 m_nMinX, m_nMinY, m_nSizeX, m_nSizeY, m_nResolution;
+   std::vector<SPheromoneFrameIndexEntry> m_vecIndex;
+
+   /* The last rebuilt frame, as words and as floats */
+   SInt64 m_nLoaded;
+   std::vector<UInt32> m_vecWords;
+   std::vector<float> m_vecCells;
+   /* Scratch buffers */
+   std::vector<UInt8> m_vecCompressed;
+   std::vector<UInt8> m_vecRuns;
+
+};
+
+#endif
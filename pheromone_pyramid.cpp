@@ -0,0 +1,201 @@
+#include "pheromone_pyramid.h"
+#include <cmath>
+
+/****************************************/
+/****************************************/
+
+CPheromonePyramid::CPheromonePyramid() :
+   m_pvecCells(NULL),
+   m_nSizeX(0),
+   m_nSizeY(0) {}
+
+/****************************************/
+/****************************************/
+
+void CPheromonePyramid::Init(const std::vector<Real>* pvec_cells, SInt32 n_size_x, SInt32 n_size_y) {
+   m_pvecCells = pvec_cells;
+   m_nSizeX = n_size_x;
+   m_nSizeY = n_size_y;
+   m_vecLevels.clear();
+   SInt32 nSizeX = n_size_x;
+   SInt32 nSizeY = n_size_y;
+   while(nSizeX > 1 || nSizeY > 1) {
+      nSizeX = (nSizeX + 1) / 2;
+      nSizeY = (nSizeY + 1) / 2;
+      m_vecLevels.push_back(SLevel());
+      SLevel& sLevel = m_vecLevels.back();
+      sLevel.SizeX = nSizeX;
+      sLevel.SizeY = nSizeY;
+      sLevel.Sum.assign(nSizeX * nSizeY, 0.0);
+      sLevel.Max.assign(nSizeX * nSizeY, 0.0);
+      sLevel.Active.reserve(sLevel.Sum.size() / 8 + 1);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromonePyramid::Release() {
+   m_pvecCells = NULL;
+   m_vecLevels.clear();
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromonePyramid::Clear() {
+   for(size_t l = 0; l < m_vecLevels.size(); ++l) {
+      SLevel& sLevel = m_vecLevels[l];
+      for(size_t i = 0; i < sLevel.Active.size(); ++i) {
+         sLevel.Sum[sLevel.Active[i]] = 0.0;
+         sLevel.Max[sLevel.Active[i]] = 0.0;
+      }
+      sLevel.Active.clear();
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromonePyramid::AddCells(const std::vector<UInt32>& vec_active) {
+   if(m_vecLevels.empty()) return;
+   SLevel& sLevel = m_vecLevels[0];
+   for(size_t i = 0; i < vec_active.size(); ++i) {
+      UInt32 unCell = vec_active[i];
+      SInt32 nX = unCell % m_nSizeX;
+      SInt32 nY = unCell / m_nSizeX;
+      UInt32 unIdx = (nY >> 1) * sLevel.SizeX + (nX >> 1);
+      if(sLevel.Sum[unIdx] <= 0.0) {
+         sLevel.Active.push_back(unIdx);
+      }
+      Real fValue = (*m_pvecCells)[unCell];
+      sLevel.Sum[unIdx] += fValue;
+      sLevel.Max[unIdx] = std::max(sLevel.Max[unIdx], fValue);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromonePyramid::Propagate() {
+   /* Each level is summed from the non-empty blocks of the one below */
+   for(size_t l = 1; l < m_vecLevels.size(); ++l) {
+      SLevel& sLevel = m_vecLevels[l];
+      const SLevel& sChild = m_vecLevels[l - 1];
+      for(size_t i = 0; i < sChild.Active.size(); ++i) {
+         UInt32 unChild = sChild.Active[i];
+         SInt32 nX = unChild % sChild.SizeX;
+         SInt32 nY = unChild / sChild.SizeX;
+         UInt32 unIdx = (nY >> 1) * sLevel.SizeX + (nX >> 1);
+         if(sLevel.Sum[unIdx] <= 0.0) {
+            sLevel.Active.push_back(unIdx);
+         }
+         sLevel.Sum[unIdx] += sChild.Sum[unChild];
+         sLevel.Max[unIdx] = std::max(sLevel.Max[unIdx], sChild.Max[unChild]);
+      }
+   }
+}
+
+/****************************************/
+/****************************************/
+
+Real CPheromonePyramid::GetBlockMax(SInt32 n_x, SInt32 n_y, UInt32 un_level) const {
+   if(n_x < 0 || n_x >= m_nSizeX || n_y < 0 || n_y >= m_nSizeY) return 0.0;
+   un_level = std::min<UInt32>(un_level, m_vecLevels.size());
+   return Block(un_level, n_x >> un_level, n_y >> un_level, true);
+}
+
+/****************************************/
+/****************************************/
+
+Real CPheromonePyramid::GetMax(SInt32 n_x0, SInt32 n_y0, SInt32 n_x1, SInt32 n_y1) const {
+   if(!Clip(n_x0, n_y0, n_x1, n_y1)) return 0.0;
+   return Reduce(CoverLevel(n_x0, n_y0, n_x1, n_y1), n_x0, n_y0, n_x1, n_y1, true);
+}
+
+/****************************************/
+/****************************************/
+
+Real CPheromonePyramid::GetSum(SInt32 n_x0, SInt32 n_y0, SInt32 n_x1, SInt32 n_y1) const {
+   if(!Clip(n_x0, n_y0, n_x1, n_y1)) return 0.0;
+   return Reduce(CoverLevel(n_x0, n_y0, n_x1, n_y1), n_x0, n_y0, n_x1, n_y1, false);
+}
+
+/****************************************/
+/****************************************/
+
+bool CPheromonePyramid::AnyWithin(SInt32 n_x, SInt32 n_y, Real f_radius) const {
+   SInt32 nRadius = static_cast<SInt32>(std::floor(f_radius));
+   SInt32 nX0 = n_x - nRadius, nY0 = n_y - nRadius;
+   SInt32 nX1 = n_x + nRadius, nY1 = n_y + nRadius;
+   if(!Clip(nX0, nY0, nX1, nY1)) return false;
+   UInt32 unLevel = CoverLevel(nX0, nY0, nX1, nY1);
+   for(SInt32 nBY = nY0 >> unLevel; nBY <= (nY1 >> unLevel); ++nBY) {
+      for(SInt32 nBX = nX0 >> unLevel; nBX <= (nX1 >> unLevel); ++nBX) {
+         if(AnyWithin(unLevel, nBX, nBY, n_x, n_y, f_radius * f_radius)) return true;
+      }
+   }
+   return false;
+}
+
+/****************************************/
+/****************************************/
+
+bool CPheromonePyramid::Clip(SInt32& n_x0, SInt32& n_y0, SInt32& n_x1, SInt32& n_y1) const {
+   n_x0 = std::max<SInt32>(n_x0, 0);
+   n_y0 = std::max<SInt32>(n_y0, 0);
+   n_x1 = std::min<SInt32>(n_x1, m_nSizeX - 1);
+   n_y1 = std::min<SInt32>(n_y1, m_nSizeY - 1);
+   return n_x0 <= n_x1 && n_y0 <= n_y1;
+}
+
+/****************************************/
+/****************************************/
+
+UInt32 CPheromonePyramid::CoverLevel(SInt32 n_x0, SInt32 n_y0, SInt32 n_x1, SInt32 n_y1) const {
+   UInt32 unLevel = 0;
+   while(unLevel < m_vecLevels.size() &&
+         ((n_x1 >> unLevel) - (n_x0 >> unLevel) > 1 ||
+          (n_y1 >> unLevel) - (n_y0 >> unLevel) > 1)) {
+      ++unLevel;
+   }
+   return unLevel;
+}
+
+/****************************************/
+/****************************************/
+
+Real CPheromonePyramid::Reduce(UInt32 un_level, SInt32 n_x0, SInt32 n_y0, SInt32 n_x1, SInt32 n_y1, bool b_max) const {
+   Real fResult = 0.0;
+   for(SInt32 nBY = n_y0 >> un_level; nBY <= (n_y1 >> un_level); ++nBY) {
+      for(SInt32 nBX = n_x0 >> un_level; nBX <= (n_x1 >> un_level); ++nBX) {
+         Real fBlock = Block(un_level, nBX, nBY, b_max);
+         fResult = b_max ? std::max(fResult, fBlock) : fResult + fBlock;
+      }
+   }
+   return fResult;
+}
+
+/****************************************/
+/****************************************/
+
+bool CPheromonePyramid::AnyWithin(UInt32 un_level, SInt32 n_bx, SInt32 n_by,
+                                  SInt32 n_x, SInt32 n_y, Real f_square_radius) const {
+   if(Block(un_level, n_bx, n_by, true) <= 0.0) return false;
+   /* Distance from the center cell to the nearest cell of the block */
+   SInt32 nX0 = n_bx << un_level, nX1 = std::min<SInt32>(((n_bx + 1) << un_level) - 1, m_nSizeX - 1);
+   SInt32 nY0 = n_by << un_level, nY1 = std::min<SInt32>(((n_by + 1) << un_level) - 1, m_nSizeY - 1);
+   Real fDX = std::max<SInt32>(0, std::max(nX0 - n_x, n_x - nX1));
+   Real fDY = std::max<SInt32>(0, std::max(nY0 - n_y, n_y - nY1));
+   if(fDX * fDX + fDY * fDY > f_square_radius) return false;
+   if(un_level == 0) return true;
+   /* Descend into the children that exist */
+   SInt32 nChildSizeX = un_level == 1 ? m_nSizeX : m_vecLevels[un_level - 2].SizeX;
+   SInt32 nChildSizeY = un_level == 1 ? m_nSizeY : m_vecLevels[un_level - 2].SizeY;
+   for(SInt32 nCY = 2 * n_by; nCY <= 2 * n_by + 1 && nCY < nChildSizeY; ++nCY) {
+      for(SInt32 nCX = 2 * n_bx; nCX <= 2 * n_bx + 1 && nCX < nChildSizeX; ++nCX) {
+         if(AnyWithin(un_level - 1, nCX, nCY, n_x, n_y, f_square_radius)) return true;
+      }
+   }
+   return false;
+}
@@ -0,0 +1,164 @@
+/*
+ * A mip pyramid over the pheromone field.
+ *
+ * Level 0 is the field itself; each block of level l+1 holds the sum and
+ * the maximum of a 2x2 block of level l, so a block of level l covers
+ * 2^l x 2^l cells. Deposits update one block per level. Decay lowers the
+ * cells by different amounts (the cells it kills lose less than the
+ * others), so the levels are rebuilt from the cells still holding
+ * pheromone, level by level; like the field, each level keeps the list of
+ * its non-empty blocks, so the rebuild costs about 4/3 of the decay of the
+ * trail, whatever the size of the arena.
+ *
+ * Coordinates are cell coordinates relative to the lower-left corner of
+ * the field.
+ */
+
+#ifndef PHEROMONE_PYRAMID_H
+#define PHEROMONE_PYRAMID_H
+
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <algorithm>
+#include <vector>
+
+using namespace argos;
+
+class CPheromonePyramid {
+
+public:
+
+   CPheromonePyramid();
+
+   /*
+    * Allocates the levels over a grid of n_size_x x n_size_y cells, down
+    * to a single block. The grid is read through pvec_cells.
+    */
+   void Init(const std::vector<Real>* pvec_cells, SInt32 n_size_x, SInt32 n_size_y);
+
+   /*
+    * Releases the levels: the pyramid is disabled.
+    */
+   void Release();
+
+   /*
+    * Returns true if the pyramid is allocated.
+    */
+   inline bool IsEnabled() const {
+      return m_pvecCells != NULL;
+   }
+
+   /*
+    * Empties every level, keeping the memory.
+    */
+   void Clear();
+
+   /*
+    * Accounts for f_amount deposited at the given cell, which now holds
+    * f_value.
+    */
+   inline void Deposit(SInt32 n_x, SInt32 n_y, Real f_value, Real f_amount) {
+      for(size_t l = 0; l < m_vecLevels.size(); ++l) {
+         n_x >>= 1;
+         n_y >>= 1;
+         SLevel& sLevel = m_vecLevels[l];
+         UInt32 unIdx = n_y * sLevel.SizeX + n_x;
+         if(sLevel.Sum[unIdx] <= 0.0) {
+            sLevel.Active.push_back(unIdx);
+         }
+         sLevel.Sum[unIdx] += f_amount;
+         sLevel.Max[unIdx] = std::max(sLevel.Max[unIdx], f_value);
+      }
+   }
+
+   /*
+    * Rebuilds the levels from the cells of the grid listed in vec_active,
+    * which must be all the cells holding pheromone.
+    */
+   inline void Rebuild(const std::vector<UInt32>& vec_active) {
+      Clear();
+      AddCells(vec_active);
+      Propagate();
+   }
+
+   /*
+    * The two halves of Rebuild(), for cells listed in several vectors:
+    * after Clear(), AddCells() accounts for the listed cells in the first
+    * level, and Propagate() sums the other levels from it.
+    */
+   void AddCells(const std::vector<UInt32>& vec_active);
+   void Propagate();
+
+   /*
+    * Returns the number of levels, the field included.
+    */
+   inline UInt32 GetLevels() const {
+      return m_vecLevels.size() + 1;
+   }
+
+   /*
+    * Returns the largest value in the block of the given level containing
+    * the given cell.
+    */
+   Real GetBlockMax(SInt32 n_x, SInt32 n_y, UInt32 un_level) const;
+
+   /*
+    * Returns the largest value, or the sum of the values, over the blocks
+    * covering the cells [n_x0,n_x1] x [n_y0,n_y1]. They are read at the
+    * finest level where the rectangle spans at most 2x2 blocks, so the
+    * area covered can be up to twice as wide as the rectangle along each
+    * axis, and the cost is one step per level.
+    */
+   Real GetMax(SInt32 n_x0, SInt32 n_y0, SInt32 n_x1, SInt32 n_y1) const;
+   Real GetSum(SInt32 n_x0, SInt32 n_y0, SInt32 n_x1, SInt32 n_y1) const;
+
+   /*
+    * Returns true if any cell within f_radius cells of (n_x,n_y) holds
+    * pheromone. Starts from the blocks GetMax() reads and descends only
+    * into the non-empty blocks that reach the disc.
+    */
+   bool AnyWithin(SInt32 n_x, SInt32 n_y, Real f_radius) const;
+
+private:
+
+   struct SLevel {
+      SInt32 SizeX;
+      SInt32 SizeY;
+      std::vector<Real> Sum;
+      std::vector<Real> Max;
+      /* Indices of the non-empty blocks */
+      std::vector<UInt32> Active;
+   };
+
+   /* Returns the sum or the maximum of a block; level 0 is the grid */
+   inline Real Block(UInt32 un_level, SInt32 n_x, SInt32 n_y, bool b_max) const {
+      if(un_level == 0) {
+         return (*m_pvecCells)[n_y * m_nSizeX + n_x];
+      }
+      const SLevel& sLevel = m_vecLevels[un_level - 1];
+      UInt32 unIdx = n_y * sLevel.SizeX + n_x;
+      return b_max ? sLevel.Max[unIdx] : sLevel.Sum[unIdx];
+   }
+
+   /* Clips a rectangle to the grid; returns false if nothing is left */
+   bool Clip(SInt32& n_x0, SInt32& n_y0, SInt32& n_x1, SInt32& n_y1) const;
+
+   /* Returns the finest level where the rectangle spans at most 2x2 blocks */
+   UInt32 CoverLevel(SInt32 n_x0, SInt32 n_y0, SInt32 n_x1, SInt32 n_y1) const;
+
+   /* Reduces the blocks of the given level covering the rectangle */
+   Real Reduce(UInt32 un_level, SInt32 n_x0, SInt32 n_y0, SInt32 n_x1, SInt32 n_y1, bool b_max) const;
+
+   /* Recursive step of AnyWithin() */
+   bool AnyWithin(UInt32 un_level, SInt32 n_bx, SInt32 n_by,
+                  SInt32 n_x, SInt32 n_y, Real f_square_radius) const;
+
+private:
+
+   const std::vector<Real>* m_pvecCells;
+   SInt32 m_nSizeX, m_nSizeY;
+   /* Levels 1 and up */
+   std::vector<SLevel> m_vecLevels;
+
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "pheromone_trail_default_sensor.h"
+#include "foraging_loop_functions.h"
+#include <argos3/core/simulator/simulator.h>
+
+/****************************************/
+/****************************************/
+
+CPheromoneTrailDefaultSensor::CPheromoneTrailDefaultSensor() :
+   m_pcEmbodiedEntity(NULL),
+   m_pcField(NULL),
+   m_fRadius(1.0) {}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneTrailDefaultSensor::SetRobot(CComposableEntity& c_entity) {
+   m_pcEmbodiedEntity = &(c_entity.GetComponent<CEmbodiedEntity>("body"));
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneTrailDefaultSensor::Init(TConfigurationNode& t_tree) {
+   try {
+      GetNodeAttributeOrDefault(t_tree, "radius", m_fRadius, m_fRadius);
+      if(m_fRadius <= 0.0) {
+         THROW_ARGOSEXCEPTION("The radius must be positive");
+      }
+   }
+   catch(CARGoSException& ex) {
+      THROW_ARGOSEXCEPTION_NESTED("Error initializing the pheromone trail sensor", ex);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneTrailDefaultSensor::Update() {
+   if(m_pcField == NULL) {
+      CForagingLoopFunctions* pcLoopFunctions =
+         dynamic_cast<CForagingLoopFunctions*>(&CSimulator::GetInstance().GetLoopFunctions());
+      if(pcLoopFunctions == NULL) {
+         THROW_ARGOSEXCEPTION("The pheromone trail sensor needs the foraging loop functions");
+      }
+      if(!pcLoopFunctions->GetPheromoneField().HasPyramid()) {
+         THROW_ARGOSEXCEPTION("The pheromone trail sensor needs pyramid=\"true\" on the <pheromones> node");
+      }
+      m_pcField = &pcLoopFunctions->GetPheromoneField();
+   }
+   const CVector3& cPosition = m_pcEmbodiedEntity->GetOriginAnchor().Position;
+   m_sReading.Any = m_pcField->AnyWithin(cPosition.GetX(), cPosition.GetY(), m_fRadius);
+   m_sReading.Max = m_sReading.Any ?
+      m_pcField->GetMaxAround(cPosition.GetX(), cPosition.GetY(), m_fRadius) :
+      0.0;
+}
+
+/****************************************/
+/****************************************/
+
+void CPheromoneTrailDefaultSensor::Reset() {
+   m_sReading = SReading();
+}
+
+/****************************************/
+/****************************************/
+
+REGISTER_SENSOR(CPheromoneTrailDefaultSensor,
+                "pheromone_trail", "default",
+                "Vision-Robot-Behaviors",
+                "1.0",
+                "A virtual sensor asking the pheromone field of the foraging loop functions about the trail around the robot.",
+                "Answers, from the pyramid of the pheromone field, whether any cell within\n"
+                "the radius of the sensor holds pheromone, and the largest value around the\n"
+                "robot. The largest value comes from the pyramid blocks covering the disc,\n"
+                "up to twice the radius away along each axis. The loop functions need\n"
+                "pyramid=\"true\" on the <pheromones> node.\n\n"
+                "REQUIRED XML CONFIGURATION\n\n"
+                "  <controllers>\n"
+                "    ...\n"
+                "    <my_controller ...>\n"
+                "      ...\n"
+                "      <sensors>\n"
+                "        ...\n"
+                "        <pheromone_trail implementation=\"default\" />\n"
+                "        ...\n"
+                "      </sensors>\n"
+                "      ...\n"
+                "    </my_controller>\n"
+                "    ...\n"
+                "  </controllers>\n\n"
+                "OPTIONAL XML CONFIGURATION\n\n"
+                "The radius of the queries, in meters, defaults to 1:\n\n"
+                "  <pheromone_trail implementation=\"default\" radius=\"0.5\" />\n",
+                "Usable"
+   );
@@ -0,0 +1,47 @@
+/*
+ * Simulated pheromone trail sensor: asks the pyramid of the pheromone
+ * field of the foraging loop functions about the trail within the radius
+ * of the sensor. See ci_pheromone_trail_sensor.h.
+ */
+
+#ifndef PHEROMONE_TRAIL_DEFAULT_SENSOR_H
+#define PHEROMONE_TRAIL_DEFAULT_SENSOR_H
+
+#include "ci_pheromone_trail_sensor.h"
+#include <argos3/core/simulator/sensor.h>
+#include <argos3/core/simulator/entity/composable_entity.h>
+#include <argos3/core/simulator/entity/embodied_entity.h>
+
+using namespace argos;
+
+class CPheromoneField;
+
+class CPheromoneTrailDefaultSensor : public CSimulatedSensor,
+                                     public CCI_PheromoneTrailSensor {
+
+public:
+
+   CPheromoneTrailDefaultSensor();
+
+   virtual ~CPheromoneTrailDefaultSensor() {}
+
+   virtual void SetRobot(CComposableEntity& c_entity);
+
+   virtual void Init(TConfigurationNode& t_tree);
+
+   virtual void Update();
+
+   virtual void Reset();
+
+private:
+
+   CEmbodiedEntity* m_pcEmbodiedEntity;
+   /* The field of the loop functions, which are initialized after the
+      robots */
+   const CPheromoneField* m_pcField;
+   /* The radius of the queries, in meters */
+   Real m_fRadius;
+
+};
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Prints recorded foot-bot trajectories (see trajectory_recorder.h).
+ *
+ * Without -t, lists the chunks of the file. With -t, prints the pose and
+ * state of every robot at the given steps, seeking straight to them.
+ *
+ * Example:
+ *
+ *    trajectory_dump -f trajectories.bin -r 0 -t 5000-5010
+ */
+
+#include "trajectory_reader.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+using namespace argos;
+
+/****************************************/
+/****************************************/
+
+static void PrintUsage(const char* pch_name) {
+   std::cerr << "Usage: " << pch_name << " -f <trajectory file> [-r <trial>] [-t <step>[-<last step>]]" << std::endl;
+}
+
+/****************************************/
+/****************************************/
+
+int main(int argc, char** argv) {
+   std::string strFile;
+   UInt32 unTrial = 0;
+   std::string strTicks;
+   int nOpt;
+   while((nOpt = getopt(argc, argv, "f:r:t:h")) != -1) {
+      switch(nOpt) {
+         case 'f': strFile = optarg; break;
+         case 'r': unTrial = std::strtoul(optarg, NULL, 10); break;
+         case 't': strTicks = optarg; break;
+         default: PrintUsage(argv[0]); return 1;
+      }
+   }
+   if(strFile.empty()) {
+      PrintUsage(argv[0]);
+      return 1;
+   }
+   try {
+      CTrajectoryReader cReader;
+      cReader.Open(strFile);
+      if(strTicks.empty()) {
+         /* List the chunks */
+         const std::vector<STrajectoryIndexEntry>& vecIndex = cReader.GetIndex();
+         std::cout << "# " << cReader.GetRobotIds().size() << " robots, "
+                   << vecIndex.size() << " chunks" << std::endl
+                   << "# trial\tfirst_step\tsteps\toffset" << std::endl;
+         for(size_t i = 0; i < vecIndex.size(); ++i) {
+            std::cout << vecIndex[i].Trial << "\t"
+                      << vecIndex[i].FirstTick << "\t"
+                      << vecIndex[i].Ticks << "\t"
+                      << vecIndex[i].Offset << std::endl;
+         }
+         return 0;
+      }
+      /* Print a range of steps */
+      UInt32 unFirst = std::strtoul(strTicks.c_str(), NULL, 10);
+      UInt32 unLast = unFirst;
+      size_t unDash = strTicks.find('-');
+      if(unDash != std::string::npos) {
+         unLast = std::strtoul(strTicks.c_str() + unDash + 1, NULL, 10);
+      }
+      const std::vector<std::string>& vecIds = cReader.GetRobotIds();
+      std::vector<CTrajectoryReader::SPose> vecPoses;
+      std::cout << "# step\trobot\tx\ty\tyaw\tstate\tcarrying_food" << std::endl;
+      for(UInt32 unTick = unFirst; unTick <= unLast; ++unTick) {
+         if(!cReader.Read(unTrial, unTick, vecPoses)) {
+            std::cerr << "Step " << unTick << " of trial " << unTrial << " was not recorded" << std::endl;
+            continue;
+         }
+         for(size_t i = 0; i < vecPoses.size(); ++i) {
+            std::cout << unTick << "\t"
+                      << vecIds[i] << "\t"
+                      << vecPoses[i].X << "\t"
+                      << vecPoses[i].Y << "\t"
+                      << vecPoses[i].Yaw << "\t"
+                      << static_cast<UInt32>(vecPoses[i].State) << "\t"
+                      << vecPoses[i].CarryingFood << std::endl;
+         }
+      }
+   }
+   catch(CARGoSException& ex) {
+      std::cerr << ex.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}
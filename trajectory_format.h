@@ -0,0 +1,106 @@
+/*
+ * File format of the foot-bot trajectories, shared by the recorder (see
+ * trajectory_recorder.h) and the reader (see trajectory_reader.h).
+ *
+ * Poses are quantized: positions to a fixed step in meters, yaw to 1/65536
+ * of a turn. The file is made of chunks of consecutive steps of one trial.
+ * A chunk starts with a keyframe holding the absolute quantized pose of
+ * every robot; the following steps hold the difference with the previous
+ * step, as zigzag varints. Within a chunk the data is laid out by column
+ * (all X deltas, all Y deltas, all yaw deltas, all states), which is what
+ * zlib compresses best, and the whole chunk is deflated.
+ *
+ * File layout, in host byte order:
+ *
+ *    header:  UInt32 magic "FGTR", UInt32 version, Real position quantum,
+ *             UInt32 number of robots, then for each robot its id as
+ *             UInt32 length and characters
+ *    chunks:  STrajectoryChunkHeader, then the deflated chunk
+ *    index:   for each chunk, STrajectoryIndexEntry
+ *    trailer: UInt64 offset of the index, UInt32 number of chunks,
+ *             UInt32 magic "FGTI"
+ *
+ * The index and trailer are written when the recorder is closed. A file
+ * without them (e.g. after a crash) can still be read: the reader then
+ * walks the chunk headers to rebuild the index.
+ *
+ * A deflated chunk holds, once inflated, five sections whose byte sizes
+ * are given in the chunk header: the keyframe (for each robot, SInt32 x,
+ * SInt32 y, UInt16 yaw), then the X, Y and yaw delta varints of the
+ * following steps, robot by robot and step by step, and finally one state
+ * byte per robot per step, keyframe included: the controller state in the
+ * low bits, TRAJECTORY_CARRYING_FOOD when the robot carries an item.
+ */
+
+#ifndef TRAJECTORY_FORMAT_H
+#define TRAJECTORY_FORMAT_H
+
+#include <argos3/core/utility/datatypes/datatypes.h>
+#include <vector>
+
+using namespace argos;
+
+static const UInt32 TRAJECTORY_MAGIC         = 0x52544746; // "FGTR"
+static const UInt32 TRAJECTORY_INDEX_MAGIC   = 0x49544746; // "FGTI"
+static const UInt32 TRAJECTORY_VERSION       = 1;
+static const UInt8  TRAJECTORY_CARRYING_FOOD = 0x80;
+static const UInt32 TRAJECTORY_SECTIONS      = 5;
+static const UInt32 TRAJECTORY_KEYFRAME_SIZE = 10; // bytes per robot
+
+/* Sections of a chunk */
+enum ETrajectorySection {
+   TRAJECTORY_SECTION_KEYFRAME = 0,
+   TRAJECTORY_SECTION_X,
+   TRAJECTORY_SECTION_Y,
+   TRAJECTORY_SECTION_YAW,
+   TRAJECTORY_SECTION_STATE
+};
+
+struct STrajectoryChunkHeader {
+   UInt32 Trial;            // trial number
+   UInt32 FirstTick;        // step of the keyframe
+   UInt32 Ticks;            // number of steps, keyframe included
+   UInt32 Sections[TRAJECTORY_SECTIONS]; // inflated size of each section
+   UInt32 CompressedSize;   // size of the deflated chunk that follows
+};
+
+struct STrajectoryIndexEntry {
+   UInt32 Trial;
+   UInt32 FirstTick;
+   UInt32 Ticks;
+   UInt32 Padding;
+   UInt64 Offset;           // offset of the chunk header in the file
+};
+
+/*
+ * Appends a signed value as a zigzag varint: small magnitudes of either
+ * sign take one byte.
+ */
+inline void TrajectoryPutVarint(std::vector<UInt8>& vec_out, SInt32 n_value) {
+   UInt32 unZigzag = (static_cast<UInt32>(n_value) << 1) ^ static_cast<UInt32>(n_value >> 31);
+   while(unZigzag >= 0x80) {
+      vec_out.push_back(static_cast<UInt8>(unZigzag | 0x80));
+      unZigzag >>= 7;
+   }
+   vec_out.push_back(static_cast<UInt8>(unZigzag));
+}
+
+/*
+ * Reads a zigzag varint at un_pos, advancing it. Returns false if the
+ * buffer ends first.
+ */
+inline bool TrajectoryGetVarint(const UInt8* pun_data, size_t un_size, size_t& un_pos, SInt32& n_value) {
+   UInt32 unZigzag = 0;
+   for(UInt32 unShift = 0; unShift < 35; unShift += 7) {
+      if(un_pos >= un_size) return false;
+      UInt8 unByte = pun_data[un_pos++];
+      unZigzag |= static_cast<UInt32>(unByte & 0x7F) << unShift;
+      if((unByte & 0x80) == 0) {
+         n_value = static_cast<SInt32>(unZigzag >> 1) ^ -static_cast<SInt32>(unZigzag & 1);
+         return true;
+      }
+   }
+   return false;
+}
+
+#endif
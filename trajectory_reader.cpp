@@ -0,0 +1,213 @@
+#include "trajectory_reader.h"
+#include "foraging_checkpoint.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <argos3/core/utility/math/angles.h>
+#include <cstring>
+#include <limits>
+#include <zlib.h>
+
+/****************************************/
+/****************************************/
+
+CTrajectoryReader::CTrajectoryReader() :
+   m_fQuantum(0.001),
+   m_unLoaded(std::numeric_limits<size_t>::max()) {}
+
+/****************************************/
+/****************************************/
+
+void CTrajectoryReader::Open(const std::string& str_file) {
+   m_cFile.close();
+   m_cFile.clear();
+   m_cFile.open(str_file.c_str(), std::ios_base::binary | std::ios_base::in);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Cannot open trajectory file \"" << str_file << "\"");
+   }
+   try {
+      /* Header */
+      UInt32 unMagic, unVersion, unRobots;
+      CheckpointRead(m_cFile, unMagic);
+      CheckpointRead(m_cFile, unVersion);
+      if(unMagic != TRAJECTORY_MAGIC || unVersion != TRAJECTORY_VERSION) {
+         THROW_ARGOSEXCEPTION("Not a trajectory file, or unsupported version");
+      }
+      CheckpointRead(m_cFile, m_fQuantum);
+      CheckpointRead(m_cFile, unRobots);
+      m_vecRobotIds.resize(unRobots);
+      for(UInt32 i = 0; i < unRobots; ++i) {
+         CheckpointRead(m_cFile, m_vecRobotIds[i]);
+      }
+      UInt64 unFirstChunk = m_cFile.tellg();
+      /* Index, from the trailer if there is one */
+      m_cFile.seekg(0, std::ios_base::end);
+      UInt64 unEnd = m_cFile.tellg();
+      m_vecIndex.clear();
+      m_unLoaded = std::numeric_limits<size_t>::max();
+      const UInt64 unTrailer = sizeof(UInt64) + 2 * sizeof(UInt32);
+      bool bIndexed = false;
+      if(unEnd >= unFirstChunk + unTrailer) {
+         UInt64 unIndexOffset;
+         UInt32 unChunks, unIndexMagic;
+         m_cFile.seekg(unEnd - unTrailer);
+         CheckpointRead(m_cFile, unIndexOffset);
+         CheckpointRead(m_cFile, unChunks);
+         CheckpointRead(m_cFile, unIndexMagic);
+         if(unIndexMagic == TRAJECTORY_INDEX_MAGIC &&
+            unIndexOffset + unChunks * sizeof(STrajectoryIndexEntry) + unTrailer == unEnd) {
+            m_cFile.seekg(unIndexOffset);
+            m_vecIndex.resize(unChunks);
+            for(UInt32 i = 0; i < unChunks; ++i) {
+               CheckpointRead(m_cFile, m_vecIndex[i]);
+            }
+            bIndexed = true;
+         }
+      }
+      if(!bIndexed) {
+         m_cFile.clear();
+         ScanChunks(unFirstChunk, unEnd);
+      }
+   }
+   catch(CARGoSException& ex) {
+      THROW_ARGOSEXCEPTION_NESTED("Error reading trajectory file \"" << str_file << "\"", ex);
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CTrajectoryReader::ScanChunks(UInt64 un_first_chunk, UInt64 un_end) {
+   UInt64 unOffset = un_first_chunk;
+   while(unOffset + sizeof(STrajectoryChunkHeader) <= un_end) {
+      STrajectoryChunkHeader sHeader;
+      m_cFile.seekg(unOffset);
+      CheckpointRead(m_cFile, sHeader);
+      UInt64 unNext = unOffset + sizeof(sHeader) + sHeader.CompressedSize;
+      /* Stop at a chunk cut by a crash, or at what is not a chunk (e.g. a
+         partly written index) */
+      if(unNext > un_end ||
+         sHeader.Ticks == 0 ||
+         sHeader.Sections[TRAJECTORY_SECTION_KEYFRAME] != m_vecRobotIds.size() * TRAJECTORY_KEYFRAME_SIZE) {
+         break;
+      }
+      STrajectoryIndexEntry sEntry;
+      sEntry.Trial = sHeader.Trial;
+      sEntry.FirstTick = sHeader.FirstTick;
+      sEntry.Ticks = sHeader.Ticks;
+      sEntry.Padding = 0;
+      sEntry.Offset = unOffset;
+      m_vecIndex.push_back(sEntry);
+      unOffset = unNext;
+   }
+}
+
+/****************************************/
+/****************************************/
+
+bool CTrajectoryReader::Read(UInt32 un_trial, UInt32 un_tick, std::vector<SPose>& vec_poses) {
+   /* Find the last chunk starting at or before (trial, tick): the chunks
+      are in the order of the trials and the steps */
+   size_t unLow = 0, unHigh = m_vecIndex.size();
+   while(unLow < unHigh) {
+      size_t unMid = (unLow + unHigh) / 2;
+      const STrajectoryIndexEntry& sEntry = m_vecIndex[unMid];
+      if(sEntry.Trial < un_trial ||
+         (sEntry.Trial == un_trial && sEntry.FirstTick <= un_tick)) {
+         unLow = unMid + 1;
+      }
+      else {
+         unHigh = unMid;
+      }
+   }
+   if(unLow == 0) return false;
+   size_t unChunk = unLow - 1;
+   const STrajectoryIndexEntry& sEntry = m_vecIndex[unChunk];
+   if(sEntry.Trial != un_trial || un_tick >= sEntry.FirstTick + sEntry.Ticks) {
+      return false;
+   }
+   if(unChunk != m_unLoaded) {
+      LoadChunk(unChunk);
+   }
+   size_t unRobots = m_vecRobotIds.size();
+   std::vector<SPose>::const_iterator itStart =
+      m_vecDecoded.begin() + (un_tick - sEntry.FirstTick) * unRobots;
+   vec_poses.assign(itStart, itStart + unRobots);
+   return true;
+}
+
+/****************************************/
+/****************************************/
+
+void CTrajectoryReader::LoadChunk(size_t un_chunk) {
+   m_unLoaded = std::numeric_limits<size_t>::max();
+   /* Read and inflate the chunk */
+   STrajectoryChunkHeader sHeader;
+   m_cFile.clear();
+   m_cFile.seekg(m_vecIndex[un_chunk].Offset);
+   CheckpointRead(m_cFile, sHeader);
+   m_vecCompressed.resize(sHeader.CompressedSize);
+   m_cFile.read(reinterpret_cast<char*>(&m_vecCompressed[0]), sHeader.CompressedSize);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Trajectory file is truncated");
+   }
+   size_t unRawSize = 0;
+   for(UInt32 i = 0; i < TRAJECTORY_SECTIONS; ++i) {
+      unRawSize += sHeader.Sections[i];
+   }
+   m_vecRaw.resize(unRawSize);
+   uLongf unInflated = unRawSize;
+   if(uncompress(&m_vecRaw[0], &unInflated, &m_vecCompressed[0], sHeader.CompressedSize) != Z_OK ||
+      unInflated != unRawSize) {
+      THROW_ARGOSEXCEPTION("Corrupted trajectory chunk at offset " << m_vecIndex[un_chunk].Offset);
+   }
+   /* Locate the sections */
+   const UInt8* punSection[TRAJECTORY_SECTIONS];
+   size_t punPos[TRAJECTORY_SECTIONS];
+   const UInt8* punCursor = &m_vecRaw[0];
+   for(UInt32 i = 0; i < TRAJECTORY_SECTIONS; ++i) {
+      punSection[i] = punCursor;
+      punPos[i] = 0;
+      punCursor += sHeader.Sections[i];
+   }
+   size_t unRobots = m_vecRobotIds.size();
+   if(sHeader.Sections[TRAJECTORY_SECTION_KEYFRAME] != unRobots * TRAJECTORY_KEYFRAME_SIZE ||
+      sHeader.Sections[TRAJECTORY_SECTION_STATE] != unRobots * sHeader.Ticks) {
+      THROW_ARGOSEXCEPTION("Corrupted trajectory chunk at offset " << m_vecIndex[un_chunk].Offset);
+   }
+   /* Rebuild the quantized poses step by step */
+   std::vector<SInt32> vecX(unRobots), vecY(unRobots);
+   std::vector<UInt16> vecYaw(unRobots);
+   const UInt8* punKey = punSection[TRAJECTORY_SECTION_KEYFRAME];
+   for(size_t r = 0; r < unRobots; ++r) {
+      ::memcpy(&vecX[r],   punKey + r * TRAJECTORY_KEYFRAME_SIZE,     sizeof(SInt32));
+      ::memcpy(&vecY[r],   punKey + r * TRAJECTORY_KEYFRAME_SIZE + 4, sizeof(SInt32));
+      ::memcpy(&vecYaw[r], punKey + r * TRAJECTORY_KEYFRAME_SIZE + 8, sizeof(UInt16));
+   }
+   m_vecDecoded.resize(sHeader.Ticks * unRobots);
+   const Real fYawQuantum = CRadians::TWO_PI.GetValue() / 65536.0;
+   for(UInt32 t = 0; t < sHeader.Ticks; ++t) {
+      for(size_t r = 0; r < unRobots; ++r) {
+         if(t > 0) {
+            SInt32 nDX, nDY, nDYaw;
+            if(!TrajectoryGetVarint(punSection[TRAJECTORY_SECTION_X], sHeader.Sections[TRAJECTORY_SECTION_X],
+                                    punPos[TRAJECTORY_SECTION_X], nDX) ||
+               !TrajectoryGetVarint(punSection[TRAJECTORY_SECTION_Y], sHeader.Sections[TRAJECTORY_SECTION_Y],
+                                    punPos[TRAJECTORY_SECTION_Y], nDY) ||
+               !TrajectoryGetVarint(punSection[TRAJECTORY_SECTION_YAW], sHeader.Sections[TRAJECTORY_SECTION_YAW],
+                                    punPos[TRAJECTORY_SECTION_YAW], nDYaw)) {
+               THROW_ARGOSEXCEPTION("Corrupted trajectory chunk at offset " << m_vecIndex[un_chunk].Offset);
+            }
+            vecX[r] += nDX;
+            vecY[r] += nDY;
+            vecYaw[r] = static_cast<UInt16>(vecYaw[r] + nDYaw);
+         }
+         UInt8 unState = punSection[TRAJECTORY_SECTION_STATE][t * unRobots + r];
+         SPose& sPose = m_vecDecoded[t * unRobots + r];
+         sPose.X = vecX[r] * m_fQuantum;
+         sPose.Y = vecY[r] * m_fQuantum;
+         sPose.Yaw = vecYaw[r] * fYawQuantum;
+         sPose.State = unState & ~TRAJECTORY_CARRYING_FOOD;
+         sPose.CarryingFood = (unState & TRAJECTORY_CARRYING_FOOD) != 0;
+      }
+   }
+   m_unLoaded = un_chunk;
+}
@@ -0,0 +1,83 @@
+/*
+ * Reader of the trajectory files written by CTrajectoryRecorder.
+ *
+ * Seeking to a step costs a binary search in the index and the decoding of
+ * the one chunk holding it; the last decoded chunk is kept, so reading
+ * consecutive steps decodes each chunk once.
+ */
+
+#ifndef TRAJECTORY_READER_H
+#define TRAJECTORY_READER_H
+
+#include "trajectory_format.h"
+#include <fstream>
+#include <string>
+
+class CTrajectoryReader {
+
+public:
+
+   /*
+    * The pose and state of a robot at a step.
+    */
+   struct SPose {
+      Real X;             // meters
+      Real Y;             // meters
+      Real Yaw;           // radians, in [0,2pi)
+      UInt8 State;        // CFootBotForaging::SStateData::EState
+      bool CarryingFood;
+   };
+
+   CTrajectoryReader();
+
+   /*
+    * Opens a file and loads its index, rebuilding it if the file was not
+    * closed properly.
+    */
+   void Open(const std::string& str_file);
+
+   /*
+    * Returns the ids of the robots, in the order of the poses.
+    */
+   inline const std::vector<std::string>& GetRobotIds() const {
+      return m_vecRobotIds;
+   }
+
+   /*
+    * Returns the chunks of the file.
+    */
+   inline const std::vector<STrajectoryIndexEntry>& GetIndex() const {
+      return m_vecIndex;
+   }
+
+   /*
+    * Reads the poses of all the robots at the given step of the given
+    * trial. Returns false if that step was not recorded.
+    */
+   bool Read(UInt32 un_trial, UInt32 un_tick, std::vector<SPose>& vec_poses);
+
+private:
+
+   /* Decodes the given chunk into m_vecDecoded */
+   void LoadChunk(size_t un_chunk);
+
+   /* Walks the chunk headers to rebuild the index */
+   void ScanChunks(UInt64 un_first_chunk, UInt64 un_end);
+
+private:
+
+   std::ifstream m_cFile;
+   Real m_fQuantum;
+   std::vector<std::string> m_vecRobotIds;
+   std::vector<STrajectoryIndexEntry> m_vecIndex;
+
+   /* The decoded chunk: the poses of all the robots, step by step */
+   size_t m_unLoaded;
+   std::vector<SPose> m_vecDecoded;
+   /* Scratch buffers */
+   std::vector<UInt8> m_vecCompressed;
+   std::vector<UInt8> m_vecRaw;
+
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "trajectory_recorder.h"
+#include "foraging_checkpoint.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <cmath>
+#include <cstring>
+#include <zlib.h>
+
+/****************************************/
+/****************************************/
+
+CTrajectoryRecorder::CTrajectoryRecorder() :
+   m_fQuantum(0.001),
+   m_unChunkTicks(100),
+   m_unRobots(0),
+   m_bChunkOpen(false),
+   m_unNextRobot(0) {}
+
+/****************************************/
+/****************************************/
+
+CTrajectoryRecorder::~CTrajectoryRecorder() {
+   Close();
+}
+
+/****************************************/
+/****************************************/
+
+void CTrajectoryRecorder::Open(const std::string& str_file,
+                               Real f_quantum,
+                               UInt32 un_chunk_ticks,
+                               const std::vector<std::string>& vec_robot_ids) {
+   Close();
+   if(f_quantum <= 0.0 || un_chunk_ticks == 0) {
+      THROW_ARGOSEXCEPTION("The trajectory quantum and chunk length must be positive");
+   }
+   m_cFile.open(str_file.c_str(), std::ios_base::binary | std::ios_base::trunc | std::ios_base::out);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Cannot open trajectory file \"" << str_file << "\" for writing");
+   }
+   m_fQuantum = f_quantum;
+   m_unChunkTicks = un_chunk_ticks;
+   m_unRobots = vec_robot_ids.size();
+   CheckpointWrite(m_cFile, TRAJECTORY_MAGIC);
+   CheckpointWrite(m_cFile, TRAJECTORY_VERSION);
+   CheckpointWrite(m_cFile, m_fQuantum);
+   CheckpointWrite(m_cFile, m_unRobots);
+   for(size_t i = 0; i < vec_robot_ids.size(); ++i) {
+      CheckpointWrite(m_cFile, vec_robot_ids[i]);
+   }
+   m_vecLast.resize(m_unRobots);
+   /* A step takes about four bytes per robot before compression */
+   for(UInt32 i = 0; i < TRAJECTORY_SECTIONS; ++i) {
+      m_vecSections[i].clear();
+      m_vecSections[i].reserve(m_unRobots * m_unChunkTicks * 2);
+   }
+   m_vecIndex.clear();
+   m_bChunkOpen = false;
+}
+
+/****************************************/
+/****************************************/
+
+void CTrajectoryRecorder::Close() {
+   if(!m_cFile.is_open()) return;
+   Flush();
+   /* Index and trailer */
+   UInt64 unIndexOffset = m_cFile.tellp();
+   for(size_t i = 0; i < m_vecIndex.size(); ++i) {
+      CheckpointWrite(m_cFile, m_vecIndex[i]);
+   }
+   CheckpointWrite(m_cFile, unIndexOffset);
+   CheckpointWrite<UInt32>(m_cFile, m_vecIndex.size());
+   CheckpointWrite(m_cFile, TRAJECTORY_INDEX_MAGIC);
+   m_cFile.close();
+}
+
+/****************************************/
+/****************************************/
+
+void CTrajectoryRecorder::BeginStep(UInt32 un_trial, UInt32 un_tick) {
+   if(m_bChunkOpen &&
+      (m_sChunk.Trial != un_trial ||
+       m_sChunk.FirstTick + m_sChunk.Ticks != un_tick)) {
+      Flush();
+   }
+   if(!m_bChunkOpen) {
+      ::memset(&m_sChunk, 0, sizeof(m_sChunk));
+      m_sChunk.Trial = un_trial;
+      m_sChunk.FirstTick = un_tick;
+      m_bChunkOpen = true;
+   }
+   m_unNextRobot = 0;
+}
+
+/****************************************/
+/****************************************/
+
+void CTrajectoryRecorder::Record(const CVector2& c_position,
+                                 const CRadians& c_yaw,
+                                 UInt8 un_state) {
+   if(m_unNextRobot >= m_unRobots) {
+      THROW_ARGOSEXCEPTION("More robots recorded in a step than the trajectory file has");
+   }
+   SQuantizedPose sPose;
+   sPose.X = static_cast<SInt32>(std::lround(c_position.GetX() / m_fQuantum));
+   sPose.Y = static_cast<SInt32>(std::lround(c_position.GetY() / m_fQuantum));
+   /* The yaw wraps around naturally in 16 bits */
+   sPose.Yaw = static_cast<UInt16>(std::lround(c_yaw.GetValue() * 65536.0 / CRadians::TWO_PI.GetValue()));
+   SQuantizedPose& sLast = m_vecLast[m_unNextRobot];
+   if(m_sChunk.Ticks == 0) {
+      /* Keyframe */
+      std::vector<UInt8>& vecKey = m_vecSections[TRAJECTORY_SECTION_KEYFRAME];
+      const UInt8* punBytes;
+      punBytes = reinterpret_cast<const UInt8*>(&sPose.X);
+      vecKey.insert(vecKey.end(), punBytes, punBytes + sizeof(sPose.X));
+      punBytes = reinterpret_cast<const UInt8*>(&sPose.Y);
+      vecKey.insert(vecKey.end(), punBytes, punBytes + sizeof(sPose.Y));
+      punBytes = reinterpret_cast<const UInt8*>(&sPose.Yaw);
+      vecKey.insert(vecKey.end(), punBytes, punBytes + sizeof(sPose.Yaw));
+   }
+   else {
+      TrajectoryPutVarint(m_vecSections[TRAJECTORY_SECTION_X], sPose.X - sLast.X);
+      TrajectoryPutVarint(m_vecSections[TRAJECTORY_SECTION_Y], sPose.Y - sLast.Y);
+      TrajectoryPutVarint(m_vecSections[TRAJECTORY_SECTION_YAW], static_cast<SInt16>(sPose.Yaw - sLast.Yaw));
+   }
+   m_vecSections[TRAJECTORY_SECTION_STATE].push_back(un_state);
+   sLast = sPose;
+   ++m_unNextRobot;
+}
+
+/****************************************/
+/****************************************/
+
+void CTrajectoryRecorder::EndStep() {
+   if(m_unNextRobot != m_unRobots) {
+      THROW_ARGOSEXCEPTION("Only " << m_unNextRobot << " of " << m_unRobots << " robots recorded in a step");
+   }
+   ++m_sChunk.Ticks;
+   if(m_sChunk.Ticks >= m_unChunkTicks) {
+      Flush();
+   }
+}
+
+/****************************************/
+/****************************************/
+
+void CTrajectoryRecorder::Flush() {
+   if(!m_bChunkOpen) return;
+   m_bChunkOpen = false;
+   if(m_sChunk.Ticks == 0) return;
+   /* Concatenate the sections */
+   m_vecRaw.clear();
+   for(UInt32 i = 0; i < TRAJECTORY_SECTIONS; ++i) {
+      m_sChunk.Sections[i] = m_vecSections[i].size();
+      m_vecRaw.insert(m_vecRaw.end(), m_vecSections[i].begin(), m_vecSections[i].end());
+      m_vecSections[i].clear();
+   }
+   /* Deflate them */
+   uLongf unCompressed = compressBound(m_vecRaw.size());
+   m_vecCompressed.resize(unCompressed);
+   if(compress2(&m_vecCompressed[0], &unCompressed,
+                &m_vecRaw[0], m_vecRaw.size(),
+                Z_DEFAULT_COMPRESSION) != Z_OK) {
+      THROW_ARGOSEXCEPTION("Cannot compress a trajectory chunk");
+   }
+   m_sChunk.CompressedSize = unCompressed;
+   /* Write the chunk and remember where it is */
+   STrajectoryIndexEntry sEntry;
+   sEntry.Trial = m_sChunk.Trial;
+   sEntry.FirstTick = m_sChunk.FirstTick;
+   sEntry.Ticks = m_sChunk.Ticks;
+   sEntry.Padding = 0;
+   sEntry.Offset = m_cFile.tellp();
+   m_vecIndex.push_back(sEntry);
+   CheckpointWrite(m_cFile, m_sChunk);
+   m_cFile.write(reinterpret_cast<const char*>(&m_vecCompressed[0]), unCompressed);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Error writing the trajectory file");
+   }
+}
@@ -0,0 +1,101 @@
+/*
+ * Recorder of the foot-bot trajectories.
+ *
+ * The loop functions hand it the pose and controller state of every robot
+ * at every step; it quantizes them, delta-encodes them against the
+ * previous step and writes them in compressed chunks with a seekable
+ * index. See trajectory_format.h for the file layout and
+ * trajectory_reader.h to read it back.
+ */
+
+#ifndef TRAJECTORY_RECORDER_H
+#define TRAJECTORY_RECORDER_H
+
+#include "trajectory_format.h"
+#include <argos3/core/utility/math/angles.h>
+#include <argos3/core/utility/math/vector2.h>
+#include <fstream>
+#include <string>
+
+class CTrajectoryRecorder {
+
+public:
+
+   CTrajectoryRecorder();
+   ~CTrajectoryRecorder();
+
+   /*
+    * Opens the file and writes the header. Positions are rounded to
+    * f_quantum meters; a chunk holds at most un_chunk_ticks steps.
+    */
+   void Open(const std::string& str_file,
+             Real f_quantum,
+             UInt32 un_chunk_ticks,
+             const std::vector<std::string>& vec_robot_ids);
+
+   /*
+    * Writes the pending chunk and the index, and closes the file.
+    */
+   void Close();
+
+   /*
+    * Returns true if the recorder is open.
+    */
+   inline bool IsEnabled() const {
+      return m_cFile.is_open();
+   }
+
+   /*
+    * Starts a step. A new chunk starts when the current one is full, or
+    * when the step does not follow the last one (e.g. after a reset).
+    */
+   void BeginStep(UInt32 un_trial, UInt32 un_tick);
+
+   /*
+    * Records a robot. Between BeginStep() and EndStep(), every robot must
+    * be recorded once, in the order of the ids given to Open().
+    */
+   void Record(const CVector2& c_position,
+               const CRadians& c_yaw,
+               UInt8 un_state);
+
+   /*
+    * Ends a step, writing the chunk if it is full.
+    */
+   void EndStep();
+
+   /*
+    * Writes the pending chunk, if any.
+    */
+   void Flush();
+
+private:
+
+   /* Quantized pose of a robot */
+   struct SQuantizedPose {
+      SInt32 X;
+      SInt32 Y;
+      UInt16 Yaw;
+   };
+
+   std::ofstream m_cFile;
+   Real m_fQuantum;
+   UInt32 m_unChunkTicks;
+   UInt32 m_unRobots;
+
+   /* The chunk being built */
+   STrajectoryChunkHeader m_sChunk;
+   bool m_bChunkOpen;
+   /* The robot recorded next in this step */
+   UInt32 m_unNextRobot;
+   std::vector<SQuantizedPose> m_vecLast;
+   std::vector<UInt8> m_vecSections[TRAJECTORY_SECTIONS];
+   /* Scratch buffers for the compression */
+   std::vector<UInt8> m_vecRaw;
+   std::vector<UInt8> m_vecCompressed;
+
+   std::vector<STrajectoryIndexEntry> m_vecIndex;
+
+};
+
+#endif
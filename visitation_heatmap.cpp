@@ -0,0 +1,73 @@
+#include "visitation_heatmap.h"
+#include "foraging_checkpoint.h"
+#include <argos3/core/utility/configuration/argos_exception.h>
+#include <cmath>
+
+/****************************************/
+/****************************************/
+
+CVisitationHeatmap::CVisitationHeatmap() :
+   m_fCellSize(0.1),
+   m_fInvCellSize(10.0),
+   m_unWidth(0),
+   m_unHeight(0),
+   m_unCells(0),
+   m_unInterval(1),
+   m_unSampledSteps(0) {}
+
+/****************************************/
+/****************************************/
+
+CVisitationHeatmap::~CVisitationHeatmap() {
+   Close();
+}
+
+/****************************************/
+/****************************************/
+
+void CVisitationHeatmap::Open(const std::string& str_file,
+                              const CVector2& c_min,
+                              const CVector2& c_max,
+                              Real f_cell_size,
+                              UInt32 un_interval) {
+   Close();
+   if(f_cell_size <= 0.0 || un_interval == 0) {
+      THROW_ARGOSEXCEPTION("The heatmap cell size and interval must be positive");
+   }
+   if(c_max.GetX() <= c_min.GetX() || c_max.GetY() <= c_min.GetY()) {
+      THROW_ARGOSEXCEPTION("The heatmap covers an empty area");
+   }
+   m_cFile.open(str_file.c_str(), std::ios_base::binary | std::ios_base::trunc | std::ios_base::out);
+   if(!m_cFile) {
+      THROW_ARGOSEXCEPTION("Cannot open heatmap file \"" << str_file << "\" for writing");
+   }
+   m_cMin = c_min;
+   m_fCellSize = f_cell_size;
+   m_fInvCellSize = 1.0 / f_cell_size;
+   m_unWidth  = static_cast<UInt32>(std::ceil((c_max.GetX() - c_min.GetX()) * m_fInvCellSize));
+   m_unHeight = static_cast<UInt32>(std::ceil((c_max.GetY() - c_min.GetY()) * m_fInvCellSize));
+   m_unCells = m_unWidth * m_unHeight;
+   m_unInterval = un_interval;
+   m_unSampledSteps = 0;
+   m_vecCounts.assign(NUM_LAYERS * m_unCells, 0);
+}
+
+/****************************************/
+/****************************************/
+
+void CVisitationHeatmap::Close() {
+   if(!m_cFile.is_open()) return;
+   CheckpointWrite(m_cFile, HEATMAP_MAGIC);
+   CheckpointWrite(m_cFile, HEATMAP_VERSION);
+   CheckpointWrite(m_cFile, m_cMin.GetX());
+   CheckpointWrite(m_cFile, m_cMin.GetY());
+   CheckpointWrite(m_cFile, m_fCellSize);
+   CheckpointWrite(m_cFile, m_unWidth);
+   CheckpointWrite(m_cFile, m_unHeight);
+   CheckpointWrite<UInt32>(m_cFile, static_cast<UInt32>(NUM_LAYERS));
+   CheckpointWrite(m_cFile, m_unInterval);
+   CheckpointWrite(m_cFile, m_unSampledSteps);
+   m_cFile.write(reinterpret_cast<const char*>(&m_vecCounts[0]),
+                 m_vecCounts.size() * sizeof(UInt32));
+   m_cFile.close();
+}
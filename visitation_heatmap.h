@@ -0,0 +1,126 @@
+/*
+ * Visitation heatmap of the foot-bots.
+ *
+ * Bins the robot positions into a grid of counters over the arena, one
+ * layer per controller state, every sampled step, and the positions at
+ * which the items are picked in a last layer. The counters accumulate
+ * over the trials and are written when the heatmap is closed.
+ *
+ * File layout, in host byte order:
+ *
+ *    header: UInt32 magic "FGHM", UInt32 version, Real x and y of the
+ *            corner of the grid, Real cell size, UInt32 width, UInt32
+ *            height, UInt32 number of layers, UInt32 sampling interval,
+ *            UInt64 number of sampled steps
+ *    layers: for each layer, width * height UInt32 counters, row by row
+ *            from the lowest y
+ *
+ * The layers are the states of CFootBotForaging::SStateData::EState
+ * (resting, exploring, line following, returning to the nest), then the
+ * pickups. The robots outside of the grid are counted in its border cells.
+ */
+
+#ifndef VISITATION_HEATMAP_H
+#define VISITATION_HEATMAP_H
+
+#include <argos3/core/utility/math/vector2.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace argos;
+
+static const UInt32 HEATMAP_MAGIC   = 0x4D484746; // "FGHM"
+static const UInt32 HEATMAP_VERSION = 1;
+
+class CVisitationHeatmap {
+
+public:
+
+   /* Number of state layers; the pickup layer follows them */
+   static const UInt32 NUM_STATES = 4;
+   static const UInt32 PICKUP_LAYER = NUM_STATES;
+   static const UInt32 NUM_LAYERS = NUM_STATES + 1;
+
+public:
+
+   CVisitationHeatmap();
+   ~CVisitationHeatmap();
+
+   /*
+    * Opens the file and allocates a grid covering the rectangle from
+    * c_min to c_max with cells of f_cell_size meters. The robots are
+    * binned every un_interval steps.
+    */
+   void Open(const std::string& str_file,
+             const CVector2& c_min,
+             const CVector2& c_max,
+             Real f_cell_size,
+             UInt32 un_interval);
+
+   /*
+    * Writes the counters and closes the file.
+    */
+   void Close();
+
+   /*
+    * Returns true if the heatmap is open.
+    */
+   inline bool IsEnabled() const {
+      return m_cFile.is_open();
+   }
+
+   /*
+    * Returns true if the robots are binned at this step, and counts the
+    * step if so.
+    */
+   inline bool BeginStep(UInt32 un_tick) {
+      if(!m_cFile.is_open() || un_tick % m_unInterval != 0) return false;
+      ++m_unSampledSteps;
+      return true;
+   }
+
+   /*
+    * Counts a robot in the given state at the given position.
+    */
+   inline void AddVisit(const CVector2& c_pos, UInt32 un_state) {
+      ++m_vecCounts[un_state * m_unCells + Cell(c_pos)];
+   }
+
+   /*
+    * Counts an item picked at the given position.
+    */
+   inline void AddPickup(const CVector2& c_pos) {
+      ++m_vecCounts[PICKUP_LAYER * m_unCells + Cell(c_pos)];
+   }
+
+private:
+
+   /* Index of the cell of a position in a layer, clamped to the grid */
+   inline UInt32 Cell(const CVector2& c_pos) const {
+      SInt32 nX = static_cast<SInt32>((c_pos.GetX() - m_cMin.GetX()) * m_fInvCellSize);
+      SInt32 nY = static_cast<SInt32>((c_pos.GetY() - m_cMin.GetY()) * m_fInvCellSize);
+      if(nX < 0) nX = 0;
+      else if(nX >= static_cast<SInt32>(m_unWidth)) nX = m_unWidth - 1;
+      if(nY < 0) nY = 0;
+      else if(nY >= static_cast<SInt32>(m_unHeight)) nY = m_unHeight - 1;
+      return nY * m_unWidth + nX;
+   }
+
+private:
+
+   std::ofstream m_cFile;
+   CVector2 m_cMin;
+   Real m_fCellSize;
+   Real m_fInvCellSize;
+   UInt32 m_unWidth;
+   UInt32 m_unHeight;
+   UInt32 m_unCells;
+   UInt32 m_unInterval;
+   UInt64 m_unSampledSteps;
+   /* The layers, one after the other */
+   std::vector<UInt32> m_vecCounts;
+
+};
+
+#endif